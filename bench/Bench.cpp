@@ -0,0 +1,108 @@
+/* INFO
+ * Timing and reporting of the stage benchmarks (see Bench.hpp).
+ */
+
+//----------------------------------------------------------------------
+// INCLUDES
+//----------------------------------------------------------------------
+#include "Bench.hpp"
+
+#include <algorithm>
+#include <chrono>
+
+#include "../src/LatencyHistogram.hpp"
+
+using namespace std::chrono;
+
+//----------------------------------------------------------------------
+// DECLARATIONS AND VARIABLES
+//----------------------------------------------------------------------
+// samples before the recorded ones (caches, branch predictors, allocations)
+const int warmupSamples = 5;
+
+//----------------------------------------------------------------------
+// METHODS
+//----------------------------------------------------------------------
+bool Bench::selected(const std::string &name) const {
+  return opts.filter.empty() || name.find(opts.filter) != std::string::npos;
+}
+
+//________________________________________________
+void Bench::info(const std::string &key, const std::string &value) {
+  infos.push_back({key, value});
+}
+
+//________________________________________________
+void Bench::run(const std::string &name, int batch, const Op &op,
+                const Op &before) {
+  if (!selected(name)) {
+    return;
+  }
+  batch = std::max(batch, 1);
+  long call = 0;
+  // one sample: ns per call
+  auto sample = [&]() {
+    if (before) {
+      before(call);
+    }
+    steady_clock::time_point start = steady_clock::now();
+    for (int b = 0; b < batch; b++) {
+      op(call + b);
+    }
+    steady_clock::time_point end = steady_clock::now();
+    call += batch;
+    return duration<double, std::nano>(end - start).count() / batch;
+  };
+  for (int i = 0; i < warmupSamples; i++) {
+    sample();
+  }
+
+  LatencyHistogram histo;
+  double sum = 0;
+  long samples = 0;
+  steady_clock::time_point due =
+      steady_clock::now() +
+      duration_cast<steady_clock::duration>(duration<double>(opts.seconds));
+  while (samples < opts.maxSamples &&
+         (samples < opts.minSamples || steady_clock::now() < due)) {
+    double ns = sample();
+    histo.record((uint32_t)std::min(ns + 0.5, 4e9));
+    sum += ns;
+    samples++;
+  }
+
+  Result r;
+  r.name = name;
+  r.batch = batch;
+  r.samples = samples;
+  r.mean = samples > 0 ? sum / samples : 0;
+  r.p50 = histo.percentile(50);
+  r.p90 = histo.percentile(90);
+  r.p99 = histo.percentile(99);
+  r.p999 = histo.percentile(99.9);
+  r.max = histo.max();
+  results.push_back(r);
+  printf("bench %-40s p50 %9u ns, p99 %9u ns (%li samples)\n", name.c_str(),
+         r.p50, r.p99, samples);
+}
+
+//________________________________________________
+// {"info": {...}, "unit": "ns", "benchmarks": [{...}, ...]}
+void Bench::writeJson(FILE *out) const {
+  fprintf(out, "{\n  \"info\": {");
+  for (size_t i = 0; i < infos.size(); i++) {
+    fprintf(out, "%s\n    \"%s\": \"%s\"", i ? "," : "",
+            infos[i].first.c_str(), infos[i].second.c_str());
+  }
+  fprintf(out, "\n  },\n  \"unit\": \"ns\",\n  \"benchmarks\": [");
+  for (size_t i = 0; i < results.size(); i++) {
+    const Result &r = results[i];
+    fprintf(out,
+            "%s\n    {\"name\": \"%s\", \"batch\": %i, \"samples\": %li, "
+            "\"mean\": %.1f, \"p50\": %u, \"p90\": %u, \"p99\": %u, "
+            "\"p99.9\": %u, \"max\": %u}",
+            i ? "," : "", r.name.c_str(), r.batch, r.samples, r.mean, r.p50,
+            r.p90, r.p99, r.p999, r.max);
+  }
+  fprintf(out, "\n  ]\n}\n");
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+//----------------------------------------------------------------------
+// INCLUDES
+//----------------------------------------------------------------------
+#include <stdint.h>
+#include <stdio.h>
+
+#include <functional>
+#include <string>
+#include <utility>
+#include <vector>
+
+//****************************************************************
+//                             BENCH
+//****************************************************************
+// Runs the stage benchmarks and collects their timings. Every sample times
+// `batch` calls of an operation (short ones are timed in batches, reading
+// the clock costs some 20-50 ns itself) and records the time per call (ns)
+// in a LatencyHistogram, so the percentiles are within ~6%. An untimed
+// `before` prepares every sample (e.g. publishes the next frame). A stage
+// runs for about `seconds`, with at least minSamples and at most maxSamples
+// samples, after a few warm-up samples that aren't recorded.
+
+class Bench {
+public:
+  struct Options {
+    double seconds = 1;
+    long minSamples = 20;
+    long maxSamples = 100000;
+    std::string filter; // only stages whose name contains this
+  };
+  // gets the number of the call (from 0, counting on across samples)
+  typedef std::function<void(long)> Op;
+
+  explicit Bench(const Options &options) : opts(options) {}
+  bool selected(const std::string &name) const;
+  void run(const std::string &name, int batch, const Op &op,
+           const Op &before = nullptr);
+  // context of the results (cpu, kernel, ...), goes into the JSON
+  void info(const std::string &key, const std::string &value);
+  void writeJson(FILE *out) const;
+
+private:
+  struct Result {
+    std::string name;
+    int batch;
+    long samples;
+    double mean; // all in ns per call
+    uint32_t p50, p90, p99, p999, max;
+  };
+
+  Options opts;
+  std::vector<std::pair<std::string, std::string>> infos;
+  std::vector<Result> results;
+};
@@ -0,0 +1,433 @@
+/* INFO
+ * Stage benchmarks of the pipeline without camera, i2c bus and wiringPi
+ * (`make bench`). Frames come from SyntheticScene, the motors are written to
+ * a MockBus, the udp server sends to a client on localhost. The results go
+ * to stdout (or --json <file>) as JSON, everything else to stderr.
+ */
+
+//----------------------------------------------------------------------
+// INCLUDES
+//----------------------------------------------------------------------
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <boost/program_options.hpp>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+namespace po = boost::program_options;
+
+#include "../src/Camera.hpp"
+#include "../src/DepthCodec.hpp"
+#include "../src/DepthKernel.hpp"
+#include "../src/DepthSearch.hpp"
+#include "../src/Globals.hpp"
+#include "../src/SyntheticSource.hpp"
+#include "../src/WorkerPool.hpp"
+#include "../src/i2c/MockBus.hpp"
+#include "Bench.hpp"
+
+using namespace std::chrono;
+
+#ifndef VERSION
+#define VERSION "unknown"
+// VERSION is defined by the Makefile
+#endif
+
+//----------------------------------------------------------------------
+// DECLARATIONS AND VARIABLES
+//----------------------------------------------------------------------
+// frames cycled through by the processing stages (consecutive frames of all
+// scenes, so the incremental mode sees realistic changes)
+const int benchFrames = 96;
+// the udp client asks for the biggest image ("i9": 180 x 180 pixels)
+const int imageSize = 9;
+// i2c clock of the glove
+const int busClockHz = 400000;
+
+// results of the stages end up here, so the compiler can't drop them
+volatile long sink;
+
+namespace {
+
+//________________________________________________
+// A monitoring client on localhost: (re)sends its request to the udp server
+// every 500 ms (the server drops clients after 2 s) and drains the replies
+class LocalClient {
+public:
+  LocalClient() {
+    fd = socket(AF_INET, SOCK_DGRAM, 0);
+    timeval timeout = {0, 100000};
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    server.sin_family = AF_INET;
+    server.sin_port = htons(9009);
+    server.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    thread = std::thread([this] { loop(); });
+  }
+  ~LocalClient() {
+    stopping = true;
+    thread.join();
+    close(fd);
+  }
+  // e.g. "i9" (images), "e9" (compressed images)
+  void request(const char *msg) {
+    a_request = msg;
+    send();
+  }
+  long received() const { return a_received; }
+  // until the server knows this client (false after 2 s)
+  bool waitForServer() {
+    long before = a_received;
+    for (int i = 0; i < 200 && a_received == before; i++) {
+      {
+        std::lock_guard<std::mutex> lock(Glob::udpServMux);
+        Glob::udpServer.preparePacket("ping", 1);
+      }
+      std::this_thread::sleep_for(milliseconds(10));
+    }
+    return a_received != before;
+  }
+
+private:
+  void send() {
+    const char *msg = a_request;
+    sendto(fd, msg, strlen(msg) + 1, 0, (sockaddr *)&server, sizeof(server));
+  }
+  void loop() {
+    char buffer[65536];
+    steady_clock::time_point due = steady_clock::now();
+    while (!stopping) {
+      if (steady_clock::now() >= due) {
+        send();
+        due += milliseconds(500);
+      }
+      if (recv(fd, buffer, sizeof(buffer), 0) > 0) {
+        a_received++;
+      }
+    }
+  }
+
+  int fd;
+  sockaddr_in server = {};
+  std::thread thread;
+  std::atomic<bool> stopping{false};
+  std::atomic<const char *> a_request{"x"};
+  std::atomic<long> a_received{0};
+};
+
+//________________________________________________
+std::vector<DepthFrame> renderFrames(int width, int height) {
+  SyntheticScene scene(benchFrames / SyntheticScene::kinds);
+  std::vector<DepthFrame> frames(benchFrames);
+  for (int f = 0; f < benchFrames; f++) {
+    frames[f].resize(width, height);
+    scene.render(f, frames[f]);
+  }
+  return frames;
+}
+
+//________________________________________________
+// processData() on the next frame in the mailbox, like the processing thread
+void benchProcessing(Bench &bench, int width, int height, int workers,
+                     int changeTol, const std::string &variant) {
+  std::string name = "process_data/" + std::to_string(width) + "x" +
+                     std::to_string(height) + "/" + variant;
+  if (!bench.selected(name)) {
+    return;
+  }
+  std::vector<DepthFrame> frames = renderFrames(width, height);
+  Glob::modes.a_workers = workers;
+  Glob::modes.a_changeTol = changeTol;
+  DepthDataUtilities processing;
+  bench.run(
+      name, 1, [&](long) { processing.processData(); },
+      [&](long i) {
+        Glob::frameMailbox.writeSlot().copyFrom(frames[i % benchFrames]);
+        Glob::frameMailbox.publish();
+      });
+  Glob::modes.a_workers = 0;
+  Glob::modes.a_changeTol = -1;
+}
+
+//________________________________________________
+// the nearest object search on the histograms of the frames (3x3 glove)
+void benchSearch(Bench &bench) {
+  const std::string setName = "depth_search/set_histogram_3x3";
+  const std::string nearestName = "depth_search/nearest_3x3";
+  if (!bench.selected(setName) && !bench.selected(nearestName)) {
+    return;
+  }
+  std::vector<DepthFrame> frames = renderFrames(224, 172);
+  ActuatorMap map;
+  map.prepare(Glob::layout, 224, 172);
+  const int motors = map.motorCount();
+  DepthKernel kernel;
+  kernel.setMaxDepth(DepthDataUtilities::viewingRange());
+  std::vector<int> histos((size_t)benchFrames * motors * 256, 0);
+  for (int f = 0; f < benchFrames; f++) {
+    int *histo = &histos[(size_t)f * motors * 256];
+    for (int y = 0; y < 172; y++) {
+      for (int x = 0; x < 224; x++) {
+        uint8_t motor = map.motorAt(x, y);
+        if (motor == ActuatorMap::skip) {
+          continue;
+        }
+        int bin = frames[f].confRow(y)[x] > DepthKernel::confidenceThresh
+                      ? DepthKernel::quantize(frames[f].depthRow(y)[x],
+                                              kernel.maxDepthMm(),
+                                              kernel.binFactor())
+                      : 255;
+        histo[motor * 256 + bin]++;
+      }
+    }
+  }
+  std::unique_ptr<DepthSearch> search(new DepthSearch());
+  auto setAll = [&](long i) {
+    const int *histo = &histos[(size_t)(i % benchFrames) * motors * 256];
+    for (int m = 0; m < motors; m++) {
+      search->setHistogram(m, histo + m * 256);
+    }
+  };
+  bench.run(setName, 4, setAll);
+  bench.run(
+      nearestName, 16,
+      [&](long) {
+        int bins[DepthSearch::maxMotors];
+        search->nearest((1 << motors) - 1, bins);
+        sink = sink + bins[0];
+      },
+      setAll);
+}
+
+//________________________________________________
+// the recorder's codec on consecutive frames (key frame every
+// DepthCodec::keyInterval), lossless and with a max error of 2 mm
+void benchCodec(Bench &bench) {
+  std::vector<DepthFrame> frames = renderFrames(224, 172);
+  const size_t rawSize = (size_t)224 * 172 * 3;
+  for (int maxError : {0, 2}) {
+    std::string suffix = maxError == 0 ? "" : "_e" + std::to_string(maxError);
+    std::string encodeName = "codec/encode_224x172" + suffix;
+    std::string decodeName = "codec/decode_224x172" + suffix;
+    if (!bench.selected(encodeName) && !bench.selected(decodeName)) {
+      continue;
+    }
+    // the whole sequence once, for the decoder and the ratio
+    std::vector<std::vector<uint8_t>> encoded(benchFrames);
+    size_t total = 0;
+    {
+      DepthCodec codec;
+      codec.setMaxError(maxError);
+      for (int f = 0; f < benchFrames; f++) {
+        const DepthFrame &frame = frames[f];
+        encoded[f].resize(DepthCodec::maxEncodedSize(224, 172));
+        encoded[f].resize(codec.encode(frame.depthRow(0), frame.confRow(0),
+                                       224, 172, frame.stride(),
+                                       encoded[f].data()));
+        total += encoded[f].size();
+      }
+    }
+    printf("bench: codec, max error %i mm: %.2f:1 (%zu bytes per frame, "
+           "raw %zu)\n",
+           maxError, (double)rawSize * benchFrames / total,
+           total / benchFrames, rawSize);
+    DepthCodec encoder;
+    encoder.setMaxError(maxError);
+    std::vector<uint8_t> out(DepthCodec::maxEncodedSize(224, 172));
+    bench.run(encodeName, 1, [&](long i) {
+      const DepthFrame &frame = frames[i % benchFrames];
+      sink = sink + encoder.encode(frame.depthRow(0), frame.confRow(0), 224,
+                                   172, frame.stride(), out.data());
+    });
+    // frame 0 is a key frame, so the sequence can start over
+    DepthCodec decoder;
+    bench.run(decodeName, 1, [&](long i) {
+      const std::vector<uint8_t> &data = encoded[i % benchFrames];
+      sink = sink + decoder.decode(data.data(), data.size());
+    });
+  }
+}
+
+//________________________________________________
+// what the sending thread prepares for the udp clients of every frame
+void benchUdp(Bench &bench) {
+  const std::string size =
+      std::to_string(imageSize * 20) + "x" + std::to_string(imageSize * 20);
+  const std::string resizeName = "depth_image/resized_" + size;
+  const std::string intName = "udp/prepare_packet_int";
+  const std::string motorsName = "udp/prepare_packet_motors";
+  const std::string rawName = "udp/prepare_image_raw_" + size;
+  const std::string codecName = "udp/prepare_image_codec_" + size;
+  bool udp = bench.selected(intName) || bench.selected(motorsName) ||
+             bench.selected(rawName) || bench.selected(codecName);
+  if (!udp && !bench.selected(resizeName)) {
+    return;
+  }
+  // a processed frame for the depth image
+  {
+    std::vector<DepthFrame> frames = renderFrames(224, 172);
+    DepthDataUtilities processing;
+    Glob::frameMailbox.writeSlot().copyFrom(frames[0]);
+    Glob::frameMailbox.publish();
+    processing.processData();
+  }
+  DepthDataUtilities utilities;
+  bench.run(resizeName, 1, [&](long) {
+    cv::Mat img = utilities.getResizedDepthImage(imageSize);
+    sink = sink + img.rows;
+  });
+  if (!udp) {
+    return;
+  }
+
+  std::thread io([] { Glob::udpService.run(); });
+  {
+    LocalClient client;
+    std::string request = "i" + std::to_string(imageSize);
+    client.request(request.c_str());
+    if (!client.waitForServer()) {
+      printf("bench: no reply from the udp server, skipping udp stages\n");
+    } else {
+      std::vector<unsigned char> motorValues(Glob::layout.motorCount(), 128);
+      bench.run(intName, 1, [&](long i) {
+        std::lock_guard<std::mutex> lock(Glob::udpServMux);
+        Glob::udpServer.preparePacket("cycleP50", (int)i);
+      });
+      bench.run(motorsName, 1, [&](long i) {
+        motorValues[0] = (unsigned char)i;
+        std::lock_guard<std::mutex> lock(Glob::udpServMux);
+        Glob::udpServer.preparePacket("motors", motorValues);
+      });
+      bench.run(rawName, 1, [&](long) {
+        std::lock_guard<std::mutex> lock(Glob::udpServMux);
+        Glob::udpServer.prepareImage();
+      });
+      std::string compressed = "e" + std::to_string(imageSize);
+      client.request(compressed.c_str());
+      std::this_thread::sleep_for(milliseconds(50));
+      bench.run(codecName, 1, [&](long) {
+        std::lock_guard<std::mutex> lock(Glob::udpServMux);
+        Glob::udpServer.prepareImage();
+      });
+      printf("bench: udp client received %li packets\n", client.received());
+    }
+  }
+  Glob::udpService.stop();
+  io.join();
+}
+
+//________________________________________________
+// all motors of a frame (3x3 glove) through the mux and DRV writes
+void benchMotors(Bench &bench) {
+  MockBus codeOnly;
+  MockBus clocked(busClockHz);
+  const int motors = Glob::layout.motorCount();
+  unsigned char values[ActuatorLayout::maxMotors];
+  auto send = [&](long i) {
+    for (int m = 0; m < motors; m++) {
+      values[m] = (unsigned char)((i * 37 + m * 29) % 235); // no pattern
+    }
+    std::lock_guard<std::mutex> lock(Glob::motors.mut);
+    Glob::motorBoard.sendValuesToGlove(values, motors);
+  };
+  struct {
+    MockBus *bus;
+    const char *name;
+  } buses[] = {{&codeOnly, "motor_board/send_values_mock"},
+               {&clocked, "motor_board/send_values_mock_400khz"}};
+  for (auto &b : buses) {
+    if (!bench.selected(b.name)) {
+      continue;
+    }
+    Glob::i2c.init(*b.bus);
+    Glob::motorBoard.setupGlove();
+    long before = b.bus->transactions();
+    long writes = Glob::i2c.writeCount();
+    bench.run(b.name, 1, send);
+    printf("bench: %s: %li i2c transactions (%li writes)\n", b.name,
+           b.bus->transactions() - before, Glob::i2c.writeCount() - writes);
+  }
+}
+
+//________________________________________________
+void benchTimeLogger(Bench &bench) {
+  TimeLogger log;
+  bench.run(
+      "time_logger/store", 32, [&](long) { log.store("startProcess"); },
+      [&](long) { log.reset(); });
+}
+
+} // namespace
+
+//----------------------------------------------------------------------
+// MAIN
+//----------------------------------------------------------------------
+int main(int argc, char *argv[]) {
+  Bench::Options opts;
+  std::string jsonFile = "-";
+  try {
+    po::options_description desc("Allowed options");
+    desc.add_options()("help", "produce help message")(
+        "seconds", po::value<double>(&opts.seconds),
+        "time per stage (default: 1)")(
+        "samples", po::value<long>(&opts.maxSamples),
+        "max samples per stage (default: 100000)")(
+        "filter", po::value<std::string>(&opts.filter),
+        "only run stages whose name contains arg")(
+        "json", po::value<std::string>(&jsonFile),
+        "write the results to file arg (default: stdout)");
+    po::variables_map vm;
+    po::store(po::parse_command_line(argc, argv, desc), vm);
+    po::notify(vm);
+    if (vm.count("help")) {
+      std::cerr << desc << "\n";
+      return 0;
+    }
+  } catch (std::exception &e) {
+    std::cerr << "error: " << e.what() << "\n";
+    return 1;
+  }
+
+  // the pipeline prints to stdout: keep it for the JSON, the rest goes to
+  // stderr
+  fflush(stdout);
+  int jsonFd = dup(STDOUT_FILENO);
+  dup2(STDERR_FILENO, STDOUT_FILENO);
+  FILE *json = jsonFile == "-" ? fdopen(jsonFd, "w")
+                               : fopen(jsonFile.c_str(), "w");
+  if (json == nullptr) {
+    perror(jsonFile.c_str());
+    return 1;
+  }
+
+  Glob::modes.a_simulate = true;
+  Glob::modes.a_doLogPrint = false;
+  Bench bench(opts);
+  bench.info("version", VERSION);
+  bench.info("cores", std::to_string(std::thread::hardware_concurrency()));
+  bench.info("depthKernel", DepthKernel::available().back());
+  bench.info("workers", std::to_string(WorkerPool::autoDetect()));
+
+  int several = std::max(2, WorkerPool::autoDetect());
+  benchProcessing(bench, 224, 172, 1, -1, "1_worker");
+  benchProcessing(bench, 224, 172, several,
+                  -1, std::to_string(several) + "_workers");
+  benchProcessing(bench, 224, 172, 1, 2, "incremental");
+  benchProcessing(bench, 352, 288, 1, -1, "1_worker");
+  benchSearch(bench);
+  benchCodec(bench);
+  benchUdp(bench);
+  benchMotors(bench);
+  benchTimeLogger(bench);
+
+  bench.writeJson(json);
+  fclose(json);
+  return 0;
+}
@@ -0,0 +1,219 @@
+/* INFO
+ * The simulated I2C bus of the glove (see SimBus.hpp), which is the board's
+ * bus in the host simulator.
+ */
+
+//----------------------------------------------------------------------
+// INCLUDES
+//----------------------------------------------------------------------
+#include "SimBus.hpp"
+
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <thread>
+
+#include "../src/Clock.hpp"
+#include "../src/Globals.hpp"
+#include "../src/MotorBoardDefs.hpp"
+#include "SimPlatform.hpp"
+
+using namespace std::chrono;
+
+//----------------------------------------------------------------------
+// DECLARATIONS AND VARIABLES
+//----------------------------------------------------------------------
+// the IMU (LSM6DSM::ADDRESS) and where Imu::init() expects it
+const int imuAddress = 0x6A;
+const int imuMux = 1;
+const int imuLine = 7;
+
+const int maxPrintedConflicts = 10;
+const seconds reportInterval(10);
+
+//----------------------------------------------------------------------
+// METHODS
+//----------------------------------------------------------------------
+I2cBus &I2cBus::board() {
+  static SimBus bus;
+  return bus;
+}
+
+//________________________________________________
+// The board as the actuator layout describes it (loaded before the bus is
+// first used)
+SimBus::SimBus(int clockHz) : clock(clockHz) {
+  tca[0] = new SimTca9548a();
+  tca[1] = new SimTca9548a();
+  nodes.push_back({std::unique_ptr<SimDevice>(tca[0]), TCA9548A_0_ADDRESS,
+                   -1, 0});
+  nodes.push_back({std::unique_ptr<SimDevice>(tca[1]), TCA9548A_1_ADDRESS,
+                   -1, 0});
+  for (int i = 0; i < Glob::layout.motorCount(); i++) {
+    ActuatorLayout::Channel ch = Glob::layout.channel(i);
+    drvs.push_back(new SimDrv2605(i));
+    nodes.push_back({std::unique_ptr<SimDevice>(drvs.back()), DRV2605_ADDRESS,
+                     ch.mux, ch.line});
+  }
+  nodes.push_back(
+      {std::unique_ptr<SimDevice>(new SimLsm6dsm()), imuAddress, imuMux,
+       imuLine});
+  lastReport = Clock::now();
+  printf("sim: i2c bus at %i kHz with 2 TCA9548A, %i DRV2605, 1 LSM6DSM\n",
+         clock / 1000, (int)drvs.size());
+}
+
+//________________________________________________
+int SimBus::write(int handle, uint8_t data) {
+  return writeBytes(handle, &data, 1);
+}
+
+int SimBus::writeReg8(int handle, uint8_t reg, uint8_t value) {
+  uint8_t data[] = {reg, value};
+  return writeBytes(handle, data, 2);
+}
+
+int SimBus::writeReg16(int handle, uint8_t reg, uint16_t value) {
+  uint8_t data[] = {reg, (uint8_t)(value & 0xFF), (uint8_t)(value >> 8)};
+  return writeBytes(handle, data, 3);
+}
+
+int SimBus::writeBlock(int handle, uint8_t reg, const uint8_t *data, int n) {
+  uint8_t buffer[33];
+  if (n < 0 || n > 32) {
+    return -1;
+  }
+  buffer[0] = reg;
+  memcpy(buffer + 1, data, n);
+  return writeBytes(handle, buffer, n + 1);
+}
+
+int SimBus::readBlock(int handle, uint8_t reg, uint8_t *out, int n) {
+  return readBytes(handle, reg, out, n);
+}
+
+int SimBus::readReg8(int handle, uint8_t reg) {
+  uint8_t data[1];
+  int retVal = readBytes(handle, reg, data, 1);
+  return retVal < 0 ? retVal : data[0];
+}
+
+// SMBus word: low byte first
+int SimBus::readReg16(int handle, uint8_t reg) {
+  uint8_t data[2];
+  int retVal = readBytes(handle, reg, data, 2);
+  return retVal < 0 ? retVal : data[0] | data[1] << 8;
+}
+
+//________________________________________________
+// The devices with address `addr` a transaction reaches right now, at most
+// `max` of them; returns how many there are
+int SimBus::reachable(int addr, Node *found[], int max) {
+  int n = 0;
+  for (Node &node : nodes) {
+    if (node.addr == addr &&
+        (node.mux < 0 || tca[node.mux]->lineOpen(node.line))) {
+      if (n < max) {
+        found[n] = &node;
+      }
+      n++;
+    }
+  }
+  return n;
+}
+
+//________________________________________________
+// A write transaction: address byte and `n` data bytes
+int SimBus::writeBytes(int addr, const uint8_t *data, int n) {
+  std::lock_guard<std::mutex> lock(mut);
+  Node *found[ActuatorLayout::maxMotors + 3];
+  const int max = sizeof(found) / sizeof(found[0]);
+  int count = std::min(reachable(addr, found, max), max);
+  transfer(n + 1, 1);
+  report();
+  if (count == 0) {
+    nacks++;
+    errno = EREMOTEIO;
+    return -1;
+  }
+  for (int i = 0; i < count; i++) {
+    found[i]->device->write(data, n);
+  }
+  return 0;
+}
+
+//________________________________________________
+// A combined transaction: the register pointer gets written, then after a
+// repeated start `n` bytes read
+int SimBus::readBytes(int addr, uint8_t reg, uint8_t *out, int n) {
+  std::lock_guard<std::mutex> lock(mut);
+  Node *found[ActuatorLayout::maxMotors + 3];
+  const int max = sizeof(found) / sizeof(found[0]);
+  int count = std::min(reachable(addr, found, max), max);
+  transfer(n + 3, 2);
+  report();
+  if (count == 0) {
+    nacks++;
+    errno = EREMOTEIO;
+    return -1;
+  }
+  if (count > 1 && conflicts++ < maxPrintedConflicts) {
+    printf("sim: %i devices answer the read of 0x%02x, register 0x%02x\n",
+           count, addr, reg);
+  }
+  for (int i = 0; i < count; i++) {
+    found[i]->device->write(&reg, 1);
+  }
+  // open drain: a 0 of any device wins
+  for (int b = 0; b < n; b++) {
+    out[b] = 0xFF;
+    for (int i = 0; i < count; i++) {
+      out[b] &= found[i]->device->read();
+    }
+  }
+  return 0;
+}
+
+//________________________________________________
+// Occupies the bus (and the calling thread) as long as `bytes` bytes and
+// `starts` start conditions take at the bus clock. Not under virtual time:
+// the caller holds the motor locks, so sleeping would stop the clock.
+void SimBus::transfer(int bytes, int starts) {
+  Clock::duration wire =
+      nanoseconds(1000000000LL * wireBits(bytes, starts) / clock);
+  transactions++;
+  busy += wire;
+  if (!Clock::isVirtual()) {
+    std::this_thread::sleep_for(wire);
+  }
+}
+
+//________________________________________________
+// Every reportInterval: transactions and load of the bus since the last
+// report, the motor amplitudes and the lit LED pins
+void SimBus::report() {
+  Clock::time_point now = Clock::now();
+  if (now - lastReport < reportInterval) {
+    return;
+  }
+  double elapsed = duration<double>(now - lastReport).count();
+  printf("sim: i2c %.0f transactions/s, %.0f%% busy, %li NACKs, %li "
+         "conflicts | motors",
+         (transactions - lastTransactions) / elapsed,
+         100 * duration<double>(busy - lastBusy).count() / elapsed, nacks,
+         conflicts);
+  for (SimDrv2605 *drv : drvs) {
+    printf(" %3u", drv->amplitude());
+  }
+  int pins[8];
+  int lit = SimPlatform::lowOutputs(pins, 8);
+  printf(" | LED pins on:");
+  for (int i = 0; i < lit; i++) {
+    printf(" %i", pins[i]);
+  }
+  printf("%s\n", lit ? "" : " none");
+  lastReport = now;
+  lastTransactions = transactions;
+  lastBusy = busy;
+}
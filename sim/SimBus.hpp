@@ -0,0 +1,70 @@
+#pragma once
+
+//----------------------------------------------------------------------
+// INCLUDES
+//----------------------------------------------------------------------
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "../src/Clock.hpp"
+#include "../src/i2c/I2cBus.hpp"
+#include "SimDevices.hpp"
+
+//****************************************************************
+//                        SIMULATED I2C BUS
+//****************************************************************
+// The glove's I2C bus for the host simulator (unfolding-sim): both TCA9548A
+// on the bus itself, behind them a DRV2605 per motor of the actuator layout
+// and the LSM6DSM on line 7 of the second TCA. A transaction reaches every
+// device with its address that is on the bus or behind an open line, like
+// on the wire: nobody there is a NACK (-1), several devices all take a
+// write and AND their bits on a read (counted as a conflict, the first ones
+// get printed). Every transaction takes as long as it would at the bus clock
+// (sleeping, not spinning, like the Pi waits for its I2C controller; no time
+// at all under virtual time).
+// Every 10 s the bus prints its load, the motor amplitudes and the LEDs.
+
+class SimBus : public I2cBus {
+public:
+  explicit SimBus(int clockHz = 400000);
+
+  // the handle is the address (no setup transaction, like wiringPiI2C)
+  int open(int addr) override { return addr; }
+  int write(int handle, uint8_t data) override;
+  int readReg8(int handle, uint8_t reg) override;
+  int readReg16(int handle, uint8_t reg) override;
+  int writeReg8(int handle, uint8_t reg, uint8_t value) override;
+  int writeReg16(int handle, uint8_t reg, uint16_t value) override;
+  int writeBlock(int handle, uint8_t reg, const uint8_t *data, int n) override;
+  int readBlock(int handle, uint8_t reg, uint8_t *out, int n) override;
+  bool simulated() const override { return true; }
+
+private:
+  struct Node {
+    std::unique_ptr<SimDevice> device;
+    int addr;
+    int mux; // -1: on the bus itself
+    int line;
+  };
+
+  int writeBytes(int addr, const uint8_t *data, int n);
+  int readBytes(int addr, uint8_t reg, uint8_t *out, int n);
+  int reachable(int addr, Node *found[], int max);
+  void transfer(int bytes, int starts);
+  void report();
+
+  std::mutex mut;
+  int clock;
+  std::vector<Node> nodes;
+  SimTca9548a *tca[2];
+  std::vector<SimDrv2605 *> drvs; // by motor
+  long transactions = 0;
+  long nacks = 0;
+  long conflicts = 0;
+  Clock::duration busy{0};
+  Clock::time_point lastReport;
+  long lastTransactions = 0;
+  Clock::duration lastBusy{0};
+};
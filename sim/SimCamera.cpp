@@ -0,0 +1,70 @@
+/* INFO
+ * The camera of the host simulator: SyntheticSource frames in the
+ * resolution and at the frame rate of the Pico Flexx use case the app asks
+ * for (--mode, or 'u' over UDP, which restarts unfolding()).
+ */
+
+//----------------------------------------------------------------------
+// INCLUDES
+//----------------------------------------------------------------------
+#include <stdio.h>
+
+#include <memory>
+
+#include "../src/Globals.hpp"
+#include "../src/SyntheticSource.hpp"
+
+//----------------------------------------------------------------------
+// DECLARATIONS AND VARIABLES
+//----------------------------------------------------------------------
+// Pico Flexx use cases MODE_9_5FPS_2000 ... MODE_5_45FPS_500, in the order
+// libroyale lists them
+const float useCaseFps[] = {5, 10, 15, 25, 35, 45};
+const unsigned int useCaseCount = sizeof(useCaseFps) / sizeof(useCaseFps[0]);
+
+namespace {
+
+//****************************************************************
+//                        SIMULATED CAMERA
+//****************************************************************
+// A new SyntheticSource for every open(), like RoyaleSource sets the use
+// case when it's opened
+
+class SimCamera : public FrameSource {
+public:
+  bool open() override {
+    unsigned int useCase = Glob::modes.a_cameraUseCase;
+    if (useCase >= useCaseCount) {
+      printf("sim camera: no use case %u (0 - %u)\n", useCase,
+             useCaseCount - 1);
+      return false;
+    }
+    SyntheticSource::Options options;
+    options.width = 224;
+    options.height = 172;
+    options.fps = useCaseFps[useCase];
+    frames.reset(new SyntheticSource(options));
+    printf("sim camera: use case %u\n", useCase);
+    return frames->open();
+  }
+  bool start() override { return frames && frames->start(); }
+  bool stop() override { return !frames || frames->stop(); }
+  bool isConnected() override { return frames != nullptr; }
+  bool isCapturing() override { return frames && frames->isCapturing(); }
+  const char *name() const override { return "pico flexx (simulated)"; }
+  void printSummary() override {
+    if (frames) {
+      frames->printSummary();
+    }
+  }
+
+private:
+  std::unique_ptr<SyntheticSource> frames;
+};
+
+} // namespace
+
+//----------------------------------------------------------------------
+// METHODS
+//----------------------------------------------------------------------
+FrameSource *FrameSource::camera() { return new SimCamera(); }
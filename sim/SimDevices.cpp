@@ -0,0 +1,247 @@
+/* INFO
+ * Register models of the glove's I2C devices for the host simulator (see
+ * SimDevices.hpp). Reset values and register layouts from the TCA9548A,
+ * DRV2605L and LSM6DSM datasheets, as far as the app uses them.
+ */
+
+//----------------------------------------------------------------------
+// INCLUDES
+//----------------------------------------------------------------------
+#include "SimDevices.hpp"
+
+#include <math.h>
+#include <string.h>
+
+#include <algorithm>
+
+#include "../src/MotorBoardDefs.hpp"
+
+using namespace std::chrono;
+
+//----------------------------------------------------------------------
+// DECLARATIONS AND VARIABLES
+//----------------------------------------------------------------------
+// DRV2605L power-up values of the registers 0x00 - 0x22
+static const uint8_t drvDefaults[] = {
+    0xE0, 0x40, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x05, 0x19, 0xFF, 0x19, 0xFF, 0x3E, 0x8C,
+    0x0C, 0x6C, 0x36, 0x93, 0xF5, 0xA0, 0x20, 0x80, 0x33, 0xA8, 0x00};
+// auto calibration time per AUTO_CAL_TIME (CONTRL4 bits 5:4), ms
+static const int drvCalibMs[] = {250, 350, 600, 1100};
+
+// the LSM6DSM registers the model knows about
+namespace Lsm {
+const uint8_t WHO_AM_I = 0x0F;
+const uint8_t CTRL1_XL = 0x10;
+const uint8_t CTRL2_G = 0x11;
+const uint8_t CTRL3_C = 0x12;
+const uint8_t CTRL5_C = 0x14;
+const uint8_t STATUS_REG = 0x1E;
+const uint8_t OUT_TEMP_L = 0x20;
+const uint8_t OUTZ_H_XL = 0x2D;
+
+const float accelFullScale[4] = {2, 16, 4, 8};         // g, FS_XL
+const float gyroFullScale[4] = {245, 500, 1000, 2000}; // dps, FS_G
+const float selfTestG = 0.5;    // accel self-test offset (0.09 - 1.7 g)
+const float selfTestDps = 50;   // gyro self-test offset (20 - 80 dps)
+const float accelNoiseG = 0.005;
+const float gyroNoiseDps = 0.1;
+} // namespace Lsm
+
+//----------------------------------------------------------------------
+// METHODS
+//----------------------------------------------------------------------
+void SimRegisterDevice::write(const uint8_t *data, int n) {
+  if (n < 1) {
+    return;
+  }
+  pointer = data[0];
+  for (int i = 1; i < n; i++) {
+    writeRegister(pointer, data[i]);
+    if (autoIncrement()) {
+      pointer++;
+    }
+  }
+}
+
+uint8_t SimRegisterDevice::read() {
+  uint8_t value = readRegister(pointer);
+  if (autoIncrement()) {
+    pointer++;
+  }
+  return value;
+}
+
+//________________________________________________
+// every byte written replaces the control register
+void SimTca9548a::write(const uint8_t *data, int n) {
+  if (n > 0) {
+    control = data[n - 1];
+  }
+}
+
+//________________________________________________
+SimDrv2605::SimDrv2605(int actuator_) : actuator(actuator_) { reset(); }
+
+void SimDrv2605::reset() {
+  memset(regs, 0, sizeof(regs));
+  memcpy(regs, drvDefaults, sizeof(drvDefaults));
+  calibrating = false;
+}
+
+uint8_t SimDrv2605::amplitude() const {
+  bool standby = regs[MODE] & 0x40;
+  return !standby && (regs[MODE] & 0x07) == 0x05 ? regs[RTP_INPUT] : 0;
+}
+
+//________________________________________________
+// Finish a running auto calibration once its time is up. It succeeds
+// (STATUS bit 3 cleared) with an LRA selected in FB_CON and a rated voltage
+// and overdrive clamp set.
+void SimDrv2605::updateCalibration() {
+  if (!calibrating || Clock::now() < calibEnd) {
+    return;
+  }
+  calibrating = false;
+  regs[GO] = 0;
+  bool ok = (regs[FB_CON] & 0x80) && regs[RATED_VOLTAGE] && regs[OD_CLAMP];
+  if (ok) {
+    regs[STATUS] &= ~0x08;
+    regs[A_CAL_COMP] = 0x0D + actuator % 3;
+    regs[A_CAL_BEMF] = 0x8A + 5 * (actuator % 4);
+    regs[FB_CON] = (regs[FB_CON] & ~0x03) | 0x02; // BEMF_GAIN
+    regs[LRA_RESON] = resonance();
+  } else {
+    regs[STATUS] |= 0x08;
+  }
+}
+
+uint8_t SimDrv2605::readRegister(uint8_t reg) {
+  updateCalibration();
+  return regs[reg];
+}
+
+void SimDrv2605::writeRegister(uint8_t reg, uint8_t value) {
+  updateCalibration();
+  switch (reg) {
+  case STATUS:
+  case VBAT_MON:
+  case LRA_RESON:
+    return; // read only
+  case MODE:
+    if (value & 0x80) { // DEV_RESET, clears itself when done
+      reset();
+      return;
+    }
+    break;
+  case GO:
+    value &= 0x01;
+    // the auto calibration mode starts a calibration, clearing GO cancels
+    // it. Waveform playback (other modes) isn't modelled: GO stays 0.
+    if (value && !calibrating && (regs[MODE] & 0x47) == 0x07) {
+      calibrating = true;
+      calibEnd = Clock::now() +
+                 milliseconds(drvCalibMs[(regs[CONTRL4] >> 4) & 0x03]);
+    } else if (!value) {
+      calibrating = false;
+    }
+    value = calibrating;
+    break;
+  default:
+    break;
+  }
+  regs[reg] = value;
+  // the resonance gets measured while an LRA (FB_CON bit 7) is driven
+  if (amplitude() && (regs[FB_CON] & 0x80)) {
+    regs[LRA_RESON] = resonance();
+  }
+}
+
+//________________________________________________
+SimLsm6dsm::SimLsm6dsm() { reset(); }
+
+void SimLsm6dsm::reset() {
+  memset(regs, 0, sizeof(regs));
+  regs[Lsm::WHO_AM_I] = 0x6A;
+  regs[Lsm::CTRL3_C] = 0x04; // IF_INC
+  lastSample = Clock::now();
+}
+
+bool SimLsm6dsm::autoIncrement() const { return regs[Lsm::CTRL3_C] & 0x04; }
+
+//________________________________________________
+// uniform in [-1, 1] (xorshift32: the same run gives the same samples)
+float SimLsm6dsm::noise() {
+  random ^= random << 13;
+  random ^= random >> 17;
+  random ^= random << 5;
+  return random / 2147483648.f - 1;
+}
+
+//________________________________________________
+// New output data: temperature, gyro xyz, accel xyz (two's complement, little
+// endian unless BLE in CTRL3_C is set)
+void SimLsm6dsm::sample() {
+  float aRes = Lsm::accelFullScale[(regs[Lsm::CTRL1_XL] >> 2) & 3] / 32768;
+  float gRes = Lsm::gyroFullScale[(regs[Lsm::CTRL2_G] >> 2) & 3] / 32768;
+  // ST_XL: 1 positive, 2 negative. 3 is "not allowed" in the datasheet, but
+  // the driver uses it for its negative test: taken as negative.
+  int stXl = regs[Lsm::CTRL5_C] & 0x03;
+  int stG = (regs[Lsm::CTRL5_C] >> 2) & 0x03; // 1 positive, 3 negative
+  float aSelf = stXl == 1 ? Lsm::selfTestG : stXl ? -Lsm::selfTestG : 0;
+  float gSelf = stG == 1 ? Lsm::selfTestDps : stG == 3 ? -Lsm::selfTestDps : 0;
+  const float gravity[3] = {-1, 0, 0};
+
+  auto raw = [](float value, float res) {
+    return (int16_t)std::max(-32768.f, std::min(32767.f, roundf(value / res)));
+  };
+  int16_t out[7];
+  out[0] = raw(noise(), 1 / 256.f); // 25 degC +- 1
+  for (int k = 0; k < 3; k++) {
+    out[1 + k] = raw(gSelf + Lsm::gyroNoiseDps * noise(), gRes);
+    out[4 + k] = raw(gravity[k] + aSelf + Lsm::accelNoiseG * noise(), aRes);
+  }
+  bool bigEndian = regs[Lsm::CTRL3_C] & 0x02;
+  for (int i = 0; i < 7; i++) {
+    uint8_t lo = out[i] & 0xFF;
+    uint8_t hi = (uint16_t)out[i] >> 8;
+    regs[Lsm::OUT_TEMP_L + 2 * i] = bigEndian ? hi : lo;
+    regs[Lsm::OUT_TEMP_L + 2 * i + 1] = bigEndian ? lo : hi;
+  }
+  lastSample = Clock::now();
+}
+
+//________________________________________________
+uint8_t SimLsm6dsm::readRegister(uint8_t reg) {
+  if (reg == Lsm::STATUS_REG) {
+    // ODR bits 7:4: 0 power down, n: 12.5 Hz * 2^(n-1)
+    auto ready = [&](uint8_t ctrl) {
+      int odr = ctrl >> 4;
+      if (odr < 1 || odr > 10) {
+        return false;
+      }
+      duration<double> period(1 / (12.5 * (1 << (odr - 1))));
+      return Clock::now() - lastSample >= period;
+    };
+    bool xlda = ready(regs[Lsm::CTRL1_XL]);
+    bool gda = ready(regs[Lsm::CTRL2_G]);
+    return xlda | (gda << 1) | ((xlda || gda) << 2);
+  }
+  if (reg == Lsm::OUT_TEMP_L) {
+    sample();
+  }
+  return regs[reg];
+}
+
+void SimLsm6dsm::writeRegister(uint8_t reg, uint8_t value) {
+  // read only: WHO_AM_I, the sources, status and output registers
+  if (reg == Lsm::WHO_AM_I ||
+      (reg >= Lsm::STATUS_REG - 3 && reg <= Lsm::OUTZ_H_XL)) {
+    return;
+  }
+  if (reg == Lsm::CTRL3_C && (value & 0x01)) { // SW_RESET, clears itself
+    reset();
+    return;
+  }
+  regs[reg] = value;
+}
@@ -0,0 +1,121 @@
+#pragma once
+
+//----------------------------------------------------------------------
+// INCLUDES
+//----------------------------------------------------------------------
+#include <stdint.h>
+
+#include "../src/Clock.hpp"
+
+//****************************************************************
+//                        SIMULATED DEVICE
+//****************************************************************
+// A device on the simulated I2C bus (SimBus), seen at the byte level like on
+// the wire: a write transaction hands over the bytes after the address byte,
+// a read transaction takes its bytes one at a time.
+
+class SimDevice {
+public:
+  virtual ~SimDevice() {}
+  virtual const char *name() const = 0;
+  virtual void write(const uint8_t *data, int n) = 0;
+  virtual uint8_t read() = 0;
+};
+
+//****************************************************************
+//                    SIMULATED REGISTER DEVICE
+//****************************************************************
+// The first byte of a write sets the register pointer, every further byte
+// (written or read) goes to the register it points to and moves it on.
+
+class SimRegisterDevice : public SimDevice {
+public:
+  void write(const uint8_t *data, int n) override;
+  uint8_t read() override;
+
+protected:
+  virtual uint8_t readRegister(uint8_t reg) { return regs[reg]; }
+  virtual void writeRegister(uint8_t reg, uint8_t value) { regs[reg] = value; }
+  virtual bool autoIncrement() const { return true; }
+
+  uint8_t regs[256] = {0};
+  uint8_t pointer = 0;
+};
+
+//****************************************************************
+//                        SIMULATED TCA9548A
+//****************************************************************
+// The I2C multiplexer: a single control register, one bit per downstream
+// line (1: connected). Power-up: all lines disconnected.
+
+class SimTca9548a : public SimDevice {
+public:
+  const char *name() const override { return "TCA9548A"; }
+  void write(const uint8_t *data, int n) override;
+  uint8_t read() override { return control; }
+  bool lineOpen(int line) const { return control & (1 << line); }
+
+private:
+  uint8_t control = 0;
+};
+
+//****************************************************************
+//                        SIMULATED DRV2605
+//****************************************************************
+// The haptic driver of one LRA: reset (MODE bit 7) and standby, the
+// real-time playback mode (RTP_INPUT is the amplitude) and the auto
+// calibration (GO in the auto calibration mode), which takes as long as
+// AUTO_CAL_TIME in CONTRL4 asks for and then reports plausible results that
+// differ a bit from actuator to actuator. LRA_RESON also gets updated while
+// the LRA is driven.
+
+class SimDrv2605 : public SimRegisterDevice {
+public:
+  explicit SimDrv2605(int actuator);
+  const char *name() const override { return "DRV2605"; }
+  // what the actuator gets: RTP_INPUT in the RTP mode, else 0
+  uint8_t amplitude() const;
+  // LRA_RESON of the actuator (period in 98.46 us steps, ~175 Hz)
+  uint8_t resonance() const { return 57 + actuator % 5; }
+
+protected:
+  uint8_t readRegister(uint8_t reg) override;
+  void writeRegister(uint8_t reg, uint8_t value) override;
+
+private:
+  void reset();
+  void updateCalibration();
+
+  int actuator;
+  bool calibrating = false;
+  Clock::time_point calibEnd;
+};
+
+//****************************************************************
+//                        SIMULATED LSM6DSM
+//****************************************************************
+// The IMU of the glove, held in the position of use (1 g along -x, no
+// rotation) with a bit of noise: WHO_AM_I, software reset (CTRL3_C bit 0),
+// the full scales and data rates of CTRL1_XL/CTRL2_G, data ready flags in
+// STATUS_REG following the data rates and the self-test of CTRL5_C. Reading
+// OUT_TEMP_L takes a new sample into all output registers (the driver reads
+// them as one block starting there).
+
+class SimLsm6dsm : public SimRegisterDevice {
+public:
+  SimLsm6dsm();
+  const char *name() const override { return "LSM6DSM"; }
+
+protected:
+  uint8_t readRegister(uint8_t reg) override;
+  void writeRegister(uint8_t reg, uint8_t value) override;
+  bool autoIncrement() const override;
+
+private:
+  void reset();
+  void sample();
+  float noise();
+
+  uint32_t random = 2463534242u;
+  Clock::time_point lastSample;
+};
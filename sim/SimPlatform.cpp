@@ -0,0 +1,72 @@
+/* INFO
+ * Platform.hpp without the board, for the host simulator and the
+ * benchmarks: GPIO as an array of pin states (instead of src/Platform.cpp,
+ * wiringPi).
+ */
+
+//----------------------------------------------------------------------
+// INCLUDES
+//----------------------------------------------------------------------
+#include "SimPlatform.hpp"
+
+#include "../src/Clock.hpp"
+#include "../src/Platform.hpp"
+
+#include <stdint.h>
+#include <stdio.h>
+
+#include <atomic>
+
+//----------------------------------------------------------------------
+// DECLARATIONS AND VARIABLES
+//----------------------------------------------------------------------
+// wiringPi pin numbers; inputs float high (the LEDs are driven low)
+const int pinCount = 64;
+static std::atomic<bool> a_pinIsOutput[pinCount];
+static std::atomic<bool> a_pinLevel[pinCount];
+
+//----------------------------------------------------------------------
+// METHODS
+//----------------------------------------------------------------------
+void Platform::setup() {}
+
+//________________________________________________
+// The LSM6DSM driver's delay() on anything but the Pi and Arduino (see
+// LSM6DSM.h)
+void delay(uint32_t msec) {
+  Clock::sleepFor(std::chrono::milliseconds(msec));
+}
+
+//________________________________________________
+void Platform::pinMode(int pin, PinMode mode) {
+  if (pin < 0 || pin >= pinCount) {
+    printf("gpio: no pin %i\n", pin);
+    return;
+  }
+  a_pinIsOutput[pin] = mode == Output;
+  if (mode == Input) {
+    a_pinLevel[pin] = true;
+  }
+}
+
+void Platform::digitalWrite(int pin, int value) {
+  if (pin < 0 || pin >= pinCount) {
+    printf("gpio: no pin %i\n", pin);
+    return;
+  }
+  // like on the Pi, the level only shows on an output
+  if (a_pinIsOutput[pin]) {
+    a_pinLevel[pin] = value != 0;
+  }
+}
+
+//________________________________________________
+int SimPlatform::lowOutputs(int *pins, int max) {
+  int n = 0;
+  for (int pin = 0; pin < pinCount && n < max; pin++) {
+    if (a_pinIsOutput[pin] && !a_pinLevel[pin]) {
+      pins[n++] = pin;
+    }
+  }
+  return n;
+}
@@ -0,0 +1,13 @@
+#pragma once
+
+//****************************************************************
+//                     SIMULATED PLATFORM
+//****************************************************************
+// What the host implementation of Platform.hpp (SimPlatform.cpp) lets the
+// simulator look at: the state of the GPIO pins.
+
+namespace SimPlatform {
+// the output pins driven low (a lit LED channel, the LEDs are active low)
+// in ascending order, at most `max` of them; returns how many
+int lowOutputs(int *pins, int max);
+} // namespace SimPlatform
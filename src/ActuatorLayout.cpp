@@ -0,0 +1,222 @@
+/* INFO
+ * Actuator layouts: parsing of the layout file and the per-resolution pixel
+ * to motor lookup table built from it (see ActuatorLayout.hpp).
+ */
+
+//----------------------------------------------------------------------
+// INCLUDES
+//----------------------------------------------------------------------
+#include "ActuatorLayout.hpp"
+
+#include <stdio.h>
+
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+
+//----------------------------------------------------------------------
+// METHODS
+//----------------------------------------------------------------------
+const uint8_t ActuatorMap::skip;
+
+ActuatorLayout::ActuatorLayout() {
+  setDefaults();
+  Region grid = {GRID, 0, 3, 3, 0.0f, 0.0f, 1.0f, 1.0f};
+  regions.push_back(grid);
+  motors = 9;
+  // stronger vibrations on left motors (0, 3, 6)
+  for (int i = 0; i < motors; i += 3) {
+    gains[i] = 1.0f;
+  }
+}
+
+//________________________________________________
+// DRV 0-4 are on the first TCA, 5-8 (and any further) on the second one
+void ActuatorLayout::setDefaults() {
+  motors = 0;
+  regions.clear();
+  for (int i = 0; i < maxMotors; i++) {
+    channels[i].mux = i <= 4 ? 0 : 1;
+    channels[i].line = i <= 4 ? i : i - 5;
+    gains[i] = 0.9f;
+  }
+}
+
+//________________________________________________
+// Read a layout file (format see ActuatorLayout.hpp). Prints the offending
+// line and keeps the current layout if anything is wrong.
+bool ActuatorLayout::load(const std::string &path) {
+  std::ifstream file(path);
+  if (!file) {
+    printf("can't open layout file %s\n", path.c_str());
+    return false;
+  }
+  ActuatorLayout parsed;
+  parsed.setDefaults();
+  std::string line;
+  int lineNo = 0;
+  while (std::getline(file, line)) {
+    lineNo++;
+    line = line.substr(0, line.find('#'));
+    std::istringstream ss(line);
+    std::string cmd;
+    if (!(ss >> cmd)) {
+      continue; // empty line or comment
+    }
+    bool ok = false;
+    Region r = {GRID, 0, 0, 0, 0.0f, 0.0f, 1.0f, 1.0f};
+    if (cmd == "grid") {
+      ok = (bool)(ss >> r.cols >> r.rows) && r.cols > 0 && r.rows > 0 &&
+           r.cols * r.rows <= maxMotors;
+      if (ok) {
+        int count = r.cols * r.rows;
+        parsed.motors = std::max(parsed.motors, count);
+        // like the glove: stronger vibrations on the left column
+        for (int i = 0; i < count; i += r.cols) {
+          parsed.gains[i] = 1.0f;
+        }
+      }
+    } else if (cmd == "region") {
+      r.kind = REGION;
+      ok = (bool)(ss >> r.motor >> r.x0 >> r.y0 >> r.x1 >> r.y1) &&
+           r.motor >= 0 && r.motor < maxMotors;
+      if (ok) {
+        parsed.motors = std::max(parsed.motors, r.motor + 1);
+      }
+    } else if (cmd == "mask") {
+      r.kind = MASK;
+      ok = (bool)(ss >> r.x0 >> r.y0 >> r.x1 >> r.y1);
+    } else if (cmd == "channel") {
+      int motor, mux, muxLine;
+      ok = (bool)(ss >> motor >> mux >> muxLine) && motor >= 0 &&
+           motor < maxMotors && mux >= 0 && mux <= 1 && muxLine >= 0 &&
+           muxLine <= 7;
+      if (ok) {
+        parsed.channels[motor].mux = mux;
+        parsed.channels[motor].line = muxLine;
+      }
+    } else if (cmd == "gain") {
+      int motor;
+      float factor;
+      ok = (bool)(ss >> motor >> factor) && motor >= 0 && motor < maxMotors &&
+           factor >= 0.0f && factor <= 1.0f;
+      if (ok) {
+        parsed.gains[motor] = factor;
+      }
+    }
+    if (!ok) {
+      printf("layout %s:%i: can't parse \"%s\"\n", path.c_str(), lineNo,
+             line.c_str());
+      return false;
+    }
+    if (cmd == "grid" || cmd == "region" || cmd == "mask") {
+      parsed.regions.push_back(r);
+    }
+  }
+  if (parsed.motors == 0) {
+    printf("layout %s has no motors\n", path.c_str());
+    return false;
+  }
+  *this = parsed;
+  return true;
+}
+
+//________________________________________________
+// Resolve the layout for a frame size. Runs once per resolution, so
+// divisions and float math are fine here.
+bool ActuatorMap::prepare(const ActuatorLayout &layout, int width,
+                          int height) {
+  if (source == &layout && width == w && height == h) {
+    return false;
+  }
+  source = &layout;
+  w = width;
+  h = height;
+  motors = layout.motorCount();
+  lut.assign((size_t)w * h, skip);
+  for (const ActuatorLayout::Region &r : layout.regions) {
+    if (r.kind == ActuatorLayout::GRID) {
+      // column and row of every pixel (tile borders: see tileStart())
+      std::vector<int> col(w);
+      std::vector<int> row(h);
+      for (int i = 0; i < r.cols; i++) {
+        std::fill(col.begin() + tileStart(i, w, r.cols),
+                  col.begin() + tileStart(i + 1, w, r.cols), i);
+      }
+      for (int i = 0; i < r.rows; i++) {
+        std::fill(row.begin() + tileStart(i, h, r.rows),
+                  row.begin() + tileStart(i + 1, h, r.rows), i);
+      }
+      int last = r.cols * r.rows - 1;
+      for (int y = 0; y < h; y++) {
+        for (int x = 0; x < w; x++) {
+          int tile = row[y] * r.cols + col[x];
+          lut[y * w + x] = last - tile; // turned by 180 deg
+        }
+      }
+      continue;
+    }
+    uint8_t value = r.kind == ActuatorLayout::MASK ? skip : r.motor;
+    for (int y = 0; y < h; y++) {
+      float fy = (y + 0.5f) / h; // pixel center
+      if (fy < r.y0 || fy >= r.y1) {
+        continue;
+      }
+      for (int x = 0; x < w; x++) {
+        float fx = (x + 0.5f) / w;
+        if (fx >= r.x0 && fx < r.x1) {
+          lut[y * w + x] = value;
+        }
+      }
+    }
+  }
+
+  // run-length encode the rows and find the last row of every motor
+  runs.clear();
+  rowRuns.assign(h + 1, 0);
+  pixels.assign(motors, 0);
+  std::vector<int> lastRow(motors, -1);
+  for (int y = 0; y < h; y++) {
+    rowRuns[y] = (int)runs.size();
+    const uint8_t *row = &lut[y * w];
+    int x = 0;
+    while (x < w) {
+      int start = x;
+      while (x < w && row[x] == row[start]) {
+        x++;
+      }
+      Run run = {(uint16_t)start, (uint16_t)x, row[start]};
+      runs.push_back(run);
+      if (run.motor != skip) {
+        pixels[run.motor] += x - start;
+        lastRow[run.motor] = y;
+      }
+    }
+  }
+  rowRuns[h] = (int)runs.size();
+  gridCols = 0;
+  if (layout.regions.size() == 1 &&
+      layout.regions[0].kind == ActuatorLayout::GRID &&
+      (int)runs.size() == h * layout.regions[0].cols) {
+    gridCols = layout.regions[0].cols;
+  }
+
+  // a motor is done after its last row. Motors without any pixels (e.g.
+  // completely masked) are reported together with the end of the frame.
+  segs.clear();
+  for (int y = 0; y < h; y++) {
+    uint16_t done = 0;
+    for (int m = 0; m < motors; m++) {
+      if (lastRow[m] == y || (y == h - 1 && lastRow[m] < 0)) {
+        done |= 1 << m;
+      }
+    }
+    if (done || y == h - 1) {
+      Segment seg = {y + 1, done};
+      segs.push_back(seg);
+    }
+  }
+  printf("actuator map for %i x %i: %i motors, %i runs, %i segments\n", w, h,
+         motors, (int)runs.size(), (int)segs.size());
+  return true;
+}
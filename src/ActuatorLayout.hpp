@@ -0,0 +1,123 @@
+#pragma once
+
+//----------------------------------------------------------------------
+// INCLUDES
+//----------------------------------------------------------------------
+#include <stdint.h>
+
+#include <string>
+#include <vector>
+
+//****************************************************************
+//                        ACTUATOR LAYOUT
+//****************************************************************
+// Which part of the depth image drives which motor and where the motors are
+// connected. Loaded once from a config file (or the default 3x3 glove) and
+// independent of the camera resolution. A layout file has one directive per
+// line ('#' starts a comment), later lines win where regions overlap:
+//
+//   grid <cols> <rows>                 uniform grid, motors numbered like the
+//                                      3x3 glove (image turned by 180 deg)
+//   region <motor> <x0> <y0> <x1> <y1> rectangle in fractions (0..1) of the
+//                                      frame, e.g. finer tiles in the center
+//   mask <x0> <y0> <x1> <y1>           pixels to ignore (e.g. own fingers)
+//   channel <motor> <mux> <line>       TCA9548A and line of the motor's DRV
+//   gain <motor> <factor>              vibration strength of the motor
+
+class ActuatorLayout {
+public:
+  static const int maxMotors = 16; // one bit per motor in a uint16_t mask
+
+  struct Channel {
+    uint8_t mux;
+    uint8_t line;
+  };
+
+  ActuatorLayout(); // the 3x3 glove
+  bool load(const std::string &path);
+
+  int motorCount() const { return motors; }
+  Channel channel(int motor) const { return channels[motor]; }
+  float gain(int motor) const { return gains[motor]; }
+
+private:
+  friend class ActuatorMap;
+  enum Kind { GRID, REGION, MASK };
+  struct Region {
+    Kind kind;
+    int motor;      // REGION only
+    int cols, rows; // GRID only
+    float x0, y0, x1, y1;
+  };
+  void setDefaults();
+
+  int motors;
+  std::vector<Region> regions;
+  Channel channels[maxMotors];
+  float gains[maxMotors];
+};
+
+//****************************************************************
+//                          ACTUATOR MAP
+//****************************************************************
+// The layout resolved for one frame size: a pixel to motor lookup table (with
+// `skip` for masked pixels), stored run-length encoded per row so the depth
+// kernel gets whole spans of one motor without any per-pixel divisions.
+// Also knows after which row every motor's region is complete, so finished
+// motors can be streamed to the glove before the rest of the frame is done.
+// Only rebuilt when the resolution (camera use case) or the layout changes.
+
+class ActuatorMap {
+public:
+  static const uint8_t skip = 0xFF;
+
+  struct Run {
+    uint16_t x0, x1; // pixels x0..x1-1 of the row
+    uint8_t motor;   // or skip
+  };
+  // after processing rows [previous segment end, rowEnd) the motors in
+  // `done` are complete
+  struct Segment {
+    int rowEnd;
+    uint16_t done;
+  };
+
+  // returns true if the map had to be (re)built
+  bool prepare(const ActuatorLayout &layout, int width, int height);
+
+  int motorCount() const { return motors; }
+  int width() const { return w; }
+  int height() const { return h; }
+  uint8_t motorAt(int x, int y) const { return lut[y * w + x]; }
+  const Run *rowBegin(int y) const { return &runs[rowRuns[y]]; }
+  const Run *rowEnd(int y) const { return &runs[rowRuns[y + 1]]; }
+  // runs are numbered top to bottom: run - rowBegin(0) is 0..runCount()-1
+  int runCount() const { return (int)runs.size(); }
+  const std::vector<Segment> &segments() const { return segs; }
+  // number of columns if the layout is a plain grid (every row consists of
+  // one run per column), 0 otherwise
+  int gridColumns() const { return gridCols; }
+  int pixelCount(int motor) const { return pixels[motor]; }
+  // first pixel of tile i of a grid splitting n pixels into `tiles`
+  // (i == tiles: n). The tiles are n / tiles + 1 pixels wide like in the
+  // original 3x3 processing, the last one gets the rest. Only if that leaves
+  // the last tile empty (wide grids, e.g. 16 columns on 224 px) tile i
+  // starts at ceil(i * n / tiles) instead.
+  static constexpr int tileStart(int i, int n, int tiles) {
+    return (tiles - 1) * (n / tiles + 1) < n
+               ? (i * (n / tiles + 1) < n ? i * (n / tiles + 1) : n)
+               : (i * n + tiles - 1) / tiles;
+  }
+
+private:
+  const ActuatorLayout *source = nullptr;
+  int w = 0;
+  int h = 0;
+  int motors = 0;
+  int gridCols = 0;
+  std::vector<uint8_t> lut;   // motor (or skip) of every pixel
+  std::vector<Run> runs;      // all runs, row by row
+  std::vector<int> rowRuns;   // index of the first run of every row (+ end)
+  std::vector<Segment> segs;  // streaming order, top to bottom
+  std::vector<int> pixels;    // number of pixels of every motor
+};
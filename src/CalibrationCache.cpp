@@ -0,0 +1,144 @@
+/* INFO
+ * Auto calibration results of the DRV2605s, stored per glove (see
+ * CalibrationCache.hpp).
+ */
+
+//----------------------------------------------------------------------
+// INCLUDES
+//----------------------------------------------------------------------
+#include "CalibrationCache.hpp"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <fstream>
+#include <sstream>
+
+//----------------------------------------------------------------------
+// METHODS
+//----------------------------------------------------------------------
+constexpr float CalibrationCache::maxResonanceDrift;
+
+//________________________________________________
+// FNV-1a over the motor count, the channel and the device ID of every motor
+uint32_t CalibrationCache::fingerprint(const ActuatorLayout &layout,
+                                       const uint8_t deviceIds[]) {
+  uint32_t h = 2166136261u;
+  auto add = [&h](uint8_t byte) { h = (h ^ byte) * 16777619u; };
+  add((uint8_t)layout.motorCount());
+  for (int i = 0; i < layout.motorCount(); i++) {
+    add(layout.channel(i).mux);
+    add(layout.channel(i).line);
+    add(deviceIds[i]);
+  }
+  return h;
+}
+
+//________________________________________________
+// Takes the file only if its version and fingerprint match and every motor
+// has its values. A missing file is normal (first start), everything else
+// gets printed.
+bool CalibrationCache::load(const std::string &path, uint32_t fingerprint,
+                            int motors) {
+  drvs.clear();
+  std::ifstream file(path);
+  if (!file) {
+    return false;
+  }
+  std::vector<Drv> parsed(motors);
+  std::vector<bool> present(motors, false);
+  int fileVersion = 0;
+  uint32_t fileHardware = 0;
+  std::string line;
+  int lineNo = 0;
+  while (std::getline(file, line)) {
+    lineNo++;
+    line = line.substr(0, line.find('#'));
+    std::istringstream ss(line);
+    std::string key;
+    if (!(ss >> key)) {
+      continue; // empty line or comment
+    }
+    bool ok = false;
+    if (key == "version") {
+      ok = (bool)(ss >> fileVersion);
+    } else if (key == "fingerprint") {
+      ok = (bool)(ss >> std::hex >> fileHardware);
+    } else if (key == "drv") {
+      int motor;
+      unsigned int comp, bemf, feedback, resonance;
+      ok = (bool)(ss >> motor >> comp >> bemf >> feedback >> resonance) &&
+           comp <= 0xFF && bemf <= 0xFF && feedback <= 0xFF &&
+           resonance <= 0xFF;
+      if (ok && motor >= 0 && motor < motors) {
+        parsed[motor] = {(uint8_t)comp, (uint8_t)bemf, (uint8_t)feedback,
+                         (uint8_t)resonance};
+        present[motor] = true;
+      }
+    }
+    if (!ok) {
+      printf("calibration %s:%i: can't parse \"%s\"\n", path.c_str(), lineNo,
+             line.c_str());
+      return false;
+    }
+  }
+  if (fileVersion != version) {
+    printf("calibration %s has version %i instead of %i\n", path.c_str(),
+           fileVersion, version);
+    return false;
+  }
+  if (fileHardware != fingerprint) {
+    printf("calibration %s is for another layout or other drivers (%08x, "
+           "this is %08x)\n", path.c_str(), fileHardware, fingerprint);
+    return false;
+  }
+  for (int i = 0; i < motors; i++) {
+    if (!present[i]) {
+      printf("calibration %s has no values for DRV %i\n", path.c_str(), i);
+      return false;
+    }
+  }
+  hardware = fingerprint;
+  drvs = parsed;
+  return true;
+}
+
+//________________________________________________
+// Written next to the file and renamed, so a power cut never leaves half a
+// calibration behind
+bool CalibrationCache::save(const std::string &path) const {
+  std::string tmpPath = path + ".tmp";
+  FILE *file = fopen(tmpPath.c_str(), "w");
+  if (file == nullptr) {
+    printf("can't write the calibration to %s\n", path.c_str());
+    return false;
+  }
+  fprintf(file, "# unfolding actuator calibration\n");
+  fprintf(file, "# drv <motor> <A_CAL_COMP> <A_CAL_BEMF> <FB_CON> "
+                "<LRA_RESON>\n");
+  fprintf(file, "version %i\n", version);
+  fprintf(file, "fingerprint %08x\n", hardware);
+  for (int i = 0; i < size(); i++) {
+    const Drv &d = drvs[i];
+    fprintf(file, "drv %i %u %u %u %u\n", i, d.compensation, d.backEmf,
+            d.feedback, d.resonance);
+  }
+  bool ok = fclose(file) == 0 && rename(tmpPath.c_str(), path.c_str()) == 0;
+  if (!ok) {
+    printf("can't write the calibration to %s\n", path.c_str());
+  }
+  return ok;
+}
+
+//________________________________________________
+void CalibrationCache::assign(uint32_t fingerprint,
+                              const std::vector<Drv> &values) {
+  hardware = fingerprint;
+  drvs = values;
+}
+
+//________________________________________________
+bool CalibrationCache::drifted(int motor, uint8_t resonance) const {
+  int calibrated = drvs[motor].resonance;
+  return abs(resonance - calibrated) > calibrated * maxResonanceDrift;
+}
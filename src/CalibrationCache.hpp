@@ -0,0 +1,66 @@
+#pragma once
+
+//----------------------------------------------------------------------
+// INCLUDES
+//----------------------------------------------------------------------
+#include <stdint.h>
+
+#include <string>
+#include <vector>
+
+#include "ActuatorLayout.hpp"
+
+//****************************************************************
+//                      CALIBRATION CACHE
+//****************************************************************
+// The results of the last successful auto calibration of every DRV2605
+// (A_CAL_COMP, A_CAL_BEMF, FB_CON and the LRA_RESON measured with them),
+// kept in a small text file so the startup can write them back instead of
+// calibrating again. The file carries a format version and a fingerprint
+// of the layout and the drivers that answer (motor count, TCA channels,
+// device IDs of the DRVs), a file that doesn't match both is ignored. The
+// fingerprint only tells whether the same layout and the same kind of
+// driver are present: the device ID is the same on every DRV2605L, so the
+// file of another glove of the same layout, or of swapped actuators, gets
+// applied too. Such actuators are caught by the drift check of the
+// resonance (MotorBoard::checkCalibration()) once they vibrated.
+//
+//   # unfolding actuator calibration
+//   version 1
+//   fingerprint 5c1ee3a9
+//   drv <motor> <A_CAL_COMP> <A_CAL_BEMF> <FB_CON> <LRA_RESON>
+
+class CalibrationCache {
+public:
+  static const int version = 1;
+  // LRA_RESON may differ by this fraction before the calibration is redone
+  static constexpr float maxResonanceDrift = 0.05f;
+
+  struct Drv {
+    uint8_t compensation; // A_CAL_COMP
+    uint8_t backEmf;      // A_CAL_BEMF
+    uint8_t feedback;     // FB_CON
+    uint8_t resonance;    // LRA_RESON (period, 98.46 us steps)
+  };
+
+  // layout and DRV device IDs (STATUS bits 7:5) behind its motors, 0xFF
+  // for a driver that doesn't answer. Not unique per glove.
+  static uint32_t fingerprint(const ActuatorLayout &layout,
+                              const uint8_t deviceIds[]);
+
+  // false (and empty) if there is no file or its fingerprint differs
+  bool load(const std::string &path, uint32_t fingerprint, int motors);
+  bool save(const std::string &path) const;
+  void assign(uint32_t fingerprint, const std::vector<Drv> &values);
+  void clear() { drvs.clear(); }
+
+  bool valid() const { return !drvs.empty(); }
+  int size() const { return (int)drvs.size(); }
+  const Drv &operator[](int motor) const { return drvs[motor]; }
+  // the actuator's resonance moved away from the calibrated one
+  bool drifted(int motor, uint8_t resonance) const;
+
+private:
+  uint32_t hardware = 0;
+  std::vector<Drv> drvs;
+};
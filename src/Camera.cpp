@@ -1,9 +1,7 @@
 /* INFO
- * DepthDataListener::onNewData() callback function that gets called from
- * libroyale lib whenever a new depth data frame is ready.
  * DepthDataUtilities::processData() that processes new incoming frames to th
- * 3x3 output matrix for the glove
- * And som other camera / libroyale helper functions
+ * motor values of the glove (3x3 or any other actuator layout)
+ * The frames come from a FrameSource (live camera or replay).
  */
 
 //----------------------------------------------------------------------
@@ -11,11 +9,13 @@
 //----------------------------------------------------------------------
 #include "Camera.hpp"
 
+#include <algorithm>
 #include <array>
 #include <chrono>
+#include <cstdlib>
+#include <cstring>
 #include <iostream>
 #include <mutex>
-#include <royale/IEvent.hpp>
 #include <string> // std::string, std::to_string
 
 #include "Globals.hpp"
@@ -25,191 +25,196 @@
 using std::cerr;
 using std::cout;
 using std::endl;
-using namespace royale;
 using namespace std::chrono;
 
 //----------------------------------------------------------------------
 // DECLARATIONS AND VARIABLES
 //----------------------------------------------------------------------
-const int minObjSizeThresh = 90; // the min number of pixels, an object must
-                                 // have (smaller objects might be noise)
 float maxDepth = 2;              // The depth of viewing range.
                                  // Objects with bigger distance to camera
                                  // are ignored.
 
-//
-/******************************************************************************
- *                                 ON NEW DATA
- *                               ***************
- * gets called everytime there is a new depth frame from the Pico Flexx
- * As this is a callback function and the code is unknown we want it to
- * return as fast as possible. Therefore it only copies the data and
- * returns immidiately when the preceding frame is not yet copied.
- ******************************************************************************/
-void DepthDataListener::onNewData(const DepthData *data) {
-  Glob::logger.newDataLog.reset();
-  Glob::logger.newDataLog.store("onNewData");
-  Glob::logger.pauseLog.store("endPause");
-  Glob::logger.mainLogger.reset();
-  Glob::logger.mainLogger.store("start");
-  Glob::logger.mainLogger.store("startOnNew");
-  int multiLock = try_lock(Glob::royalDepthData.mut, Glob::notifyProcess.mut);
-  // when lock was successfull
-  if (multiLock == -1) {
-    Glob::logger.mainLogger.store("tryLocks");
-    // simply copy data to shared memory
-    Glob::royalDepthData.dat = *data;
-    Glob::logger.mainLogger.store("copy");
-    // set variable for predicate check in other thread
-    Glob::notifyProcess.flag = true;
-    Glob::royalDepthData.mut.unlock();
-    Glob::notifyProcess.mut.unlock();
-
-  } else {
-    // if onNewData fails to unlock the mutex it returns instantly
-    Glob::a_lockFailCounter++;
-    // cout << "failed locks:" << Glob::a_lockFailCounter
-    //      << " last is: " << multiLock << "\n";
-    if (multiLock == 0) {
-      Glob::notifyProcess.mut.unlock();
-    }
-    if (multiLock == 1) {
-      Glob::royalDepthData.mut.unlock();
-    }
-  }
-
-  Glob::logger.mainLogger.store("unlock");
-  // wake other thread
-  Glob::notifyProcess.cond.notify_one();
-  Glob::logger.mainLogger.store("notifyProcessing");
-}
-//                                    _____
-//                                 [onNewData]
-//____________________________________________________________________________
-
 /******************************************************************************
  *                                PROCESS DATA
  *                               ***************
- * Create depth Image (Glob::cvDepthImg.mat) and calculate the 9 tiles of it
- *from which the 9 vibration motors get their vibration strength value
- *(Glob::motors.tiles)
+ * Create depth Image (Glob::cvDepthImg.mat) and calculate the value of every
+ *vibration motor of the actuator layout (Glob::motors.tiles) from the
+ *closest object in its region. Each motor is passed on to the sending thread
+ *as soon as its region is done.
  ******************************************************************************/
 void DepthDataUtilities::processData() {
   Glob::logger.mainLogger.store("startProcess");
-  int histo[9][256]; // historgram, needed to find closest obj
-  // Lock Mutex for copied Data and the Glob::cvDepthImg.mat
+  // get the freshest frame. It stays untouched by the frame source until the
+  // next acquire, so no locking is needed while reading it.
+  const DepthFrame *frame = Glob::frameMailbox.acquire();
+  if (frame == nullptr) {
+    return; // nothing new
+  }
+  const uint32_t traceId = frame->traceId;
+  Glob::tracer.mark(traceId, FrameTracer::PROCESS_START);
+  // check dimensions of incoming data
+  int width = frame->width();   // get width from depth image
+  int height = frame->height(); // get height from depth image
+  // scope for mutex
   {
-    royale::DepthData *data;
-    {
-      std::lock_guard<std::mutex> depDataLock(Glob::royalDepthData.mut);
-      data = &Glob::royalDepthData.dat; // set a pointer to the copied data
-    }
-    // check dimensions of incoming data
-    int width = data->width;         // get width from depth image
-    int height = data->height;       // get height from depth image
-    int tileWidth = width / 3 + 1;   // respectiveley width of one tile
-    int tileHeight = height / 3 + 1; // respectiveley height of one tile
-    // scope for mutex
-    {
-      std::lock_guard<std::mutex> dcDataLock(Glob::cvDepthImg.mut);
-      Glob::cvDepthImg.mat.create(cv::Size(width, height),
-                                  CV_8UC1); // gets filled later
-    }
+    std::lock_guard<std::mutex> dcDataLock(Glob::cvDepthImg.mut);
+    Glob::cvDepthImg.mat.create(cv::Size(width, height),
+                                CV_8UC1); // gets filled later
+    depImgPtr = Glob::cvDepthImg.mat.ptr<uchar>(0);
+    depImgStep = Glob::cvDepthImg.mat.step;
+  }
 
-    bzero(histo, sizeof(int) * 9 * 256); // clear histogram array
-    Glob::logger.mainLogger.store("bf");
+  // the pixel -> motor table only depends on the layout and the frame size:
+  // one lookup per run of pixels instead of divisions per pixel
+  bool remapped = actuators.prepare(Glob::layout, width, height);
+  int motorCount = actuators.motorCount();
+  if (remapped) {
+    // known camera resolution + grid layout -> use the kernel instantiated
+    // for it (compile-time tile borders), else the generic one per run
+    int cols = actuators.gridColumns();
+    rowKernel = cols > 0 && kernel.selectRowKernel(width, cols);
+    printf("depth kernel: %s, %s\n", kernel.name(),
+           rowKernel ? "specialized for this resolution" : "generic");
+  }
+  kernel.setMaxDepth(maxDepth);
+  // (re)create the worker pool if the number of workers changed
+  int workers = Glob::modes.a_workers;
+  if (workers < 1) {
+    workers = WorkerPool::autoDetect();
+  }
+  if (workers > 1 && (!pool || pool->size() != workers)) {
+    pool.reset(new WorkerPool(workers));
+  } else if (workers == 1) {
+    pool.reset();
+  }
+  int bands = pool ? pool->size() : 1;
+  if ((int)bandHisto.size() < bands) {
+    bandHisto.resize(bands);
+  }
+  for (int band = 0; band < bands; band++) {
+    // all motors + the histogram masked pixels get counted into
+    bandHisto[band].resize(motorCount + 1);
+  }
 
-    // READING DEPTH IMAGE pixel by pixel
-    for (int y = 0; y < height; y++) {
-      unsigned char *depImgPtr;
-      {
-        std::lock_guard<std::mutex> dcDataLock(Glob::cvDepthImg.mut);
-        depImgPtr = Glob::cvDepthImg.mat.ptr<uchar>(y);
-      }
-      for (int x = 0; x < width; x++) {
-        // save currently observed pixel in curPoint
-        auto curPoint = data->points.at(y * width + x);
-        // check its validity (if bigger than 10 -> valid)
-        bool valid = curPoint.depthConfidence > 10;
-        // select the respective tile
-        int tileIdx = (x / tileWidth) + 3 * (y / tileHeight);
+  // INCREMENTAL MODE: only update the histograms with blocks that changed
+  // more than the tolerance. All histograms get rebuilt from scratch (full
+  // frame) if the stored ones don't fit this frame or once in a while.
+  changeTol = Glob::modes.a_changeTol; // -1: incremental mode is off
+  bool incremental = changeTol >= 0;
+  bool full = !incremental || remapped || bands != lastBands ||
+              maxDepth != lastMaxDepth ||
+              framesSinceFull >= fullFrameInterval;
+  if (!incremental) {
+    framesSinceFull = fullFrameInterval; // start with a full frame
+  } else if (full) {
+    prevBins.resize((size_t)width * height);
+    framesSinceFull = 0;
+    lastBands = bands;
+    lastMaxDepth = maxDepth;
+  } else {
+    framesSinceFull++;
+  }
+  bandBins.resize(bands);
+  bandChanges.assign(bands, BandChanges{0, 0});
+  int skippedSearches = 0;
+  Glob::logger.mainLogger.store("bf");
 
-        // WRITE VALID PIXELS in DepImg and histogram
-        if (valid) {
-          unsigned char depth =
-              maxDepth > 0
-                  ? (curPoint.z <= maxDepth
-                         ? (unsigned char)(curPoint.z / maxDepth * 255.0f)
-                         : 255)
-                  : 255;
-          // HERE the costly stuff begins: copiing values in histogram and
-          // save this pixel's depth value in histo
-          histo[tileIdx][depth]++;
-          // if pixel is in range put the right grey tone
-          if (depth < 255) {
-            // create a Hue value from 0-180 for the visual output
-            depImgPtr[x] = depth;
-          }
-          // if pixel is out of –> make it white / invisible
-          else {
-            depImgPtr[x] = 255;
+  // STREAM the frame segment by segment: as soon as all rows of a motor's
+  // region are processed, its value is handed to the sending thread, which
+  // writes it to the glove while the rest of the frame gets processed.
+  int segStart = 0;
+  bool firstSeg = true;
+  for (const ActuatorMap::Segment &seg : actuators.segments()) {
+    int rowStart = segStart;
+    int rowEnd = seg.rowEnd;
+    segStart = seg.rowEnd;
+    // READING DEPTH IMAGE in row bands - one per worker. Every band writes
+    // its own rows of the depth image and its own histograms.
+    auto processBand = [&](int band) {
+      if (firstSeg && full) {
+        for (auto &motorHisto : bandHisto[band]) {
+          for (auto &lane : motorHisto) {
+            lane.fill(0); // clear histogram arrays
           }
         }
-        // If pixel is not valid –> make it gray
-        else {
-          depImgPtr[x] = 230;
-          histo[tileIdx][255]++; // treat unvalid pixel as 255 = "out of range"
-        }
       }
+      int rows = rowEnd - rowStart;
+      int y0 = rowStart + rows * band / bands;
+      int y1 = rowStart + rows * (band + 1) / bands;
+      if (!full) {
+        updateRows(*frame, y0, y1, bandHisto[band], bandBins[band],
+                   bandChanges[band]);
+        return;
+      }
+      processRows(*frame, y0, y1, bandHisto[band]);
+      if (incremental) {
+        storeRows(*frame, y0, y1); // the base for the next frames
+      }
+    };
+    if (pool) {
+      pool->run(processBand);
+    } else {
+      processBand(0);
     }
-  }
-  Glob::logger.mainLogger.store("aft for");
+    firstSeg = false;
 
-  {
-    // FIND CLOSEST object in each tile
-    for (int tileIdx = 0; tileIdx < 9; tileIdx++) {
-      int sum = 0;
-      int val = 0;
-      int offset = 14; // exclude the first 17cm because of oversaturation
-                       // issues and noisy data the Pico Flexx has in this range
-      int range = 50;  // look in a tolerance range of 50cm
-      int pixelThresh = 5; // part of the smoothing process. There are better
-                           // ways to do that!
-      // These lines may sound a bit weird. Should be written in a more
-      // understandable way, but are technically ok. Generally a "sliding
-      // window"
-      // go through all bins of the histo
-      for (int i = offset; i < 256; i++) {
-        // ignore if there are just a few (< pixelThresh) pixels
-        if (histo[tileIdx][i] > pixelThresh) {
-          // add them to sum
-          sum += histo[tileIdx][i];
-        }
-        // when exceeding this value always substract first value from window
-        // (if it has been added in the first place)
-        if (i > range + offset) {
-          if (histo[tileIdx][i - range] > pixelThresh) {
-            sum -= histo[tileIdx][i - range];
+    uint16_t searchMask = 0; // motors to search an object for
+    uint16_t changed = 0;
+    for (int band = 0; band < bands; band++) {
+      changed |= bandChanges[band].motors;
+    }
+    for (int motorIdx = 0; motorIdx < motorCount; motorIdx++) {
+      if (!(seg.done & (1 << motorIdx))) {
+        continue;
+      }
+      // same histogram as in the last frame -> same value
+      if (!full && !(changed & (1 << motorIdx))) {
+        skippedSearches++;
+        continue;
+      }
+      if (actuators.pixelCount(motorIdx) == 0) {
+        // motor without any pixels (masked) stays off
+        std::lock_guard<std::mutex> lock(Glob::motors.mut);
+        Glob::motors.tiles[motorIdx] = 0;
+        continue;
+      }
+      // merge the per-band and per-lane sub-histograms
+      int histo[256]; // historgram, needed to find closest obj
+      for (int i = 0; i < 256; i++) {
+        int sum = 0;
+        for (int band = 0; band < bands; band++) {
+          for (auto &lane : bandHisto[band][motorIdx]) {
+            sum += lane[i];
           }
         }
-        // if the sum exceeds the minObjSizeThresh, we guess that there is an
-        // object. Take the value of the beginning of the sliding window
-        if (sum >= minObjSizeThresh) { // if minObjSizeThresh is exeeded: break.
-          // i now holds the depth for this tile
-          val = i;
-          break;
-        }
+        histo[i] = sum;
       }
-      // WRITE the value in the Tile Matrix:
-      // Here two modification have to be done to have
-      // the right visual orientation (flip, turn)
-      int tileVal = (val - 255) * -1;
-      // Scope for Mutex
-      {
+      search.setHistogram(motorIdx, histo);
+      searchMask |= 1 << motorIdx;
+    }
+    // FIND CLOSEST object of all these motors at once
+    int val[DepthSearch::maxMotors];
+    search.nearest(searchMask, val);
+    for (int motorIdx = 0; motorIdx < motorCount; motorIdx++) {
+      if (searchMask & (1 << motorIdx)) {
+        int tileVal = (val[motorIdx] - 255) * -1;
+        // Scope for Mutex
         std::lock_guard<std::mutex> lock(Glob::motors.mut);
-        Glob::motors.tiles[(tileIdx - 8) * -1] = tileVal;
+        Glob::motors.tiles[motorIdx] = tileVal;
+      }
+    }
+    // queue the finished motors for the sending thread (the inline mode
+    // only hands over whole frames)
+    if (seg.done && !Glob::modes.a_inline) {
+      {
+        std::lock_guard<std::mutex> svCondLock(Glob::notifySend.mut);
+        Glob::notifySend.a_pendingMotors |= seg.done;
+        Glob::notifySend.segmentFrame = traceId;
+        Glob::notifySend.handoff.give();
       }
+      Glob::notifySend.cond.notify_one();
     }
+    Glob::logger.mainLogger.store("segment");
   }
   Glob::logger.mainLogger.store("aft his");
   Glob::counters.frameCounter++; // counting every frame
@@ -218,84 +223,180 @@ void DepthDataUtilities::processData() {
     std::lock_guard<std::mutex> lock(Glob::udpServMux);
     int tempFrameCounter = Glob::counters.frameCounter;
     Glob::udpServer.preparePacket("frameCounter", tempFrameCounter);
+    if (incremental) {
+      // how much of this frame the incremental mode skipped
+      int skippedPixels = 0;
+      for (int band = 0; band < bands; band++) {
+        skippedPixels += bandChanges[band].skippedPixels;
+      }
+      int skipPercent = 100 * skippedPixels / (width * height);
+      Glob::udpServer.preparePacket("skipPix", skipPercent);
+      Glob::udpServer.preparePacket("skipSearch", skippedSearches);
+    }
   }
   Glob::logger.mainLogger.store("endProcess");
-  // call sending thread
-  {
-    std::lock_guard<std::mutex> svCondLock(Glob::notifySend.mut);
-    Glob::notifySend.flag = true;
+  Glob::tracer.mark(traceId, FrameTracer::PROCESS_END);
+  if (Glob::modes.a_inline) {
+    // hand the values to the sending thread through the lock-free slot
+    MotorFrame &out = Glob::motorMailbox.writeSlot();
+    {
+      std::lock_guard<std::mutex> lock(Glob::motors.mut);
+      memcpy(out.values, Glob::motors.tiles, motorCount);
+    }
+    out.count = motorCount;
+    out.traceId = traceId;
+    // hand it over before it can be seen (so it can't get taken before)
+    Glob::notifySend.handoff.give();
+    Glob::motorMailbox.publish();
+    // wake the sending thread. It holds the mutex only while it checks the
+    // slot, taking it once makes sure the wakeup can't get lost in between
+    // its check and its wait.
+    { std::lock_guard<std::mutex> svCondLock(Glob::notifySend.mut); }
+    Glob::notifySend.cond.notify_one();
+  } else {
+    // call sending thread: the whole frame is done
+    {
+      std::lock_guard<std::mutex> svCondLock(Glob::notifySend.mut);
+      Glob::notifySend.flag = true;
+      Glob::notifySend.doneFrame = traceId;
+      Glob::notifySend.handoff.give();
+    }
+    // wake other thread
+    Glob::notifySend.cond.notify_one();
+  }
+  // RECORDING (--record): copy the frame into the recorder's ring buffer.
+  // Only after the motor values are handed over, so it doesn't add to the
+  // latency. The frame stays valid until the next acquire.
+  if (Glob::recorder.isRecording()) {
+    Glob::recorder.recordFrame(*frame);
   }
-  // Glob::logger.mainLogger.store("lock");
-  // Glob::logger.mainLogger.store("copy");
-
-  // Glob::logger.mainLogger.store("unlock");
-  // wake other thread
-  Glob::notifySend.cond.notify_one();
 }
 //                                    _____
 //                                [process data]
 //____________________________________________________________________________
 
-/******************************************************************************
- *                                   OTHER
- ******************************************************************************/
+//________________________________________________
+float DepthDataUtilities::viewingRange() { return maxDepth; }
+
+//________________________________________________
+// Run the depth kernel over the rows y0..y1-1: writes these rows of the depth
+// image and counts their pixels into the histograms of their motors
+void DepthDataUtilities::processRows(const DepthFrame &frame, int y0, int y1,
+                                     std::vector<DepthKernel::SubHisto> &histo) {
+  int masked = actuators.motorCount(); // index of the masked pixels' histo
+  for (int y = y0; y < y1; y++) {
+    const uint16_t *depthRow = frame.depthRow(y);
+    const uint8_t *confRow = frame.confRow(y);
+    // mask, quantize and write the image + histograms for each run of pixels
+    // that belong to the same motor
+    unsigned char *imgRow = depImgPtr + y * depImgStep;
+    if (rowKernel) {
+      // one run per tile, borders known at compile time
+      DepthKernel::SubHisto *rowHisto[ActuatorLayout::maxMotors];
+      int col = 0;
+      for (const ActuatorMap::Run *run = actuators.rowBegin(y);
+           run != actuators.rowEnd(y); run++) {
+        rowHisto[col++] = &histo[run->motor];
+      }
+      kernel.processRow(depthRow, confRow, imgRow, rowHisto);
+      continue;
+    }
+    for (const ActuatorMap::Run *run = actuators.rowBegin(y);
+         run != actuators.rowEnd(y); run++) {
+      int x0 = run->x0;
+      int motor = run->motor == ActuatorMap::skip ? masked : run->motor;
+      kernel.processSpan(depthRow + x0, confRow + x0, run->x1 - x0,
+                         imgRow + x0, histo[motor]);
+    }
+  }
+}
 
-void EventReporter::onEvent(std::unique_ptr<royale::IEvent> &&event) {
-  royale::EventSeverity severity = event->severity();
-  switch (severity) {
-  case royale::EventSeverity::ROYALE_INFO:
-    // cerr << "info: " << event->describe() << endl;
-    extractDrops(event->describe());
-    break;
-  case royale::EventSeverity::ROYALE_WARNING:
-    // cerr << "warning: " << event->describe() << endl;
-    extractDrops(event->describe());
-    break;
-  case royale::EventSeverity::ROYALE_ERROR:
-    cerr << "error: " << event->describe() << endl;
-    break;
-  case royale::EventSeverity::ROYALE_FATAL:
-    cerr << "fatal: " << event->describe() << endl;
-    break;
-  default:
-    // cerr << "waits..." << event->describe() << endl;
-    break;
+//________________________________________________
+// Incremental mode: store the bins of the rows y0..y1-1 of a full frame as the base the next frames get compared to
+void DepthDataUtilities::storeRows(const DepthFrame &frame, int y0, int y1) {
+  int width = frame.width();
+  for (int y = y0; y < y1; y++) {
+    for (const ActuatorMap::Run *run = actuators.rowBegin(y);
+         run != actuators.rowEnd(y); run++) {
+      int x0 = run->x0;
+      int n = run->x1 - x0;
+      uint8_t *prev = &prevBins[y * width + x0];
+      kernel.binSpan(frame.depthRow(y) + x0, frame.confRow(y) + x0, n, prev);
+    }
   }
 }
+
 //________________________________________________
-// Royale Event Listener reports dropped frames as string.
-// This functions extracts the number of frames that got lost at Bridge/FC.
-// I believe, that dropped frames cause instability – PMDtec confirmed this
-void EventReporter::extractDrops(royale::String str) {
-  using namespace std;
-  stringstream ss;
-  /* Storing the whole string into string stream */
-  ss << str;
-  /* Running loop till the end of the stream */
-  string temp;
-  int found;
-  int i = 0;
-  while (!ss.eof()) {
-    /* extracting word by word from stream */
-    ss >> temp;
-    /* Checking the given word is integer or not */
-    if (stringstream(temp) >> found) {
-      if (i == 0) {
-        std::lock_guard<std::mutex> lock(Glob::udpServMux);
-        Glob::udpServer.preparePacket("drpBridge", found);
-        Glob::udpServer.preparePacket("drpFC", found);
-        Glob::udpServer.preparePacket("delivFrames", found);
+// Incremental mode: compare every block of the rows y0..y1-1 with the last
+// frame. Only blocks with at least one pixel more than the tolerance away
+// from its stored bin get their old bins removed from the histograms and the new ones added (in the same lane as
+// processSpan() counted them). Everything else, image included, stays.
+void DepthDataUtilities::updateRows(const DepthFrame &frame, int y0, int y1,
+                                    std::vector<DepthKernel::SubHisto> &histo,
+                                    std::vector<uint8_t> &bins,
+                                    BandChanges &changes) {
+  int tol = changeTol;
+  int width = frame.width();
+  int masked = actuators.motorCount();
+  bins.resize(width);
+  for (int y = y0; y < y1; y++) {
+    const uint16_t *depthRow = frame.depthRow(y);
+    const uint8_t *confRow = frame.confRow(y);
+    unsigned char *imgRow = depImgPtr + y * depImgStep;
+    for (const ActuatorMap::Run *run = actuators.rowBegin(y);
+         run != actuators.rowEnd(y); run++) {
+      int x0 = run->x0;
+      int n = run->x1 - x0;
+      uint8_t *prev = &prevBins[y * width + x0];
+      kernel.binSpan(depthRow + x0, confRow + x0, n, bins.data());
+      // compared bin by bin against the stored bins, not against a summary
+      // of the block: a sum can't tell (+1 / -2 / +1 on neighbouring pixels
+      // keeps it), and a single pixel of a thin near obstacle has to get
+      // through however small it is. prev only moves when a block gets
+      // committed, so the error never grows beyond tol bins per pixel.
+      if (tol == 0 ? memcmp(bins.data(), prev, n) == 0
+                   : maxDifference(bins.data(), prev, n) <= tol) {
+        changes.skippedPixels += n;
+        continue;
+      }
+      int motor = run->motor == ActuatorMap::skip ? masked : run->motor;
+      DepthKernel::SubHisto &h = histo[motor];
+      const uint8_t *conf = confRow + x0;
+      unsigned char *img = imgRow + x0;
+      for (int x = 0; x < n; x++) {
+        uint8_t bin = bins[x];
+        if (bin != prev[x]) {
+          h[x % DepthKernel::histoLanes][prev[x]]--;
+          h[x % DepthKernel::histoLanes][bin]++;
+          prev[x] = bin;
+        }
+        img[x] = conf[x] > DepthKernel::confidenceThresh
+                     ? bin
+                     : DepthKernel::invalidPixel;
+      }
+      if (motor != masked) {
+        changes.motors |= 1 << motor;
       }
-      i++;
     }
-    /* To save from space at the end of string */
-    temp = "";
   }
-  // {std::lock_guard<std::mutex> lock(Glob::udpServMux);
-  // Glob::udpServer.preparePacket("11", tenSecsDrops);}
-  // tenSecsDrops += droppedAtBridge + droppedAtFC;
 }
 
+//________________________________________________
+// Largest difference between two bins of the same pixel of two blocks (no
+// early exit, so the loop vectorizes)
+int DepthDataUtilities::maxDifference(const uint8_t *bins, const uint8_t *prev,
+                                      int n) {
+  int worst = 0;
+  for (int x = 0; x < n; x++) {
+    worst = std::max(worst, std::abs(bins[x] - prev[x]));
+  }
+  return worst;
+}
+
+/******************************************************************************
+ *                                   OTHER
+ ******************************************************************************/
+
 cv::Mat DepthDataUtilities::getResizedDepthImage(int incSize) {
   std::lock_guard<std::mutex> lock(Glob::cvDepthImg.mut);
   cv::Mat sizedImgCopy;
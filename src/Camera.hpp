@@ -5,46 +5,71 @@
 //----------------------------------------------------------------------
 #include <string.h>
 
+#include <chrono>
 #include <condition_variable>
 #include <mutex>
 #include <opencv2/opencv.hpp>
-#include <royale.hpp>
-#include <royale/IEvent.hpp>
 #include <thread>
+#include <vector>
 
+#include "ActuatorLayout.hpp"
+#include "DepthFrame.hpp"
+#include "DepthKernel.hpp"
+#include "DepthSearch.hpp"
 #include "TimeLogger.hpp"
+#include "WorkerPool.hpp"
 
 using namespace std::chrono;
 
 //----------------------------------------------------------------------
 // CLASSES
 //----------------------------------------------------------------------
-class DepthDataListener : public royale::IDepthDataListener {
+class DepthDataUtilities {
 public:
-  void onNewData(const royale::DepthData *data);
   void processData();
-  void setLensParameters(const royale::LensParameters &lensParameters);
+  cv::Mat getResizedDepthImage(int);
+  // objects further away (in m) are ignored
+  static float viewingRange();
+  // incremental mode: all histograms get rebuilt every n frames, so pixels
+  // within the tolerance get their current bins again
+  static const int fullFrameInterval = 50;
 
 private:
-  uint8_t adjustDepthValue(float zValue, float max);
-  float adjustDepthValueForImage(float zValue, float max);
-};
-
-//________________________________________________
-// Gets called by Royale irregularily.
-// Holds the camera state, errors and info about drops
-class EventReporter : public royale::IEventListener {
-public:
-  virtual ~EventReporter() = default;
+  // per band results of the incremental mode
+  struct BandChanges {
+    uint16_t motors; // motors with at least one changed block
+    int skippedPixels;
+  };
 
-  virtual void onEvent(std::unique_ptr<royale::IEvent> &&event) override;
-
-private:
-  void extractDrops(royale::String str);
-};
+  void processRows(const DepthFrame &frame, int y0, int y1,
+                   std::vector<DepthKernel::SubHisto> &histo);
+  void updateRows(const DepthFrame &frame, int y0, int y1,
+                  std::vector<DepthKernel::SubHisto> &histo,
+                  std::vector<uint8_t> &bins, BandChanges &changes);
+  void storeRows(const DepthFrame &frame, int y0, int y1);
+  static int maxDifference(const uint8_t *bins, const uint8_t *prev, int n);
 
-class DepthDataUtilities {
-public:
-  void processData();
-  cv::Mat getResizedDepthImage(int);
+  DepthKernel kernel;
+  bool rowKernel = false; // kernel specialized for this frame geometry
+  // which pixel belongs to which motor, for the current resolution
+  ActuatorMap actuators;
+  // nearest object search on the merged histograms
+  DepthSearch search;
+  // threads processing row bands in parallel (none if only one worker)
+  std::unique_ptr<WorkerPool> pool;
+  // per-lane sub-histograms of all motors (+ one for masked pixels) for
+  // every band, merged when a motor is done
+  std::vector<std::vector<DepthKernel::SubHisto>> bandHisto;
+  // INCREMENTAL MODE: the histograms are kept from frame to frame and only
+  // blocks that changed are subtracted (with their bins of the previous
+  // frame) and added again. Motors without changed blocks keep their value.
+  std::vector<uint8_t> prevBins;            // bins of the last frame
+  std::vector<std::vector<uint8_t>> bandBins; // scratch row of every band
+  std::vector<BandChanges> bandChanges;
+  int changeTol = -1;       // in bins, -1: incremental mode off
+  int framesSinceFull = 0;  // frames since the histograms were rebuilt
+  float lastMaxDepth = 0;   // viewing range the histograms were built for
+  int lastBands = 0;        // band split the histograms were built for
+  unsigned char *depImgPtr = nullptr;
+  size_t depImgStep = 0;
 };
\ No newline at end of file
@@ -0,0 +1,198 @@
+/* INFO
+ * Real and virtual time (see Clock.hpp).
+ */
+
+//----------------------------------------------------------------------
+// INCLUDES
+//----------------------------------------------------------------------
+#include "Clock.hpp"
+
+#include <stdint.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <map>
+#include <mutex>
+#include <thread>
+
+using namespace std::chrono;
+
+//----------------------------------------------------------------------
+// DECLARATIONS AND VARIABLES
+//----------------------------------------------------------------------
+// real time without any progress after which virtual time moves on anyway
+const auto stallTimeout = milliseconds(100);
+
+namespace {
+
+struct Sleeper {
+  bool participant;
+  bool woken;
+};
+
+std::atomic<bool> a_virtual{false};
+std::atomic<int64_t> a_virtualNs{0};
+
+// state of the virtual time, guarded by mut (which is always taken last)
+std::mutex mut;
+std::condition_variable tick;
+std::multimap<int64_t, Sleeper *> sleepers; // by wake-up
+int participants = 0;
+int waiting = 0;  // participants sleeping or idle
+int handoffs = 0; // given, not taken yet
+long progress = 0;
+thread_local bool isParticipant = false;
+
+Clock::time_point realNow() {
+  return Clock::time_point(
+      duration_cast<Clock::duration>(steady_clock::now().time_since_epoch()));
+}
+
+// the first call happens during static initialization (see below)
+Clock::time_point startTime() {
+  static const Clock::time_point start = realNow();
+  return start;
+}
+const Clock::time_point initStart = startTime();
+
+//________________________________________________
+// Jump to the next wake-up (and wake who's due) as long as no participant
+// runs and nothing got handed over. `force`: one jump regardless (stall).
+// Call with mut held.
+void advance(bool force) {
+  while (!sleepers.empty() &&
+         (force || (waiting >= participants && handoffs == 0))) {
+    force = false;
+    if (sleepers.begin()->first > a_virtualNs) {
+      a_virtualNs = sleepers.begin()->first;
+    }
+    while (!sleepers.empty() && sleepers.begin()->first <= a_virtualNs) {
+      Sleeper *sleeper = sleepers.begin()->second;
+      sleeper->woken = true;
+      if (sleeper->participant) {
+        waiting--;
+      }
+      sleepers.erase(sleepers.begin());
+    }
+    progress++;
+    tick.notify_all();
+  }
+}
+
+} // namespace
+
+//----------------------------------------------------------------------
+// METHODS
+//----------------------------------------------------------------------
+Clock::time_point Clock::now() noexcept {
+  if (a_virtual) {
+    return time_point(duration(a_virtualNs.load()));
+  }
+  return realNow();
+}
+
+unsigned int Clock::millis() {
+  return duration_cast<milliseconds>(now() - startTime()).count();
+}
+
+void Clock::sleepFor(duration d) { sleepUntil(now() + d); }
+
+//________________________________________________
+// Virtual time: the sleeper waits for the clock to get there. Who comes to
+// sleep last (no participant running any more) moves it on.
+void Clock::sleepUntil(time_point t) {
+  if (!a_virtual) {
+    std::this_thread::sleep_until(steady_clock::time_point(
+        duration_cast<steady_clock::duration>(t.time_since_epoch())));
+    return;
+  }
+  std::unique_lock<std::mutex> lock(mut);
+  int64_t ns = t.time_since_epoch().count();
+  if (ns <= a_virtualNs) {
+    return;
+  }
+  Sleeper self = {isParticipant, false};
+  sleepers.insert({ns, &self});
+  if (self.participant) {
+    waiting++;
+  }
+  progress++;
+  advance(false);
+  while (!self.woken) {
+    long seen = progress;
+    if (tick.wait_for(lock, stallTimeout) == std::cv_status::timeout &&
+        !self.woken && progress == seen) {
+      advance(true);
+    }
+  }
+}
+
+//________________________________________________
+void Clock::useVirtualTime() {
+  a_virtualNs = realNow().time_since_epoch().count();
+  a_virtual = true;
+}
+
+bool Clock::isVirtual() { return a_virtual; }
+
+//________________________________________________
+void Clock::addParticipant() {
+  std::lock_guard<std::mutex> lock(mut);
+  participants++;
+}
+
+Clock::Participant::Participant() { isParticipant = true; }
+
+Clock::Participant::~Participant() {
+  std::lock_guard<std::mutex> lock(mut);
+  isParticipant = false;
+  participants--;
+  progress++;
+  advance(false);
+}
+
+//________________________________________________
+Clock::Idle::Idle() : counted(a_virtual && isParticipant) {
+  if (!counted) {
+    return;
+  }
+  std::lock_guard<std::mutex> lock(mut);
+  waiting++;
+  progress++;
+  advance(false);
+}
+
+Clock::Idle::~Idle() {
+  if (!counted) {
+    return;
+  }
+  std::lock_guard<std::mutex> lock(mut);
+  waiting--;
+  progress++;
+}
+
+//________________________________________________
+void Clock::Handoff::give() {
+  if (!a_virtual) {
+    return;
+  }
+  std::lock_guard<std::mutex> lock(mut);
+  if (!given) {
+    given = true;
+    handoffs++;
+    progress++;
+  }
+}
+
+// the receiver runs: no need to check if the clock can move on
+void Clock::Handoff::take() {
+  if (!a_virtual) {
+    return;
+  }
+  std::lock_guard<std::mutex> lock(mut);
+  if (given) {
+    given = false;
+    handoffs--;
+    progress++;
+  }
+}
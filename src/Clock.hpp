@@ -0,0 +1,77 @@
+#pragma once
+
+//----------------------------------------------------------------------
+// INCLUDES
+//----------------------------------------------------------------------
+#include <chrono>
+
+//****************************************************************
+//                             CLOCK
+//****************************************************************
+// The time of the app: everything that reads the time or waits for it
+// (delays, timeouts, the pacing of replays, the TimeLoggers) goes through
+// here. Meets the standard's Clock requirements, so duration_cast and
+// time_point arithmetic work like with the steady_clock.
+//
+// Real time (default) is the steady_clock and sleeping.
+// Virtual time (--virtualTime) only moves on while the threads driving the
+// pipeline (Participants) all wait: for the clock, or for work another
+// participant hands over (Idle / Handoff). Then it jumps right to the next
+// wake-up. Computing takes no time, only waiting does. So hours of a
+// replay, with all the timeouts and restarts of unfolding(), pass in
+// seconds, and every run takes the same timing decisions. A participant
+// blocked on a lock that a sleeping one holds would stop the clock: after
+// stallTimeout of real time without any progress it moves on anyway.
+// The network (UdpServer's timers, the client timeouts) stays on real time,
+// as its other ends are real.
+
+class Clock {
+public:
+  typedef std::chrono::nanoseconds duration;
+  typedef duration::rep rep;
+  typedef duration::period period;
+  typedef std::chrono::time_point<Clock> time_point;
+  static constexpr bool is_steady = true;
+
+  static time_point now() noexcept;
+  // ms since the program started (what wiringPi's millis() was)
+  static unsigned int millis();
+  static void sleepFor(duration d);
+  static void sleepUntil(time_point t);
+
+  // switch to virtual time, before any other thread gets started
+  static void useVirtualTime();
+  static bool isVirtual();
+
+  // Announce a participant before its thread gets created (so the clock
+  // can't move on before it runs). The thread holds a Participant for as
+  // long as it runs.
+  static void addParticipant();
+  class Participant {
+  public:
+    Participant();
+    ~Participant();
+  };
+
+  // scope of a participant's wait for work from another participant
+  class Idle {
+  public:
+    Idle();
+    ~Idle();
+
+  private:
+    bool counted;
+  };
+
+  // Work for another participant: given before the receiver can see the
+  // work (or under the lock it checks it with), taken by the receiver once
+  // it's done waiting. The clock stands still in between.
+  class Handoff {
+  public:
+    void give();
+    void take();
+
+  private:
+    bool given = false;
+  };
+};
@@ -0,0 +1,548 @@
+/* INFO
+ * Predictive coding of depth and confidence planes with adaptive Rice codes
+ * (see DepthCodec.hpp).
+ */
+
+//----------------------------------------------------------------------
+// INCLUDES
+//----------------------------------------------------------------------
+#include "DepthCodec.hpp"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+#include <utility>
+
+//----------------------------------------------------------------------
+// BIT STREAM AND RICE CODE
+//----------------------------------------------------------------------
+namespace {
+
+// unary part of a Rice code longer than this: escape with the raw value
+const int unaryLimit = 20;
+// contexts by the size of the neighbouring residuals (log2)
+const int contextCount = 16;
+// the statistics of a context are halved every so many pixels
+const uint32_t contextWindow = 64;
+
+//________________________________________________
+// MSB first. Every put() stores the whole accumulator (8 bytes, unaligned)
+// and moves on by the complete bytes in it, so there is no data-dependent
+// branch (whether a word is full would be one, mispredicted every few
+// pixels). Needs 8 bytes of room behind the stream (maxEncodedSize()).
+struct BitWriter {
+  explicit BitWriter(uint8_t *data) : start(data), out(data) {}
+
+  inline void put(uint64_t value, int n) { // 1 <= n <= 56
+    acc = (acc << n) | value;
+    bits += n;
+    uint64_t word = __builtin_bswap64(acc << (64 - bits));
+    memcpy(out, &word, sizeof(word));
+    out += bits >> 3;
+    bits &= 7; // the bytes written above them get overwritten next time
+  }
+  // write the remaining bits (zero padded), returns the bytes written
+  size_t finish() {
+    if (bits > 0) {
+      *out++ = (uint8_t)(acc << (8 - bits));
+      bits = 0;
+    }
+    return out - start;
+  }
+
+  uint8_t *start;
+  uint8_t *out;
+  uint64_t acc = 0; // the low `bits` bits are pending
+  int bits = 0;
+};
+
+//________________________________________________
+// Reads zeros past the end, overrun() tells if any of them got used
+struct BitReader {
+  BitReader(const uint8_t *data, size_t size) : in(data), end(data + size) {}
+
+  // at least 57 bits in acc afterwards
+  inline void refill() {
+    if (end - in >= 8) {
+      // whole bytes that fit, the rest of the word gets read again next time.
+      // memcpy: in isn't aligned (a plain load may trap on 32 bit arm)
+      uint64_t word;
+      memcpy(&word, in, sizeof(word));
+      word = __builtin_bswap64(word);
+      acc |= word >> bits;
+      int n = (63 - bits) >> 3;
+      in += n;
+      bits += n << 3;
+      return;
+    }
+    while (bits <= 56) {
+      uint64_t byte = 0;
+      if (in < end) {
+        byte = *in++;
+      } else {
+        padding++;
+      }
+      acc |= byte << (56 - bits);
+      bits += 8;
+    }
+  }
+  inline uint32_t get(int n) { // n <= 32, after refill()
+    // two shifts: 64 - n would be out of range for n == 0
+    uint32_t value = (uint32_t)(acc >> 1 >> (63 - n));
+    acc <<= n;
+    bits -= n;
+    return value;
+  }
+  // zeros up to the next one, -1 if there is none within reach
+  inline int unary() {
+    if (acc == 0) {
+      return -1;
+    }
+    int n = __builtin_clzll(acc);
+    acc <<= n + 1;
+    bits -= n + 1;
+    return n;
+  }
+  bool overrun() const { return padding * 8 > bits; }
+
+  const uint8_t *in;
+  const uint8_t *end;
+  uint64_t acc = 0;
+  int bits = 0;
+  int padding = 0; // zero bytes read past the end
+};
+
+//________________________________________________
+// Adaptive Rice parameter per context (mean of the residuals seen so far).
+// The parameter gets computed when a context is updated: then it only
+// depends on the residual just coded, not on the lookup of the next pixel.
+// All without branches, they would depend on the data (noisy pixels make
+// them unpredictable).
+struct Contexts {
+  explicit Contexts(uint32_t initial) {
+    for (int i = 0; i < contextCount; i++) {
+      sum[i] = initial;
+      count[i] = 1;
+      k[i] = riceParameter(initial, 1);
+    }
+  }
+  // bit length of the activity (0 for 0), at most contextCount - 1
+  static inline int of(uint32_t left, uint32_t up) {
+    uint32_t activity = left + up;
+    int length = (32 - __builtin_clz(activity | 1)) & -(int)(activity != 0);
+    return std::min(length, contextCount - 1);
+  }
+  // smallest k with n << k >= s (0 if s <= n)
+  static inline int riceParameter(uint32_t s, uint32_t n) {
+    int k = std::max(__builtin_clz(n) - __builtin_clz(s | 1), 0);
+    k += (n << k) < s;
+    return std::min(k, 24);
+  }
+  inline int parameter(int ctx) const { return k[ctx]; }
+  inline void update(int ctx, uint32_t value) {
+    uint32_t n = count[ctx] + 1;
+    int halve = n >= contextWindow;
+    uint32_t s = (sum[ctx] + value) >> halve;
+    n >>= halve;
+    sum[ctx] = s;
+    count[ctx] = n;
+    k[ctx] = riceParameter(s, n);
+  }
+
+  uint32_t sum[contextCount];
+  uint32_t count[contextCount];
+  int k[contextCount];
+};
+
+inline uint32_t zigzag(int32_t v) { return ((uint32_t)v << 1) ^ (v >> 31); }
+inline int32_t unzigzag(uint32_t u) {
+  return (int32_t)(u >> 1) ^ -(int32_t)(u & 1);
+}
+// lossless residuals wrap around in the range of T
+template <typename T> inline int32_t wrap(int r) {
+  return sizeof(T) == 1 ? (int8_t)r : (int16_t)r;
+}
+
+//________________________________________________
+// Median edge detector (LOCO-I): left, up, up-left. Same as the gradient
+// a + b - c clamped to [min(a, b), max(a, b)]. Plain conditionals compile to
+// conditional moves, nested std::min / max to jumps (noisy depth makes them
+// unpredictable).
+inline int med(int a, int b, int c) {
+  int lo = a < b ? a : b;
+  int hi = a < b ? b : a;
+  int g = a + b - c;
+  g = g < lo ? lo : g;
+  return g > hi ? hi : g;
+}
+
+// spatial prediction of pixel x in row (up: the row above, nullptr in the
+// first one)
+template <typename T>
+inline int predictSpatial(const T *row, const T *up, int x) {
+  if (up == nullptr) {
+    return x > 0 ? row[x - 1] : 0;
+  }
+  if (x == 0) {
+    return up[0];
+  }
+  return med(row[x - 1], up[x], up[x - 1]);
+}
+
+//________________________________________________
+// Near-lossless: residuals are quantized in steps of 2 * error + 1. The
+// division is a multiplication with the reciprocal (exact for all residuals
+// of 16 bit values and error <= 255).
+struct Quantizer {
+  explicit Quantizer(int maxError)
+      : error(maxError), step(2 * maxError + 1),
+        reciprocal((uint32_t)((1ull << 32) / step) + 1) {}
+
+  // residual of a pixel as it gets coded, rec gets the value the decoder
+  // will see. Lossless: wrapped to the range of T.
+  template <typename T>
+  inline int32_t quantize(int value, int prediction, T &rec) const {
+    int r = value - prediction;
+    if (error == 0) {
+      rec = (T)value;
+      return wrap<T>(r);
+    }
+    uint32_t magnitude = (uint32_t)std::abs(r) + error;
+    int q = (int)(((uint64_t)magnitude * reciprocal) >> 32);
+    q = r < 0 ? -q : q;
+    rec = reconstruct<T>(q, prediction);
+    return q;
+  }
+  template <typename T>
+  inline T reconstruct(int32_t q, int prediction) const {
+    if (error == 0) {
+      return (T)(prediction + q);
+    }
+    int v = prediction + q * step;
+    return (T)std::min(std::max(v, 0), (int)(T)~0);
+  }
+
+  int error;
+  int step;
+  uint32_t reciprocal;
+};
+
+//________________________________________________
+// Residuals of one row as they get coded (zigzag) -> u, the row as the
+// decoder will reconstruct it -> row. last: the row of the last frame
+// (temporal prediction) or nullptr (spatial, inUp / up: the input /
+// reconstructed row above, nullptr in the first one). quant by value: the
+// stores to u and row could alias a reference, its fields would be loaded
+// again for every pixel.
+template <typename T>
+inline void rowResiduals(const T *in, const T *inUp, const T *last,
+                         const T *up, T *row, int width,
+                         Quantizer quant, uint32_t *u) {
+  if (quant.error == 0) {
+    // lossless: the decoder sees the input, so the predictions can be made
+    // from it. No dependency from pixel to pixel, the loops vectorize.
+    memcpy(row, in, width * sizeof(T));
+    if (last != nullptr) {
+      for (int x = 0; x < width; x++) {
+        u[x] = zigzag(wrap<T>(in[x] - last[x]));
+      }
+    } else if (inUp == nullptr) {
+      u[0] = zigzag(wrap<T>(in[0]));
+      for (int x = 1; x < width; x++) {
+        u[x] = zigzag(wrap<T>(in[x] - in[x - 1]));
+      }
+    } else {
+      u[0] = zigzag(wrap<T>(in[0] - inUp[0]));
+      for (int x = 1; x < width; x++) {
+        u[x] = zigzag(wrap<T>(in[x] - med(in[x - 1], inUp[x], inUp[x - 1])));
+      }
+    }
+    return;
+  }
+  // near-lossless: spatial predictions need the reconstructed neighbours
+  if (last != nullptr) {
+    for (int x = 0; x < width; x++) {
+      u[x] = zigzag(quant.quantize<T>(in[x], last[x], row[x]));
+    }
+    return;
+  }
+  // the pixel to the left stays in a register (row may alias up for the
+  // compiler, it would be stored and loaded again on the critical path)
+  T left;
+  u[0] = zigzag(quant.quantize<T>(in[0], predictSpatial(row, up, 0), left));
+  row[0] = left;
+  if (up == nullptr) {
+    for (int x = 1; x < width; x++) {
+      u[x] = zigzag(quant.quantize<T>(in[x], left, left));
+      row[x] = left;
+    }
+    return;
+  }
+  for (int x = 1; x < width; x++) {
+    u[x] = zigzag(quant.quantize<T>(in[x], med(left, up[x], up[x - 1]), left));
+    row[x] = left;
+  }
+}
+
+// Inverse of rowResiduals(): the row from its residuals u
+template <typename T>
+inline void reconstructRow(const uint32_t *u, const T *last, const T *up,
+                           T *row, int width, Quantizer quant) {
+  if (last != nullptr) {
+    for (int x = 0; x < width; x++) {
+      row[x] = quant.reconstruct<T>(unzigzag(u[x]), last[x]);
+    }
+    return;
+  }
+  // see rowResiduals()
+  T left = quant.reconstruct<T>(unzigzag(u[0]), predictSpatial(row, up, 0));
+  row[0] = left;
+  if (up == nullptr) {
+    for (int x = 1; x < width; x++) {
+      left = quant.reconstruct<T>(unzigzag(u[x]), left);
+      row[x] = left;
+    }
+    return;
+  }
+  for (int x = 1; x < width; x++) {
+    left = quant.reconstruct<T>(unzigzag(u[x]), med(left, up[x], up[x - 1]));
+    row[x] = left;
+  }
+}
+
+//________________________________________________
+// One plane. ref == nullptr: key frame (spatial rows only), otherwise every
+// row starts with one bit: spatial (0) or temporal (1). rec gets the
+// reconstructed plane (width * height, no padding). scratch: 2 * width.
+// Each row gets its residuals first, then the serial part: the adaptive
+// Rice code (contexts from the residuals left and above).
+template <typename T>
+void encodePlane(const T *src, int stride, const T *ref, T *rec, int width,
+                 int height, int error, uint32_t *scratch, BitWriter &stream) {
+  // local copy: stays in registers (the byte stores may alias the original)
+  BitWriter out = stream;
+  const int escapeBits = 8 * sizeof(T) + 1;
+  const Quantizer quant(error);
+  Contexts ctx(sizeof(T) == 1 ? 4 : 16);
+  uint32_t *above = scratch; // residuals of the row above
+  uint32_t *now = scratch + width;
+  std::fill(above, above + width, 0);
+  for (int y = 0; y < height; y++) {
+    const T *in = src + (size_t)y * stride;
+    const T *inUp = y > 0 ? in - stride : nullptr;
+    T *row = rec + (size_t)y * width;
+    const T *up = y > 0 ? row - width : nullptr;
+    const T *last = ref != nullptr ? ref + (size_t)y * width : nullptr;
+    bool temporal = false;
+    if (last != nullptr) {
+      // estimated on every 4th pixel of the input, good enough to pick
+      // the mode
+      uint32_t spatialCost = std::abs((int)in[0] - predictSpatial(in, inUp, 0));
+      uint32_t temporalCost = std::abs((int)in[0] - (int)last[0]);
+      for (int x = 4; x < width; x += 4) {
+        int p = inUp != nullptr ? med(in[x - 1], inUp[x], inUp[x - 1])
+                                : in[x - 1];
+        spatialCost += std::abs((int)in[x] - p);
+        temporalCost += std::abs((int)in[x] - (int)last[x]);
+      }
+      temporal = temporalCost < spatialCost;
+      out.put(temporal, 1);
+    }
+    rowResiduals<T>(in, inUp, temporal ? last : nullptr, up, row, width,
+                    quant, now);
+    uint32_t left = 0;
+    for (int x = 0; x < width; x++) {
+      uint32_t u = now[x];
+      int c = Contexts::of(left, above[x]);
+      int k = ctx.parameter(c);
+      uint32_t q = u >> k;
+      // q zeros, a one and the k low bits. Outliers: unaryLimit zeros, a one
+      // and the raw value.
+      bool escape = q >= (uint32_t)unaryLimit;
+      uint64_t code = escape ? (1ull << escapeBits) | u
+                             : (1ull << k) | (u & ((1u << k) - 1));
+      int length = escape ? unaryLimit + 1 + escapeBits : q + 1 + k;
+      out.put(code, length);
+      ctx.update(c, u);
+      left = u;
+    }
+    std::swap(above, now);
+  }
+  stream = out;
+}
+
+//________________________________________________
+template <typename T>
+bool decodePlane(BitReader &stream, const T *ref, T *rec, int width,
+                 int height, int error, uint32_t *above) {
+  BitReader in = stream; // see encodePlane()
+  const int escapeBits = 8 * sizeof(T) + 1;
+  const Quantizer quant(error);
+  Contexts ctx(sizeof(T) == 1 ? 4 : 16);
+  std::fill(above, above + width, 0);
+  for (int y = 0; y < height; y++) {
+    T *row = rec + (size_t)y * width;
+    const T *up = y > 0 ? row - width : nullptr;
+    const T *last = ref != nullptr ? ref + (size_t)y * width : nullptr;
+    bool temporal = false;
+    if (last != nullptr) {
+      in.refill();
+      temporal = in.get(1);
+    }
+    // the residuals of the row replace the ones above, then the pixels
+    uint32_t left = 0;
+    for (int x = 0; x < width; x++) {
+      int c = Contexts::of(left, above[x]);
+      int k = ctx.parameter(c);
+      in.refill();
+      int q = in.unary();
+      uint32_t u;
+      if (q < 0 || q > unaryLimit) {
+        return false;
+      } else if (q == unaryLimit) {
+        u = in.get(escapeBits);
+      } else {
+        u = ((uint32_t)q << k) | in.get(k);
+      }
+      ctx.update(c, u);
+      left = u;
+      above[x] = u;
+    }
+    reconstructRow<T>(above, temporal ? last : nullptr, up, row, width, quant);
+  }
+  stream = in;
+  return !in.overrun();
+}
+
+} // namespace
+
+//----------------------------------------------------------------------
+// METHODS
+//----------------------------------------------------------------------
+void DepthCodec::setMaxError(int mm) {
+  error = std::min(std::max(mm, 0), maxMaxError);
+  reset();
+}
+
+//________________________________________________
+void DepthCodec::resize(int width, int height) {
+  if (width == w && height == h) {
+    return;
+  }
+  w = width;
+  h = height;
+  size_t pixels = (size_t)w * h;
+  refDepth.assign(pixels, 0);
+  curDepth.assign(pixels, 0);
+  refConf.assign(pixels, 0);
+  curConf.assign(pixels, 0);
+  residuals.assign(2 * w, 0); // encoder: this row and the one above
+  sinceKey = -1;
+}
+
+//________________________________________________
+// Worst case: every pixel of both planes escaped, plus the mode bits
+size_t DepthCodec::maxEncodedSize(int width, int height) {
+  size_t bitsPerPixel = 2 * (unaryLimit + 1) + 17 + 9;
+  return sizeof(Header) +
+         ((size_t)width * height * bitsPerPixel + 2 * height) / 8 + 8;
+}
+
+//________________________________________________
+size_t DepthCodec::encode(const uint16_t *depth, const uint8_t *conf,
+                          int width, int height, int stride, uint8_t *out) {
+  resize(width, height);
+  bool key = sinceKey < 0 || sinceKey >= keyInterval - 1;
+  Header *header = (Header *)out;
+  memset(header, 0, sizeof(*header));
+  header->width = w;
+  header->height = h;
+  header->flags = key ? KEY : 0;
+  header->maxError = error;
+  BitWriter bits(out + sizeof(Header));
+  encodePlane<uint16_t>(depth, stride, key ? nullptr : refDepth.data(),
+                        curDepth.data(), w, h, error, residuals.data(), bits);
+  encodePlane<uint8_t>(conf, stride, key ? nullptr : refConf.data(),
+                       curConf.data(), w, h, 0, residuals.data(), bits);
+  header->size = bits.finish();
+  refDepth.swap(curDepth);
+  refConf.swap(curConf);
+  sinceKey = key ? 0 : sinceKey + 1;
+  return sizeof(Header) + header->size;
+}
+
+//________________________________________________
+bool DepthCodec::valid(const uint8_t *data, size_t size, int width,
+                       int height) {
+  if (size < sizeof(Header)) {
+    return false;
+  }
+  const Header *header = (const Header *)data;
+  return header->width == width && header->height == height &&
+         !(header->flags & IMAGE8) &&
+         sizeof(Header) + (size_t)header->size <= size;
+}
+
+//________________________________________________
+bool DepthCodec::decode(const uint8_t *data, size_t size) {
+  const Header *header = (const Header *)data;
+  if (size < sizeof(Header) ||
+      !valid(data, size, header->width, header->height)) {
+    return false;
+  }
+  bool key = header->flags & KEY;
+  if (!key && (sinceKey < 0 || header->width != w || header->height != h)) {
+    return false; // nothing to predict from
+  }
+  resize(header->width, header->height);
+  BitReader bits(data + sizeof(Header), header->size);
+  bool ok = decodePlane<uint16_t>(bits, key ? nullptr : refDepth.data(),
+                                  curDepth.data(), w, h, header->maxError,
+                                  residuals.data()) &&
+            decodePlane<uint8_t>(bits, key ? nullptr : refConf.data(),
+                                 curConf.data(), w, h, 0, residuals.data());
+  if (!ok) {
+    sinceKey = -1;
+    return false;
+  }
+  refDepth.swap(curDepth);
+  refConf.swap(curConf);
+  sinceKey = key ? 0 : sinceKey + 1;
+  return true;
+}
+
+//________________________________________________
+size_t DepthCodec::encodeImage(const uint8_t *pixels, int width, int height,
+                               int stride, uint8_t *out) {
+  std::vector<uint8_t> rec((size_t)width * height);
+  std::vector<uint32_t> scratch(2 * width);
+  Header *header = (Header *)out;
+  memset(header, 0, sizeof(*header));
+  header->width = width;
+  header->height = height;
+  header->flags = KEY | IMAGE8;
+  BitWriter bits(out + sizeof(Header));
+  encodePlane<uint8_t>(pixels, stride, nullptr, rec.data(), width, height, 0,
+                       scratch.data(), bits);
+  header->size = bits.finish();
+  return sizeof(Header) + header->size;
+}
+
+//________________________________________________
+bool DepthCodec::decodeImage(const uint8_t *data, size_t size,
+                             std::vector<uint8_t> &pixels, int &width,
+                             int &height) {
+  const Header *header = (const Header *)data;
+  if (size < sizeof(Header) || !(header->flags & IMAGE8) ||
+      sizeof(Header) + (size_t)header->size > size) {
+    return false;
+  }
+  width = header->width;
+  height = header->height;
+  pixels.resize((size_t)width * height);
+  std::vector<uint32_t> above(width);
+  BitReader bits(data + sizeof(Header), header->size);
+  return decodePlane<uint8_t>(bits, nullptr, pixels.data(), width, height, 0,
+                              above.data());
+}
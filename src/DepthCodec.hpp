@@ -0,0 +1,99 @@
+#pragma once
+
+//----------------------------------------------------------------------
+// INCLUDES
+//----------------------------------------------------------------------
+#include <stddef.h>
+#include <stdint.h>
+
+#include <vector>
+
+//****************************************************************
+//                          DEPTH CODEC
+//****************************************************************
+// Compression of ToF frames (16 bit depth + 8 bit confidence plane) for the
+// recorder and the udp image. Every pixel is predicted, the residual is
+// written with an adaptive Rice code:
+//  - spatial rows use the MED predictor of LOCO-I / JPEG-LS (left, up and
+//    up-left neighbour), temporal rows the same pixel of the last frame.
+//    The encoder picks whichever fits a row better (one bit per row).
+//  - the Rice parameter adapts per context, the context is the size of the
+//    residuals left of and above the pixel (flat areas get short codes,
+//    edges and noise long ones). Outliers are escaped with the raw value.
+// Key frames (spatial rows only) every keyInterval frames, so a replay can
+// seek. Lossless by default; with a max error of e mm the depth residuals
+// are quantized in steps of 2e + 1 (near-lossless, every pixel within e mm),
+// the confidence stays lossless.
+// One codec object keeps the state of one stream: the last frame, against
+// which the next one gets encoded (or decoded).
+
+class DepthCodec {
+public:
+  // in front of every encoded frame
+  struct Header {
+    uint16_t width;
+    uint16_t height;
+    uint8_t flags;
+    uint8_t maxError; // in mm, 0 = lossless
+    uint16_t reserved;
+    uint32_t size; // of the bit stream following the header
+    uint32_t reserved2;
+  };
+  static_assert(sizeof(Header) == 16, "codec header has to be 16 bytes");
+
+  enum Flags : uint8_t {
+    KEY = 1,    // no temporal prediction, decodable on its own
+    IMAGE8 = 2, // single 8 bit plane (encodeImage)
+  };
+
+  static const int keyInterval = 45; // frames (~1 s at 45 fps)
+  static const int maxMaxError = 255;
+
+  // 0 = lossless
+  void setMaxError(int mm);
+  int maxError() const { return error; }
+  // next frame becomes a key frame
+  void reset() { sinceKey = -1; }
+
+  // encode a frame into out (at least maxEncodedSize() bytes), returns the
+  // bytes written. Strides are in pixels.
+  size_t encode(const uint16_t *depth, const uint8_t *conf, int width,
+                int height, int stride, uint8_t *out);
+  // decode a frame (false if corrupted, or not a key frame and there is no
+  // last frame of the same size - the caller has to make sure the last one
+  // decoded is its predecessor). The result is in depth() / conf().
+  bool decode(const uint8_t *data, size_t size);
+  // last frame encoded (as the decoder will see it) or decoded
+  const uint16_t *depth() const { return refDepth.data(); }
+  const uint8_t *conf() const { return refConf.data(); }
+  int width() const { return w; }
+  int height() const { return h; }
+
+  static size_t maxEncodedSize(int width, int height);
+  // plausible header that fits into size bytes
+  static bool valid(const uint8_t *data, size_t size, int width, int height);
+  static bool isKey(const uint8_t *data) {
+    return ((const Header *)data)->flags & KEY;
+  }
+
+  // single 8 bit image, spatial prediction only (udp: a lost packet must
+  // not break the next image)
+  static size_t encodeImage(const uint8_t *pixels, int width, int height,
+                            int stride, uint8_t *out);
+  static bool decodeImage(const uint8_t *data, size_t size,
+                          std::vector<uint8_t> &pixels, int &width,
+                          int &height);
+
+private:
+  void resize(int width, int height);
+
+  int error = 0;
+  int sinceKey = -1; // frames since the last key frame (-1: none yet)
+  int w = 0;
+  int h = 0;
+  // reconstructed last frame (reference of the temporal prediction) and
+  // the one being coded
+  std::vector<uint16_t> refDepth, curDepth;
+  std::vector<uint8_t> refConf, curConf;
+  std::vector<uint32_t> residuals; // of the row above (and, encoding, this one)
+};
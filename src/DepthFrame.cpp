@@ -0,0 +1,56 @@
+/* INFO
+ * Compact planar depth frame that gets filled by onNewData() and read by the
+ * processing thread (see DepthFrame.hpp).
+ */
+
+//----------------------------------------------------------------------
+// INCLUDES
+//----------------------------------------------------------------------
+#include "DepthFrame.hpp"
+
+#include <stdio.h>
+#include <string.h>
+
+#include <new>
+
+//----------------------------------------------------------------------
+// METHODS
+//----------------------------------------------------------------------
+
+//________________________________________________
+// Allocate both planes in one aligned block. Only happens for the first
+// frame of a resolution, afterwards the memory is reused.
+void DepthFrame::resize(int width, int height) {
+  if (width == w && height == h && buffer) {
+    return;
+  }
+  // pad rows to full cache lines (depth rows are then 128 byte aligned)
+  int stride = (width + alignment - 1) / alignment * alignment;
+  size_t depthBytes = (size_t)stride * height * sizeof(uint16_t);
+  size_t confBytes = (size_t)stride * height;
+  void *mem = nullptr;
+  if (posix_memalign(&mem, alignment, depthBytes + confBytes) != 0) {
+    printf("allocation of depth frame (%i x %i) failed\n", width, height);
+    throw std::bad_alloc();
+  }
+  // clear padding and all, so that rows never contain garbage
+  memset(mem, 0, depthBytes + confBytes);
+  buffer.reset((uint8_t *)mem);
+  depth = (uint16_t *)mem;
+  conf = (uint8_t *)mem + depthBytes;
+  w = width;
+  h = height;
+  s = stride;
+}
+
+//________________________________________________
+// Copy another frame (same layout -> two plain memcpys)
+void DepthFrame::copyFrom(const DepthFrame &other) {
+  resize(other.w, other.h);
+  if (other.buffer) {
+    memcpy(depth, other.depth, (size_t)s * h * sizeof(uint16_t));
+    memcpy(conf, other.conf, (size_t)s * h);
+  }
+  timeStamp = other.timeStamp;
+  traceId = other.traceId;
+}
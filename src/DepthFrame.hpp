@@ -0,0 +1,59 @@
+#pragma once
+
+//----------------------------------------------------------------------
+// INCLUDES
+//----------------------------------------------------------------------
+#include <stdint.h>
+#include <stdlib.h>
+
+#include <memory>
+
+//****************************************************************
+//                          DEPTH FRAME
+//****************************************************************
+// Compact copy of a royale::DepthData frame holding only what the pipeline
+// needs: a 16 bit depth plane (in mm) and an 8 bit confidence plane.
+// Both planes are 64 byte aligned and every row starts on a 64 byte boundary,
+// so each tile span of a row is a contiguous run for the depth kernel.
+// Memory is allocated once per resolution and reused for every frame.
+
+class DepthFrame {
+public:
+  static const int alignment = 64; // bytes (one cache line)
+
+  // (re)allocate the planes - does nothing if the size didn't change
+  void resize(int width, int height);
+  void copyFrom(const DepthFrame &other);
+
+  int width() const { return w; }
+  int height() const { return h; }
+  int stride() const { return s; } // pixels from one row to the next
+
+  uint16_t *depthRow(int y) { return depth + y * s; }
+  const uint16_t *depthRow(int y) const { return depth + y * s; }
+  uint8_t *confRow(int y) { return conf + y * s; }
+  const uint8_t *confRow(int y) const { return conf + y * s; }
+
+  // z in meters (as delivered by royale) -> depth plane value in mm
+  static inline uint16_t toMillimeters(float z) {
+    float mm = z * 1000.0f + 0.5f;
+    if (mm <= 0.0f) {
+      return 0;
+    }
+    return mm < 65535.0f ? (uint16_t)mm : 65535;
+  }
+
+  int64_t timeStamp = 0; // capture time from royale in us
+  uint32_t traceId = 0;  // FrameTracer ID, 0: not traced
+
+private:
+  struct FreeDeleter {
+    void operator()(void *p) const { free(p); }
+  };
+  std::unique_ptr<uint8_t, FreeDeleter> buffer;
+  uint16_t *depth = nullptr;
+  uint8_t *conf = nullptr;
+  int w = 0;
+  int h = 0;
+  int s = 0;
+};
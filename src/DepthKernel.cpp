@@ -0,0 +1,365 @@
+/* INFO
+ * Scalar and SIMD implementations of the depth kernel (see DepthKernel.hpp)
+ * and the runtime selection of the fastest one available on this CPU.
+ */
+
+//----------------------------------------------------------------------
+// INCLUDES
+//----------------------------------------------------------------------
+#include "DepthKernel.hpp"
+
+#include <string.h>
+
+#include <type_traits>
+
+#include "ActuatorLayout.hpp"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define DEPTH_KERNEL_X86
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define DEPTH_KERNEL_NEON
+#endif
+
+//----------------------------------------------------------------------
+// IMPLEMENTATIONS
+//----------------------------------------------------------------------
+namespace {
+
+// All implementations are templates on the span length: 0 means it is only
+// known at runtime (n), anything else is the length for a known camera
+// resolution (see rowFixed()). Then the loop bounds and the length of the
+// tail are compile-time constants and the compiler can unroll the loops.
+
+//________________________________________________
+// Reference implementation, also used for the tails of the SIMD versions
+template <int Fixed>
+void spanScalar(const uint16_t *depth, const uint8_t *conf, int n,
+                uint16_t maxMm, uint16_t mul, uint8_t *img,
+                DepthKernel::SubHisto &histo) {
+  if (Fixed > 0)
+    n = Fixed;
+  for (int x = 0; x < n; x++) {
+    uint8_t bin = 255; // invalid pixels count as "out of range"
+    uint8_t pix = DepthKernel::invalidPixel;
+    if (conf[x] > DepthKernel::confidenceThresh) {
+      bin = DepthKernel::quantize(depth[x], maxMm, mul);
+      pix = bin; // out of range (255) is white / invisible
+    }
+    img[x] = pix;
+    histo[x % DepthKernel::histoLanes][bin]++;
+  }
+}
+
+//________________________________________________
+// Count the bins of one SIMD block into the sub-histograms
+inline void countBins(const uint8_t *bins, int n,
+                      DepthKernel::SubHisto &histo) {
+  for (int k = 0; k < n; k += DepthKernel::histoLanes) {
+    histo[0][bins[k]]++;
+    histo[1][bins[k + 1]]++;
+    histo[2][bins[k + 2]]++;
+    histo[3][bins[k + 3]]++;
+  }
+}
+static_assert(DepthKernel::histoLanes == 4, "countBins() is unrolled by 4");
+
+#ifdef DEPTH_KERNEL_X86
+//________________________________________________
+// SSE2 is part of every x86_64 CPU: 8 pixels per iteration
+template <int Fixed>
+void spanSse2(const uint16_t *depth, const uint8_t *conf, int n,
+              uint16_t maxMm, uint16_t mul, uint8_t *img,
+              DepthKernel::SubHisto &histo) {
+  if (Fixed > 0)
+    n = Fixed;
+  const __m128i vMax = _mm_set1_epi16((short)maxMm);
+  const __m128i vMul = _mm_set1_epi16((short)mul);
+  const __m128i vThresh = _mm_set1_epi16(DepthKernel::confidenceThresh);
+  const __m128i vOut = _mm_set1_epi16(255);
+  const __m128i vInvalid = _mm_set1_epi16(DepthKernel::invalidPixel);
+  const __m128i zero = _mm_setzero_si128();
+  alignas(16) uint8_t bins[16];
+  int x = 0;
+  for (; x + 8 <= n; x += 8) {
+    __m128i d = _mm_loadu_si128((const __m128i *)(depth + x));
+    __m128i c = _mm_unpacklo_epi8(
+        _mm_loadl_epi64((const __m128i *)(conf + x)), zero);
+    // min(d, maxMm) without SSE4.1: d - saturate(d - maxMm)
+    d = _mm_sub_epi16(d, _mm_subs_epu16(d, vMax));
+    __m128i q = _mm_mulhi_epu16(d, vMul);
+    __m128i valid = _mm_cmpgt_epi16(c, vThresh);
+    __m128i b = _mm_or_si128(_mm_and_si128(valid, q),
+                             _mm_andnot_si128(valid, vOut));
+    __m128i p = _mm_or_si128(_mm_and_si128(valid, q),
+                             _mm_andnot_si128(valid, vInvalid));
+    _mm_storel_epi64((__m128i *)(img + x), _mm_packus_epi16(p, p));
+    _mm_store_si128((__m128i *)bins, _mm_packus_epi16(b, b));
+    countBins(bins, 8, histo);
+  }
+  constexpr int tail = Fixed > 0 ? Fixed % 8 : 0;
+  spanScalar<tail>(depth + x, conf + x, n - x, maxMm, mul, img + x, histo);
+}
+
+//________________________________________________
+// AVX2 (compiled for this function only, used if the CPU supports it)
+template <int Fixed>
+__attribute__((target("avx2"))) void
+spanAvx2(const uint16_t *depth, const uint8_t *conf, int n, uint16_t maxMm,
+         uint16_t mul, uint8_t *img, DepthKernel::SubHisto &histo) {
+  if (Fixed > 0)
+    n = Fixed;
+  const __m256i vMax = _mm256_set1_epi16((short)maxMm);
+  const __m256i vMul = _mm256_set1_epi16((short)mul);
+  const __m256i vThresh = _mm256_set1_epi16(DepthKernel::confidenceThresh);
+  const __m256i vOut = _mm256_set1_epi16(255);
+  const __m256i vInvalid = _mm256_set1_epi16(DepthKernel::invalidPixel);
+  alignas(32) uint8_t bins[32];
+  int x = 0;
+  for (; x + 16 <= n; x += 16) {
+    __m256i d = _mm256_loadu_si256((const __m256i *)(depth + x));
+    __m256i c = _mm256_cvtepu8_epi16(
+        _mm_loadu_si128((const __m128i *)(conf + x)));
+    __m256i q = _mm256_mulhi_epu16(_mm256_min_epu16(d, vMax), vMul);
+    __m256i valid = _mm256_cmpgt_epi16(c, vThresh);
+    __m256i b = _mm256_blendv_epi8(vOut, q, valid);
+    __m256i p = _mm256_blendv_epi8(vInvalid, q, valid);
+    // packus works per 128 bit lane -> gather the low quadwords afterwards
+    p = _mm256_permute4x64_epi64(_mm256_packus_epi16(p, p), 0x08);
+    b = _mm256_permute4x64_epi64(_mm256_packus_epi16(b, b), 0x08);
+    _mm_storeu_si128((__m128i *)(img + x), _mm256_castsi256_si128(p));
+    _mm_store_si128((__m128i *)bins, _mm256_castsi256_si128(b));
+    countBins(bins, 16, histo);
+  }
+  constexpr int tail = Fixed > 0 ? Fixed % 16 : 0;
+  spanScalar<tail>(depth + x, conf + x, n - x, maxMm, mul, img + x, histo);
+}
+#endif
+
+#ifdef DEPTH_KERNEL_NEON
+//________________________________________________
+// NEON is mandatory on aarch64 (CM4): 8 pixels per iteration
+template <int Fixed>
+void spanNeon(const uint16_t *depth, const uint8_t *conf, int n,
+              uint16_t maxMm, uint16_t mul, uint8_t *img,
+              DepthKernel::SubHisto &histo) {
+  if (Fixed > 0)
+    n = Fixed;
+  const uint16x8_t vMax = vdupq_n_u16(maxMm);
+  const uint16x4_t vMul = vdup_n_u16(mul);
+  const uint8x8_t vThresh = vdup_n_u8(DepthKernel::confidenceThresh);
+  const uint8x8_t vOut = vdup_n_u8(255);
+  const uint8x8_t vInvalid = vdup_n_u8(DepthKernel::invalidPixel);
+  alignas(16) uint8_t bins[8];
+  int x = 0;
+  for (; x + 8 <= n; x += 8) {
+    uint16x8_t d = vminq_u16(vld1q_u16(depth + x), vMax);
+    // (d * mul) >> 16 - results are <= 255 and fit into 8 bits
+    uint16x8_t q16 =
+        vcombine_u16(vshrn_n_u32(vmull_u16(vget_low_u16(d), vMul), 16),
+                     vshrn_n_u32(vmull_u16(vget_high_u16(d), vMul), 16));
+    uint8x8_t q = vmovn_u16(q16);
+    uint8x8_t valid = vcgt_u8(vld1_u8(conf + x), vThresh);
+    vst1_u8(img + x, vbsl_u8(valid, q, vInvalid));
+    vst1_u8(bins, vbsl_u8(valid, q, vOut));
+    countBins(bins, 8, histo);
+  }
+  constexpr int tail = Fixed > 0 ? Fixed % 8 : 0;
+  spanScalar<tail>(depth + x, conf + x, n - x, maxMm, mul, img + x, histo);
+}
+#endif
+
+//________________________________________________
+// One row split into Cols tiles of equal width (like processData() does for
+// a grid layout), everything known at compile time. The tiles are unrolled
+// by overloads on whether there is one more to go (C++14: no if constexpr,
+// the CM4's GCC 10 defaults to it).
+template <class Isa, int Width, int Cols, int Col>
+inline void tilesFixed(const uint16_t *, const uint8_t *, uint16_t, uint16_t,
+                       uint8_t *, DepthKernel::SubHisto *const *,
+                       std::false_type) {} // past the last tile
+
+template <class Isa, int Width, int Cols, int Col>
+inline void tilesFixed(const uint16_t *depth, const uint8_t *conf,
+                       uint16_t maxMm, uint16_t mul, uint8_t *img,
+                       DepthKernel::SubHisto *const *histo, std::true_type) {
+  // same borders as ActuatorMap::prepare()
+  constexpr int x0 = ActuatorMap::tileStart(Col, Width, Cols);
+  constexpr int x1 = ActuatorMap::tileStart(Col + 1, Width, Cols);
+  static_assert(x1 > x0, "every tile needs pixels");
+  Isa::template span<x1 - x0>(depth + x0, conf + x0, x1 - x0, maxMm, mul,
+                              img + x0, *histo[Col]);
+  tilesFixed<Isa, Width, Cols, Col + 1>(
+      depth, conf, maxMm, mul, img, histo,
+      std::integral_constant<bool, (Col + 1 < Cols)>());
+}
+
+template <class Isa, int Width, int Cols>
+void rowFixed(const uint16_t *depth, const uint8_t *conf, uint16_t maxMm,
+              uint16_t mul, uint8_t *img, DepthKernel::SubHisto *const *histo) {
+  tilesFixed<Isa, Width, Cols, 0>(depth, conf, maxMm, mul, img, histo,
+                                  std::true_type());
+}
+
+// the implementations as types for rowFixed()
+struct Scalar {
+  template <int N> static void span(const uint16_t *depth, const uint8_t *conf,
+                                    int n, uint16_t maxMm, uint16_t mul,
+                                    uint8_t *img, DepthKernel::SubHisto &h) {
+    spanScalar<N>(depth, conf, n, maxMm, mul, img, h);
+  }
+};
+#ifdef DEPTH_KERNEL_X86
+struct Sse2 {
+  template <int N> static void span(const uint16_t *depth, const uint8_t *conf,
+                                    int n, uint16_t maxMm, uint16_t mul,
+                                    uint8_t *img, DepthKernel::SubHisto &h) {
+    spanSse2<N>(depth, conf, n, maxMm, mul, img, h);
+  }
+};
+struct Avx2 {
+  template <int N> static void span(const uint16_t *depth, const uint8_t *conf,
+                                    int n, uint16_t maxMm, uint16_t mul,
+                                    uint8_t *img, DepthKernel::SubHisto &h) {
+    spanAvx2<N>(depth, conf, n, maxMm, mul, img, h);
+  }
+};
+#endif
+#ifdef DEPTH_KERNEL_NEON
+struct Neon {
+  template <int N> static void span(const uint16_t *depth, const uint8_t *conf,
+                                    int n, uint16_t maxMm, uint16_t mul,
+                                    uint8_t *img, DepthKernel::SubHisto &h) {
+    spanNeon<N>(depth, conf, n, maxMm, mul, img, h);
+  }
+};
+#endif
+
+//________________________________________________
+// The instantiations for the known royale resolutions and the 3x3 glove
+template <class Isa> DepthKernel::RowFn fixedRow(int width, int cols) {
+  if (cols == 3 && width == 224) {
+    return rowFixed<Isa, 224, 3>; // pico flexx / maxx (all use cases)
+  }
+  if (cols == 3 && width == 352) {
+    return rowFixed<Isa, 352, 3>; // pico monstar
+  }
+  return nullptr;
+}
+
+// implementation the next kernels use instead of the fastest (prefer())
+const char *preferredImpl = nullptr;
+
+} // namespace
+
+//----------------------------------------------------------------------
+// METHODS
+//----------------------------------------------------------------------
+
+//________________________________________________
+// Pick the fastest implementation this CPU supports (or the preferred one)
+DepthKernel::DepthKernel()
+    : spanFn(spanScalar<0>), implName("scalar"), impl(SCALAR) {
+  std::vector<const char *> names = available();
+  const char *use = names.back();
+  for (const char *name : names) {
+    if (preferredImpl != nullptr && strcmp(name, preferredImpl) == 0) {
+      use = name;
+    }
+  }
+  select(use);
+  setMaxDepth(2);
+}
+
+//________________________________________________
+std::vector<const char *> DepthKernel::available() {
+  std::vector<const char *> names = {"scalar"};
+#if defined(DEPTH_KERNEL_X86)
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("sse2")) {
+    names.push_back("sse2");
+  }
+  if (__builtin_cpu_supports("avx2")) {
+    names.push_back("avx2");
+  }
+#elif defined(DEPTH_KERNEL_NEON)
+  names.push_back("neon");
+#endif
+  return names;
+}
+
+void DepthKernel::prefer(const char *name) { preferredImpl = name; }
+
+//________________________________________________
+void DepthKernel::select(const char *name) {
+  spanFn = spanScalar<0>;
+  implName = "scalar";
+  impl = SCALAR;
+#if defined(DEPTH_KERNEL_X86)
+  if (strcmp(name, "avx2") == 0) {
+    spanFn = spanAvx2<0>;
+    implName = "avx2";
+    impl = AVX2;
+  } else if (strcmp(name, "sse2") == 0) {
+    spanFn = spanSse2<0>;
+    implName = "sse2";
+    impl = SSE2;
+  }
+#elif defined(DEPTH_KERNEL_NEON)
+  if (strcmp(name, "neon") == 0) {
+    spanFn = spanNeon<0>;
+    implName = "neon";
+    impl = NEON;
+  }
+#endif
+  rowFn = nullptr;
+}
+
+//________________________________________________
+// Set the viewing range and derive the fixed-point factor from it
+void DepthKernel::setMaxDepth(float meters) {
+  // the factor has to fit into 16 bits -> range has to be at least 256 mm
+  int mm = (int)(meters * 1000.0f + 0.5f);
+  if (mm < 256)
+    mm = 256;
+  if (mm > 65535)
+    mm = 65535;
+  maxMm = (uint16_t)mm;
+  // round up, so that a depth of exactly maxMm ends up in bin 255
+  mul = (uint16_t)((255u * 65536u + maxMm - 1) / maxMm);
+}
+
+//________________________________________________
+// Branch-free and simple enough for the compiler to vectorize it
+void DepthKernel::binSpan(const uint16_t *depth, const uint8_t *conf, int n,
+                          uint8_t *bins) const {
+  for (int x = 0; x < n; x++) {
+    uint8_t bin = quantize(depth[x], maxMm, mul);
+    bins[x] = conf[x] > confidenceThresh ? bin : 255;
+  }
+}
+
+//________________________________________________
+// Look for a row kernel specialized for this geometry (of the selected
+// implementation). Without one processRow() must not be used.
+bool DepthKernel::selectRowKernel(int width, int cols) {
+  switch (impl) {
+#if defined(DEPTH_KERNEL_X86)
+  case AVX2:
+    rowFn = fixedRow<Avx2>(width, cols);
+    break;
+  case SSE2:
+    rowFn = fixedRow<Sse2>(width, cols);
+    break;
+#elif defined(DEPTH_KERNEL_NEON)
+  case NEON:
+    rowFn = fixedRow<Neon>(width, cols);
+    break;
+#endif
+  default:
+    rowFn = fixedRow<Scalar>(width, cols);
+    break;
+  }
+  return rowFn != nullptr;
+}
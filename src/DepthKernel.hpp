@@ -0,0 +1,88 @@
+#pragma once
+
+//----------------------------------------------------------------------
+// INCLUDES
+//----------------------------------------------------------------------
+#include <stdint.h>
+
+#include <array>
+#include <vector>
+
+//****************************************************************
+//                         DEPTH KERNEL
+//****************************************************************
+// The per-pixel hot loop of DepthDataUtilities::processData().
+// One call handles a contiguous span of pixels (one row of one tile) in one
+// pass: confidence masking, fixed-point quantization of the depth (in mm) to
+// the 0..255 histogram bins, writing the span of the depth image and counting
+// the bins into per-lane sub-histograms (merged by the caller afterwards).
+// A SIMD implementation (NEON on the CM4, SSE2/AVX2 on x86 hosts) is picked
+// once at runtime, the scalar one is the fallback and the reference.
+
+class DepthKernel {
+public:
+  // pixels with a lower (or equal) confidence are treated as invalid
+  static const uint8_t confidenceThresh = 10;
+  // grey tone for invalid pixels in the depth image
+  static const uint8_t invalidPixel = 230;
+  // number of sub-histograms per tile. Neighbouring pixels mostly fall into
+  // the same bin - spreading them over lanes breaks the store-to-load chain.
+  static const int histoLanes = 4;
+
+  typedef std::array<std::array<uint32_t, 256>, histoLanes> SubHisto;
+  typedef void (*SpanFn)(const uint16_t *depth, const uint8_t *conf, int n,
+                         uint16_t maxMm, uint16_t mul, uint8_t *img,
+                         SubHisto &histo);
+
+  // a whole row split into equal tiles, for the known camera resolutions
+  typedef void (*RowFn)(const uint16_t *depth, const uint8_t *conf,
+                        uint16_t maxMm, uint16_t mul, uint8_t *img,
+                        SubHisto *const *histo);
+
+  DepthKernel();
+  // implementations this CPU can run, the fastest one last
+  static std::vector<const char *> available();
+  // kernels constructed from now on use this implementation instead of the
+  // fastest one (if available, nullptr: the fastest), e.g. to check them
+  // against the scalar reference
+  static void prefer(const char *name);
+  void setMaxDepth(float meters);
+  void processSpan(const uint16_t *depth, const uint8_t *conf, int n,
+                   uint8_t *img, SubHisto &histo) const {
+    spanFn(depth, conf, n, maxMm, mul, img, histo);
+  }
+  // Use a kernel with compile-time loop bounds and tile borders for rows of
+  // this width split into `cols` equal tiles (see DepthKernel.cpp for the
+  // known resolutions). Returns false if there is none for this geometry.
+  bool selectRowKernel(int width, int cols);
+  // one row of the selected geometry, histo[c] gets the pixels of tile c
+  void processRow(const uint16_t *depth, const uint8_t *conf, uint8_t *img,
+                  SubHisto *const *histo) const {
+    rowFn(depth, conf, maxMm, mul, img, histo);
+  }
+
+  // only the histogram bins of a span (255 for invalid pixels), for the
+  // change detection of the incremental mode
+  void binSpan(const uint16_t *depth, const uint8_t *conf, int n,
+               uint8_t *bins) const;
+  const char *name() const { return implName; }
+  // the quantization parameters of the viewing range
+  uint16_t maxDepthMm() const { return maxMm; }
+  uint16_t binFactor() const { return mul; }
+
+  // the canonical quantization every implementation has to match bit-exactly
+  static inline uint8_t quantize(uint16_t mm, uint16_t maxMm, uint16_t mul) {
+    uint32_t clamped = mm < maxMm ? mm : maxMm;
+    return (uint8_t)((clamped * mul) >> 16);
+  }
+
+private:
+  enum Impl { SCALAR, SSE2, AVX2, NEON };
+  void select(const char *name);
+  SpanFn spanFn;
+  RowFn rowFn = nullptr;
+  const char *implName;
+  Impl impl;
+  uint16_t maxMm; // viewing range in mm. Bigger depths end up in bin 255
+  uint16_t mul;   // 16.16 fixed-point factor: bin = (mm * mul) >> 16
+};
@@ -0,0 +1,109 @@
+/* INFO
+ * Nearest object search on prefix sums of the depth histograms
+ * (see DepthSearch.hpp).
+ */
+
+//----------------------------------------------------------------------
+// INCLUDES
+//----------------------------------------------------------------------
+#include "DepthSearch.hpp"
+
+//----------------------------------------------------------------------
+// METHODS
+//----------------------------------------------------------------------
+
+//________________________________________________
+// One pass over the histogram. Bins with just a few pixels don't count for
+// the search (part of the smoothing), but do for the percentiles.
+void DepthSearch::setHistogram(int motor, const int histo[256]) {
+  int g = motor / lanes;
+  int l = motor % lanes;
+  int32_t thresholded = 0;
+  int32_t all = 0;
+  for (int i = 0; i < 256; i++) {
+    if (i >= offset && histo[i] > pixelThresh) {
+      thresholded += histo[i];
+    }
+    all += histo[i];
+    prefix[i][g][l] = thresholded;
+    cumulative[i][motor] = all;
+  }
+  first[g][l] = prefix[offset][g][l];
+}
+
+//________________________________________________
+// Walk through the bins once for all motors: per bin one vector compare per
+// 4 motors and stop as soon as every motor has found its object
+void DepthSearch::nearest(uint16_t motors, int bins[maxMotors]) const {
+  const Lanes minSize = {minObjSize, minObjSize, minObjSize, minObjSize};
+  // bit of each motor in the motor mask
+  Lanes bit[groups];
+  for (int g = 0; g < groups; g++) {
+    for (int l = 0; l < lanes; l++) {
+      bit[g][l] = 1 << (g * lanes + l);
+    }
+  }
+  for (int m = 0; m < maxMotors; m++) {
+    bins[m] = 0;
+  }
+  uint16_t open = motors;
+  for (int i = offset; i < 256 && open; i++) {
+    Lanes found = {0, 0, 0, 0};
+    if (i > offset + range) {
+      for (int g = 0; g < groups; g++) {
+        Lanes sum = prefix[i][g] - prefix[i - range][g] + first[g];
+        found |= (sum >= minSize) & bit[g];
+      }
+    } else {
+      for (int g = 0; g < groups; g++) {
+        found |= (prefix[i][g] >= minSize) & bit[g];
+      }
+    }
+    uint32_t hits = (found[0] | found[1] | found[2] | found[3]) & open;
+    open &= ~hits;
+    while (hits) {
+      int m = __builtin_ctz(hits);
+      bins[m] = i;
+      hits &= hits - 1;
+    }
+  }
+}
+
+//________________________________________________
+// Behind the nearest object the window has to drop below the threshold
+// first, the next bin where it reaches it again is the second object
+int DepthSearch::secondNearest(int motor) const {
+  int i = offset;
+  while (i < 256 && window(i, motor) < minObjSize) {
+    i++;
+  }
+  while (i < 256 && window(i, motor) >= minObjSize) {
+    i++;
+  }
+  while (i < 256 && window(i, motor) < minObjSize) {
+    i++;
+  }
+  return i < 256 ? i : 0;
+}
+
+//________________________________________________
+// Binary search on the cumulative histogram (bin 255 - out of range or
+// invalid - doesn't count)
+int DepthSearch::percentile(int motor, int percent) const {
+  int32_t inRange = cumulative[254][motor];
+  if (inRange == 0) {
+    return 255;
+  }
+  int32_t target = (int32_t)(((int64_t)inRange * percent + 99) / 100);
+  int lo = 0;
+  int hi = 254;
+  while (lo < hi) {
+    int mid = (lo + hi) / 2;
+    if (cumulative[mid][motor] >= target) {
+      hi = mid;
+    } else {
+      lo = mid + 1;
+    }
+  }
+  return lo;
+}
@@ -0,0 +1,72 @@
+#pragma once
+
+//----------------------------------------------------------------------
+// INCLUDES
+//----------------------------------------------------------------------
+#include <stdint.h>
+
+#include "ActuatorLayout.hpp"
+
+//****************************************************************
+//                         DEPTH SEARCH
+//****************************************************************
+// Finds objects in the depth histograms of all motors. Each histogram gets
+// turned into prefix sums once (while merging), afterwards every window sum
+// is just a difference of two of them. The prefix sums are stored bin by bin
+// with all motors side by side in SIMD vectors, so the nearest object of all
+// motors is searched at once with branch-free vector compares instead of one
+// sliding window with data-dependent branches per motor.
+//
+// The results are exactly those of the original sliding window search:
+// starting at bin `offset`, bins with more than `pixelThresh` pixels are
+// summed up in a window of `range` bins (the first bin, `offset`, is never
+// dropped from the window again) and the first bin where the sum reaches
+// `minObjSize` is the nearest object (0 if there is none).
+
+class DepthSearch {
+public:
+  static const int maxMotors = ActuatorLayout::maxMotors;
+  static const int offset = 14; // exclude the first 17cm because of
+                                // oversaturation issues and noisy data the
+                                // Pico Flexx has in this range
+  static const int range = 50;  // look in a tolerance range of 50cm
+  static const int pixelThresh = 5; // ignore bins with just a few pixels
+  static const int minObjSize = 90; // the min number of pixels, an object
+                                    // must have (smaller ones might be noise)
+
+  // build the prefix sums of one motor's histogram
+  void setHistogram(int motor, const int histo[256]);
+
+  // nearest object (bin, 0 if none) of every motor in `motors` -> bins[]
+  void nearest(uint16_t motors, int bins[maxMotors]) const;
+  // next object behind the nearest one (bin, 0 if none)
+  int secondNearest(int motor) const;
+  // first depth bin at or below which at least `percent` of the pixels in
+  // range are (255 if the motor has no pixels in range)
+  int percentile(int motor, int percent) const;
+
+  // 4 motors side by side (GCC vector extension: SSE2 on x86, NEON on arm)
+  typedef int32_t Lanes __attribute__((vector_size(16)));
+  static const int lanes = 4;
+  static const int groups = maxMotors / lanes;
+  static_assert(maxMotors % lanes == 0, "motors have to fill whole vectors");
+
+private:
+  // windowed sum of the thresholded histogram that ends at bin i (i>=offset)
+  inline int window(int i, int motor) const {
+    int g = motor / lanes;
+    int l = motor % lanes;
+    int sum = prefix[i][g][l];
+    if (i > offset + range) {
+      sum -= prefix[i - range][g][l] - first[g][l];
+    }
+    return sum;
+  }
+
+  // sum of the thresholded bins offset..i (0 below offset)
+  Lanes prefix[256][groups] = {};
+  // sum of all bins 0..i
+  int32_t cumulative[256][maxMotors] = {};
+  // thresholded count of bin `offset`, which stays in every window
+  Lanes first[groups] = {};
+};
@@ -0,0 +1,79 @@
+#pragma once
+
+//----------------------------------------------------------------------
+// INCLUDES
+//----------------------------------------------------------------------
+#include <stdint.h>
+
+#include <atomic>
+
+//****************************************************************
+//                         FRAME MAILBOX
+//****************************************************************
+// Lock-free triple buffer between exactly one producer (the royale callback)
+// and one consumer (the processing thread).
+// The producer always owns a free slot to write the next frame to, so it
+// never has to wait and never drops the newest frame. If the consumer did not
+// pick up the previously published frame yet, that one gets overwritten (and
+// counted). The consumer always gets the freshest complete frame.
+//
+// Slots are owned by exactly one side at a time:
+// back   -> producer is writing to it
+// middle -> last published frame, swapped atomically by both sides
+// front  -> consumer is reading from it (until its next acquire())
+template <typename T> class FrameMailbox {
+public:
+  //________________________________________________
+  // PRODUCER SIDE
+  // Slot to fill. Stays valid until publish() is called.
+  T &writeSlot() { return slots[back]; }
+
+  // Hand the filled slot over to the consumer and get a free one back
+  void publish() {
+    uint8_t prev = middle.exchange(back | freshBit, std::memory_order_acq_rel);
+    back = prev & indexMask;
+    a_published.fetch_add(1, std::memory_order_relaxed);
+    if (prev & freshBit) {
+      // consumer was too slow: the frame in the middle never got processed
+      a_overwritten.fetch_add(1, std::memory_order_relaxed);
+    }
+  }
+
+  //________________________________________________
+  // CONSUMER SIDE
+  // Is there a frame the consumer didn't acquire yet?
+  bool hasNew() const {
+    return middle.load(std::memory_order_acquire) & freshBit;
+  }
+
+  // Get the freshest published frame (or nullptr if there is nothing new).
+  // It stays valid and untouched by the producer until the next acquire().
+  const T *acquire() {
+    if (!hasNew()) {
+      return nullptr;
+    }
+    uint8_t prev = middle.exchange(front, std::memory_order_acq_rel);
+    front = prev & indexMask;
+    a_consumed.fetch_add(1, std::memory_order_relaxed);
+    return &slots[front];
+  }
+
+  //________________________________________________
+  // STATISTICS (can be read from any thread)
+  long published() const { return a_published; }
+  long overwritten() const { return a_overwritten; }
+  long consumed() const { return a_consumed; }
+
+private:
+  static const uint8_t indexMask = 0x03;
+  static const uint8_t freshBit = 0x04;
+
+  T slots[3];
+  // keep the indices of both sides on separate cache lines
+  alignas(64) uint8_t back = 0;
+  alignas(64) uint8_t front = 1;
+  alignas(64) std::atomic<uint8_t> middle{2};
+  std::atomic<long> a_published{0};
+  std::atomic<long> a_overwritten{0};
+  std::atomic<long> a_consumed{0};
+};
@@ -0,0 +1,78 @@
+/* INFO
+ * Common part of all frame sources: handing a new frame over to the
+ * processing (see FrameSource.hpp).
+ */
+
+//----------------------------------------------------------------------
+// INCLUDES
+//----------------------------------------------------------------------
+#include "FrameSource.hpp"
+
+#include <stdio.h>
+
+#include <mutex>
+
+#include "Camera.hpp"
+#include "Globals.hpp"
+
+//----------------------------------------------------------------------
+// METHODS
+//----------------------------------------------------------------------
+// defined here, where DepthDataUtilities is complete
+FrameSource::~FrameSource() {}
+
+//________________________________________________
+// The free slot of the lock-free frame mailbox. Never blocks: if the
+// processing thread is still busy with an older frame, the frame written
+// here simply replaces the last unprocessed one.
+DepthFrame &FrameSource::beginFrame() {
+  Glob::logger.newDataLog.reset();
+  Glob::logger.newDataLog.store("onNewData");
+  Glob::logger.pauseLog.store("endPause");
+  Glob::logger.mainLogger.reset();
+  Glob::logger.mainLogger.store("start");
+  Glob::logger.mainLogger.store("startOnNew");
+  DepthFrame &frame = Glob::frameMailbox.writeSlot();
+  frame.traceId = Glob::tracer.begin();
+  return frame;
+}
+
+//________________________________________________
+void FrameSource::publishFrame() {
+  Glob::logger.mainLogger.store("copy");
+  const DepthFrame &frame = Glob::frameMailbox.writeSlot();
+  Glob::tracer.copied(frame.traceId, frame.timeStamp);
+  if (!Glob::modes.a_inline) {
+    // hand it over before it can be seen (so it can't get taken before)
+    Glob::notifyProcess.handoff.give();
+  }
+  Glob::frameMailbox.publish();
+  Glob::logger.mainLogger.store("publish");
+  if (Glob::modes.a_inline) {
+    if (!inlineProcessor) {
+      inlineProcessor.reset(new DepthDataUtilities());
+    }
+    Glob::logger.mainLogger.store("notifyProcessing"); // no hop
+    inlineProcessor->processData();
+    return;
+  }
+  // wake other thread. The processing thread holds this mutex only while it
+  // checks for new frames, never while processing -> no real waiting here.
+  // Taking it once makes sure the wakeup can't get lost in between its check
+  // and its wait.
+  { std::lock_guard<std::mutex> pdCondLock(Glob::notifyProcess.mut); }
+  Glob::notifyProcess.cond.notify_one();
+  Glob::logger.mainLogger.store("notifyProcessing");
+}
+
+//________________________________________________
+void FrameSource::printPipelineSummary() const {
+  printf("%s: whole cycle p50 %u us, p99 %u us, max %u us\n", name(),
+         Glob::cycleLatency.percentile(50), Glob::cycleLatency.percentile(99),
+         Glob::cycleLatency.max());
+  Glob::tracer.printSummary(name());
+  printf("%s: %li i2c writes%s, %li saved by the shadow registers\n",
+         name(), Glob::i2c.writeCount(),
+         Glob::i2c.isSimulated() ? " (simulated)" : "",
+         Glob::motorBoard.savedWrites());
+}
@@ -0,0 +1,57 @@
+#pragma once
+
+//----------------------------------------------------------------------
+// INCLUDES
+//----------------------------------------------------------------------
+#include <memory>
+
+#include "DepthFrame.hpp"
+
+class DepthDataUtilities;
+
+//****************************************************************
+//                          FRAME SOURCE
+//****************************************************************
+// Where the depth frames come from: the live Pico Flexx (RoyaleSource), a
+// recorded session (ReplaySource) or generated scenes (SyntheticSource).
+// unfolding() only talks to this interface, the rest of the pipeline (frame
+// mailbox, processing, motors) is the same for every source.
+// A source delivers its frames from its own thread by filling beginFrame()
+// and handing it over with publishFrame().
+
+class FrameSource {
+public:
+  virtual ~FrameSource();
+  // the camera: RoyaleSource, in the host simulator (unfolding-sim) generated
+  // frames at the rate of the camera mode. Defined by whichever gets linked.
+  static FrameSource *camera();
+
+  // find and prepare the device or file (may block, e.g. until a camera is
+  // plugged in). Returns false on errors that can't be recovered from.
+  virtual bool open() = 0;
+  // start/stop delivering frames
+  virtual bool start() = 0;
+  virtual bool stop() = 0;
+  // state for the watchdog in unfolding()
+  virtual bool isConnected() = 0;
+  virtual bool isCapturing() = 0;
+  // true when a finite source has delivered all its frames
+  virtual bool finished() { return false; }
+  virtual const char *name() const = 0;
+  // frames delivered, throughput and cycle latency (printed when a finite
+  // source is finished)
+  virtual void printSummary() {}
+
+protected:
+  // the part of the summary that is the same for every source
+  void printPipelineSummary() const;
+  // slot of the frame mailbox to copy the next frame to
+  DepthFrame &beginFrame();
+  // publish the filled slot: wakes the processing thread or, in the inline
+  // mode, processes the frame right away on the calling thread
+  void publishFrame();
+
+private:
+  // processes the frames right in publishFrame() in the inline mode
+  std::unique_ptr<DepthDataUtilities> inlineProcessor;
+};
@@ -0,0 +1,234 @@
+/* INFO
+ * Trace record of every frame from the camera to the motors and the latency
+ * histograms made from them (see FrameTracer.hpp).
+ */
+
+//----------------------------------------------------------------------
+// INCLUDES
+//----------------------------------------------------------------------
+#include "FrameTracer.hpp"
+
+#include <stdio.h>
+
+#include <algorithm>
+#include <chrono>
+#include <mutex>
+#include <vector>
+
+#include "Clock.hpp"
+#include "Globals.hpp"
+
+using namespace std::chrono;
+
+//----------------------------------------------------------------------
+// DECLARATIONS AND VARIABLES
+//----------------------------------------------------------------------
+// a capture timestamp older than that at the callback isn't on the system
+// clock (recorded or synthetic frames)
+const int64_t maxCaptureAgeUs = 1000000;
+// send the percentiles via udp every n finished frames
+const uint64_t sendInterval = 30;
+
+const char *const stageNames[FrameTracer::stages] = {
+    "callback", "copy", "processStart", "processEnd", "bank0", "bank1", "udp"};
+
+static int64_t nowUs() {
+  return duration_cast<microseconds>(Clock::now().time_since_epoch()).count();
+}
+
+//----------------------------------------------------------------------
+// METHODS
+//----------------------------------------------------------------------
+const char *FrameTracer::stageName(int stage) { return stageNames[stage]; }
+
+//________________________________________________
+// Takes the record of the frame 64 IDs ago. Its ID is cleared while the
+// record gets reset, so late marks of that frame are dropped.
+uint32_t FrameTracer::begin() {
+  uint32_t id = nextId.fetch_add(1, std::memory_order_relaxed);
+  if (id == 0) {
+    id = nextId.fetch_add(1, std::memory_order_relaxed); // wrapped around
+  }
+  Record &record = records[id % ringSize];
+  record.id.store(0, std::memory_order_release);
+  record.cameraStamp.store(0, std::memory_order_relaxed);
+  record.captureAge.store(-1, std::memory_order_relaxed);
+  for (auto &t : record.at) {
+    t.store(0, std::memory_order_relaxed);
+  }
+  for (auto &t : record.motorAt) {
+    t.store(0, std::memory_order_relaxed);
+  }
+  record.at[CALLBACK].store(nowUs(), std::memory_order_relaxed);
+  record.id.store(id, std::memory_order_release);
+  return id;
+}
+
+//________________________________________________
+FrameTracer::Record *FrameTracer::find(uint32_t id) {
+  Record &record = records[id % ringSize];
+  if (id == 0 || record.id.load(std::memory_order_acquire) != id) {
+    return nullptr;
+  }
+  return &record;
+}
+
+const FrameTracer::Record *FrameTracer::find(uint32_t id) const {
+  return const_cast<FrameTracer *>(this)->find(id);
+}
+
+//________________________________________________
+// The live camera stamps its frames on the system clock: how long ago the
+// capture was at the callback
+void FrameTracer::copied(uint32_t id, int64_t cameraStamp) {
+  Record *record = find(id);
+  if (record == nullptr) {
+    return;
+  }
+  int64_t now = nowUs();
+  record->at[COPY].store(now, std::memory_order_relaxed);
+  record->cameraStamp.store(cameraStamp, std::memory_order_relaxed);
+  if (Clock::isVirtual()) {
+    return;
+  }
+  int64_t sinceCapture =
+      duration_cast<microseconds>(system_clock::now().time_since_epoch())
+          .count() -
+      cameraStamp;
+  int64_t age = sinceCapture - (now - record->at[CALLBACK]);
+  if (age >= 0 && age < maxCaptureAgeUs) {
+    record->captureAge.store(age, std::memory_order_relaxed);
+  }
+}
+
+//________________________________________________
+void FrameTracer::mark(uint32_t id, Stage stage) {
+  Record *record = find(id);
+  if (record != nullptr) {
+    record->at[stage].store(nowUs(), std::memory_order_relaxed);
+  }
+}
+
+void FrameTracer::markMotor(uint32_t id, int motor) {
+  Record *record = find(id);
+  if (record != nullptr && motor >= 0 && motor < ActuatorLayout::maxMotors) {
+    record->motorAt[motor].store(nowUs(), std::memory_order_relaxed);
+  }
+}
+
+//________________________________________________
+// Latencies since the callback of every stage and motor the frame reached.
+// A frame only finishes once.
+void FrameTracer::finish(uint32_t id) {
+  Record *record = find(id);
+  if (record == nullptr ||
+      record->at[PUBLISHED].exchange(nowUs(), std::memory_order_relaxed)) {
+    return;
+  }
+  int64_t start = record->at[CALLBACK].load(std::memory_order_relaxed);
+  for (int s = COPY; s < stages; s++) {
+    int64_t t = record->at[s].load(std::memory_order_relaxed);
+    if (t != 0) {
+      stageLatency[s].record((uint32_t)std::max<int64_t>(t - start, 0));
+    }
+  }
+  int64_t actuated = 0; // last register write of the frame
+  for (int m = 0; m < Glob::layout.motorCount(); m++) {
+    int64_t t = record->motorAt[m].load(std::memory_order_relaxed);
+    if (t != 0) {
+      motorLatency[m].record((uint32_t)std::max<int64_t>(t - start, 0));
+      actuated = std::max(actuated, t);
+    }
+  }
+  int64_t age = record->captureAge.load(std::memory_order_relaxed);
+  if (actuated != 0 && age >= 0) {
+    int64_t sinceCallback = std::max<int64_t>(actuated - start, 0);
+    captureLatency.record((uint32_t)(age + sinceCallback));
+  }
+  if (stageLatency[PUBLISHED].count() % sendInterval == 0) {
+    sendPercentiles();
+  }
+}
+
+//________________________________________________
+// traceLat: p50, p99 of the stages copy ... udp and of capture -> motors,
+// motorLat: p50, p99 of every motor. All uint32 in us, little endian.
+void FrameTracer::sendPercentiles() {
+  auto put = [](std::vector<unsigned char> &out, uint32_t value) {
+    for (int i = 0; i < 4; i++) {
+      out.push_back((value >> (8 * i)) & 0xFF);
+    }
+  };
+  std::vector<unsigned char> stageVect;
+  for (int s = COPY; s < stages; s++) {
+    put(stageVect, stageLatency[s].percentile(50));
+    put(stageVect, stageLatency[s].percentile(99));
+  }
+  put(stageVect, captureLatency.percentile(50));
+  put(stageVect, captureLatency.percentile(99));
+  std::vector<unsigned char> motorVect;
+  for (int m = 0; m < Glob::layout.motorCount(); m++) {
+    put(motorVect, motorLatency[m].percentile(50));
+    put(motorVect, motorLatency[m].percentile(99));
+  }
+  std::lock_guard<std::mutex> lockSendLat(Glob::udpServMux);
+  Glob::udpServer.preparePacket("traceLat", stageVect);
+  Glob::udpServer.preparePacket("motorLat", motorVect);
+}
+
+//________________________________________________
+// Percentile table and the newest records (times in us since the callback,
+// "-": stage not reached, e.g. a bank without motors in the frame)
+void FrameTracer::dump(int frames) const {
+  printf("frame latency since the callback (us):\n  %-14s %8s %8s %8s %8s\n",
+         "", "p50", "p99", "max", "frames");
+  auto row = [](const char *name, const LatencyHistogram &histo) {
+    printf("  %-14s %8u %8u %8u %8llu\n", name, histo.percentile(50),
+           histo.percentile(99), histo.max(),
+           (unsigned long long)histo.count());
+  };
+  for (int s = COPY; s < stages; s++) {
+    row(stageName(s), stageLatency[s]);
+  }
+  for (int m = 0; m < Glob::layout.motorCount(); m++) {
+    char name[24];
+    snprintf(name, sizeof(name), "motor %i", m);
+    row(name, motorLatency[m]);
+  }
+  if (captureLatency.count() > 0) {
+    row("capture->motor", captureLatency);
+  }
+  uint32_t newest = nextId.load(std::memory_order_relaxed) - 1;
+  for (int i = std::min(frames, ringSize) - 1; i >= 0; i--) {
+    const Record *record = find(newest - i);
+    if (record == nullptr) {
+      continue;
+    }
+    int64_t start = record->at[CALLBACK].load(std::memory_order_relaxed);
+    printf("  frame %u (camera %lld us):", newest - i,
+           (long long)record->cameraStamp.load(std::memory_order_relaxed));
+    for (int s = COPY; s < stages; s++) {
+      int64_t t = record->at[s].load(std::memory_order_relaxed);
+      if (t != 0) {
+        printf(" %s %lld", stageName(s), (long long)(t - start));
+      } else {
+        printf(" %s -", stageName(s));
+      }
+    }
+    printf("\n");
+  }
+}
+
+//________________________________________________
+void FrameTracer::printSummary(const char *name) const {
+  printf("%s: since the callback p50/p99 (us):", name);
+  for (int s = COPY; s < stages; s++) {
+    printf(" %s %u/%u", stageName(s), stageLatency[s].percentile(50),
+           stageLatency[s].percentile(99));
+  }
+  printf("\n");
+  if (captureLatency.count() > 0) {
+    printf("%s: capture -> last motor written p50 %u us, p99 %u us\n", name,
+           captureLatency.percentile(50), captureLatency.percentile(99));
+  }
+}
@@ -0,0 +1,85 @@
+#pragma once
+
+//----------------------------------------------------------------------
+// INCLUDES
+//----------------------------------------------------------------------
+#include <stdint.h>
+
+#include <atomic>
+
+#include "ActuatorLayout.hpp"
+#include "LatencyHistogram.hpp"
+
+//****************************************************************
+//                          FRAME TRACER
+//****************************************************************
+// Follows every frame from the camera to the motors. The frame source gives
+// each frame an ID (DepthFrame::traceId) and every stage it passes marks the
+// time in the frame's own record: the callback, the copy into the mailbox,
+// start and end of the processing, the last write to each TCA bank and to
+// each motor and finally the udp packet with its motor values. Frames that
+// overlap (the next one arrives while the last is still being sent) can't
+// overwrite each other's timings like with the TimeLoggers.
+// finish() turns a record into latencies since the callback, one histogram
+// per stage and per motor, and from the camera's capture timestamp to the
+// last register write where the camera stamps on the system clock (live
+// camera). Percentiles go out via udp, dump() prints them (udp request 'l').
+// The records are a ring of the last 64 frames. Lock-free: every stage is
+// marked by one thread, any thread may read. A frame that got overwritten in
+// the mailbox never finishes.
+
+class FrameTracer {
+public:
+  // stages of a frame, in the order they happen
+  enum Stage {
+    CALLBACK,
+    COPY,
+    PROCESS_START,
+    PROCESS_END,
+    BANK_0, // last motor on the first TCA written
+    BANK_1, // last motor on the second TCA written
+    PUBLISHED,
+    stages
+  };
+  static const int ringSize = 64;
+
+  // a new frame arrives (in the source's thread): its ID, never 0
+  uint32_t begin();
+  // the frame is copied, `cameraStamp` is its capture time (us) as the
+  // source delivers it
+  void copied(uint32_t id, int64_t cameraStamp);
+  // IDs that aren't in the ring (any more), like 0, are ignored
+  void mark(uint32_t id, Stage stage);
+  void markMotor(uint32_t id, int motor);
+  // the motor values went out via udp: the frame's latencies go into the
+  // histograms (and every 30 frames their percentiles via udp)
+  void finish(uint32_t id);
+
+  // percentiles of all stages and motors and the last `frames` records
+  void dump(int frames = 8) const;
+  // one line per stage (end of a replay or synthetic frames)
+  void printSummary(const char *name) const;
+  static const char *stageName(int stage);
+
+private:
+  struct Record {
+    std::atomic<uint32_t> id{0};
+    std::atomic<int64_t> cameraStamp{0};
+    // capture -> callback (us), -1: unknown
+    std::atomic<int64_t> captureAge{-1};
+    // Clock time in us, 0: not (yet) reached
+    std::atomic<int64_t> at[stages] = {};
+    std::atomic<int64_t> motorAt[ActuatorLayout::maxMotors] = {};
+  };
+  Record *find(uint32_t id);
+  const Record *find(uint32_t id) const;
+  void sendPercentiles();
+
+  Record records[ringSize];
+  std::atomic<uint32_t> nextId{1};
+  // since the callback, by stage / motor
+  LatencyHistogram stageLatency[stages];
+  LatencyHistogram motorLatency[ActuatorLayout::maxMotors];
+  // camera capture -> last register write of the frame
+  LatencyHistogram captureLatency;
+};
@@ -38,17 +38,22 @@ Imu Glob::imu;
 Led Glob::led1(28, 11, 27);
 Led Glob::led2(10, 29, 6);
 
-std::atomic<int> Glob::a_lockFailCounter{0};
 std::atomic<bool> Glob::a_restartUnfoldingFlag{false};
+ActuatorLayout Glob::layout;
 // Init structs
 RoyalStatus Glob::royalStats;
 Modes Glob::modes;
 Motors Glob::motors;
 Logger Glob::logger;
-RoyalDepthData Glob::royalDepthData;
+FrameMailbox<DepthFrame> Glob::frameMailbox;
 CvDepthImg Glob::cvDepthImg;
 ThreadNotification Glob::notifyProcess;
-ThreadNotification Glob::notifySend;
+SendNotification Glob::notifySend;
+FrameMailbox<MotorFrame> Glob::motorMailbox;
+LatencyHistogram Glob::cycleLatency;
+FrameTracer Glob::tracer;
+SpanHistograms Glob::spanHistograms;
+Recorder Glob::recorder;
 Counters Glob::counters;
 
 //________________________________________________
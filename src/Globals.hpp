@@ -2,12 +2,19 @@
 #include <boost/asio.hpp>
 #include <mutex>
 #include <opencv2/opencv.hpp>
-#include <royale.hpp>
 
+#include "ActuatorLayout.hpp"
 #include "Camera.hpp"
+#include "Clock.hpp"
+#include "DepthFrame.hpp"
+#include "FrameMailbox.hpp"
+#include "FrameTracer.hpp"
 #include "i2c/I2C.hpp"
 #include "i2c/Imu.hpp"
+#include "LatencyHistogram.hpp"
 #include "MotorBoard.hpp"
+#include "Recorder.hpp"
+#include "SpanHistograms.hpp"
 #include "TimeLogger.hpp"
 #include "UdpServer.hpp"
 #include "Led.hpp"
@@ -37,11 +44,29 @@ struct Modes {
              // always on because of dependencies of msSinceEntry
   std::atomic<bool> a_doLogPrint{false}; // printf all TimeLogger values –
   std::atomic<unsigned int> a_cameraUseCase{3};
+  // threads processing one frame in row bands. 0: detect automatically
+  std::atomic<int> a_workers{0};
+  // incremental processing: tolerance (in depth bins) below which a block of
+  // the frame counts as unchanged. -1: off, every frame is processed fully
+  std::atomic<int> a_changeTol{-1};
+  // process frames right in the royale callback (set at startup only)
+  std::atomic<bool> a_inline{false};
+  // no i2c and GPIO access, writes are only counted (set at startup only)
+  std::atomic<bool> a_simulate{false};
+};
+
+// Motor values of one frame, handed from the royale callback to the sending
+// thread in the inline mode
+struct MotorFrame {
+  unsigned char values[ActuatorLayout::maxMotors];
+  int count;
+  uint32_t traceId; // FrameTracer ID of the frame
 };
 
 struct Motors : Base {
-  unsigned char testTiles[9];
-  unsigned char tiles[9]; // 9 tiles | motor valsˇ
+  // one value per motor of the layout (3x3 glove: 9)
+  unsigned char testTiles[ActuatorLayout::maxMotors];
+  unsigned char tiles[ActuatorLayout::maxMotors]; // motor vals
 };
 
 struct Logger : Base {
@@ -56,13 +81,21 @@ struct CvDepthImg : Base {
   cv::Mat mat; // full depth image (one byte p. pixel)
 };
 
-struct RoyalDepthData : Base {
-  royale::DepthData dat;
-};
-
+// (handoff: keeps virtual time from moving on until the woken thread runs)
 struct ThreadNotification : Base {
   std::condition_variable cond;
   bool flag{false};
+  Clock::Handoff handoff;
+};
+
+// The sending thread gets woken for every finished row of tiles (one bit per
+// motor that has a new value) and once more when the whole frame is done
+// (flag)
+struct SendNotification : ThreadNotification {
+  std::atomic<uint16_t> a_pendingMotors{0};
+  // FrameTracer IDs of the frame the pending motors / the flag belong to
+  uint32_t segmentFrame{0};
+  uint32_t doneFrame{0};
 };
 
 struct Counters {
@@ -88,20 +121,33 @@ extern Imu imu;
 extern Led led1;
 extern Led led2;
 
-// Counts when there is onNewData() while the previous wasn't finished yet.
-// We don't want this -> royal library gets unstable
-extern std::atomic<int> a_lockFailCounter;
 extern std::atomic<bool> a_restartUnfoldingFlag;
 
+// which image region drives which motor. Set once at startup (--layout),
+// read-only afterwards -> no mutex
+extern ActuatorLayout layout;
+
 // INIT ALL STRUCTS
 extern RoyalStatus royalStats;
 extern Modes modes;
 extern Motors motors;
 extern Logger logger;
 extern CvDepthImg cvDepthImg;
-extern RoyalDepthData royalDepthData;
+// Newest frame from onNewData() for the processing thread (lock-free).
+// Counts frames that got overwritten before they were processed.
+extern FrameMailbox<DepthFrame> frameMailbox;
 extern ThreadNotification notifyProcess;
-extern ThreadNotification notifySend;
+extern SendNotification notifySend;
+// Inline mode: motor values of the newest frame (lock-free)
+extern FrameMailbox<MotorFrame> motorMailbox;
+// whole cycle (onNewData -> last motor written) of every frame, for p50/p99
+extern LatencyHistogram cycleLatency;
+// trace of every frame from the camera to the motors (lock-free)
+extern FrameTracer tracer;
+// session histograms of the TimeLogger spans (lock-free)
+extern SpanHistograms spanHistograms;
+// session recording (--record), lock-free for the pipeline threads
+extern Recorder recorder;
 extern Counters counters;
 void printBinary(uint8_t a, bool lineBreak);
 } // namespace Glob
@@ -0,0 +1,78 @@
+/* INFO
+ * Lock-free log-linear histogram for latency percentiles
+ * (see LatencyHistogram.hpp).
+ */
+
+//----------------------------------------------------------------------
+// INCLUDES
+//----------------------------------------------------------------------
+#include "LatencyHistogram.hpp"
+
+//----------------------------------------------------------------------
+// METHODS
+//----------------------------------------------------------------------
+
+//________________________________________________
+// Values below 16 get a bucket each, above that the highest set bit selects
+// the power of two and the next 4 bits the bucket within it
+int LatencyHistogram::bucketOf(uint32_t us) {
+  if (us < (uint32_t)subBuckets) {
+    return us;
+  }
+  int msb = 31 - __builtin_clz(us);
+  int shift = msb - subBits;
+  return (shift + 1) * subBuckets + (int)((us >> shift) & (subBuckets - 1));
+}
+
+//________________________________________________
+// Biggest value that ends up in this bucket
+uint32_t LatencyHistogram::upperBound(int bucket) {
+  if (bucket < subBuckets) {
+    return bucket;
+  }
+  int shift = bucket / subBuckets - 1;
+  uint64_t lower = (uint64_t)(subBuckets + bucket % subBuckets) << shift;
+  return (uint32_t)(lower + (1ull << shift) - 1);
+}
+
+//________________________________________________
+void LatencyHistogram::record(uint32_t us) {
+  buckets[bucketOf(us)].fetch_add(1, std::memory_order_relaxed);
+  total.fetch_add(1, std::memory_order_relaxed);
+  uint32_t prev = maxValue.load(std::memory_order_relaxed);
+  while (us > prev &&
+         !maxValue.compare_exchange_weak(prev, us, std::memory_order_relaxed)) {
+  }
+}
+
+//________________________________________________
+void LatencyHistogram::reset() {
+  for (auto &bucket : buckets) {
+    bucket.store(0, std::memory_order_relaxed);
+  }
+  total.store(0, std::memory_order_relaxed);
+  maxValue.store(0, std::memory_order_relaxed);
+}
+
+//________________________________________________
+// Walk through the buckets until the wanted share of all values is reached
+uint32_t LatencyHistogram::percentile(double percent) const {
+  uint64_t n = count();
+  if (n == 0) {
+    return 0;
+  }
+  uint64_t target = (uint64_t)(percent / 100.0 * n + 0.5);
+  if (target < 1) {
+    target = 1;
+  }
+  uint64_t seen = 0;
+  for (int i = 0; i < bucketCount; i++) {
+    seen += buckets[i].load(std::memory_order_relaxed);
+    if (seen >= target) {
+      uint32_t bound = upperBound(i);
+      uint32_t biggest = max();
+      return bound < biggest ? bound : biggest;
+    }
+  }
+  return max(); // values recorded while we were counting
+}
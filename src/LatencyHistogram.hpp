@@ -0,0 +1,39 @@
+#pragma once
+
+//----------------------------------------------------------------------
+// INCLUDES
+//----------------------------------------------------------------------
+#include <stdint.h>
+
+#include <atomic>
+
+//****************************************************************
+//                       LATENCY HISTOGRAM
+//****************************************************************
+// Histogram of durations (in us) to get percentiles like p50 / p99 without
+// storing every value. Log-linear buckets (HDR style): every power of two is
+// split into 16 buckets, so any value is known with a precision of ~6%,
+// from 1 us up to more than an hour. record() is lock-free and can be called
+// from any thread, reading percentiles doesn't block the recording threads.
+
+class LatencyHistogram {
+public:
+  void record(uint32_t us);
+  void reset();
+  uint64_t count() const { return total.load(std::memory_order_relaxed); }
+  // upper bound of the bucket holding the given percentile (at most the
+  // biggest value recorded, 0 if empty)
+  uint32_t percentile(double percent) const;
+  uint32_t max() const { return maxValue.load(std::memory_order_relaxed); }
+
+private:
+  static const int subBits = 4;
+  static const int subBuckets = 1 << subBits;
+  static const int bucketCount = (32 - subBits + 1) * subBuckets;
+  static int bucketOf(uint32_t us);
+  static uint32_t upperBound(int bucket);
+
+  std::atomic<uint32_t> buckets[bucketCount] = {};
+  std::atomic<uint64_t> total{0};
+  std::atomic<uint32_t> maxValue{0};
+};
@@ -1,81 +1,94 @@
 /* INFO
  * Small library to control LEDs on the Unfolding Space Carrier Board
- * Using wiringpi 2.60 (suited for CM4) from  https://github.com/WiringPi
+ * GPIO through Platform.hpp (wiringpi 2.60, suited for CM4, from
+ * https://github.com/WiringPi)
  */
 
 //----------------------------------------------------------------------
 // INCLUDES
 //----------------------------------------------------------------------
 #include "Globals.hpp"
-
-#include <wiringPi.h>
+#include "Platform.hpp"
 
 //----------------------------------------------------------------------
 // METHODS
 //----------------------------------------------------------------------
+// no GPIO access with simulated outputs (--simulate)
+static void setPinMode(int pin, Platform::PinMode mode) {
+  if (!Glob::modes.a_simulate) {
+    Platform::pinMode(pin, mode);
+  }
+}
+
+static void writePin(int pin, int value) {
+  if (!Glob::modes.a_simulate) {
+    Platform::digitalWrite(pin, value);
+  }
+}
+
 void Led::init() {
-  pinMode(rPin, OUTPUT);
-  pinMode(gPin, OUTPUT);
-  pinMode(bPin, OUTPUT);
-  digitalWrite(rPin, 1);
-  digitalWrite(gPin, 1);
-  digitalWrite(bPin, 1);
+  setPinMode(rPin, Platform::Output);
+  setPinMode(gPin, Platform::Output);
+  setPinMode(bPin, Platform::Output);
+  writePin(rPin, 1);
+  writePin(gPin, 1);
+  writePin(bPin, 1);
 }
 
 void Led::setR(bool val) {
   // dirty hack: set back to Output before writing
-  pinMode(rPin, OUTPUT);
-  digitalWrite(rPin, !val);
+  setPinMode(rPin, Platform::Output);
+  writePin(rPin, !val);
 }
 
 void Led::setG(bool val) {
   // dirty hack: set back to Output before writing
-  pinMode(gPin, OUTPUT);
-  digitalWrite(gPin, !val);
+  setPinMode(gPin, Platform::Output);
+  writePin(gPin, !val);
 }
 
 void Led::setB(bool val) {
   // dirty hack: set back to Output before writing
-  pinMode(bPin, OUTPUT);
-  digitalWrite(bPin, !val);
+  setPinMode(bPin, Platform::Output);
+  writePin(bPin, !val);
 }
 
 void Led::setDimR(bool val) {
   // dirty hack: use INPUT pullup to make dim light
   if (!val) {
-    pinMode(rPin, OUTPUT);
-    digitalWrite(rPin, 1);
+    setPinMode(rPin, Platform::Output);
+    writePin(rPin, 1);
   } else {
-    pinMode(rPin, INPUT);
+    setPinMode(rPin, Platform::Input);
   }
 }
 
 void Led::setDimG(bool val) {
   // dirty hack: use INPUT pullup to make dim light
   if (!val) {
-    pinMode(gPin, OUTPUT);
-    digitalWrite(gPin, 1);
+    setPinMode(gPin, Platform::Output);
+    writePin(gPin, 1);
   } else {
-    pinMode(gPin, INPUT);
+    setPinMode(gPin, Platform::Input);
   }
 }
 
 void Led::setDimB(bool val) {
   // dirty hack: use INPUT pullup to make dim light
   if (!val) {
-    pinMode(bPin, OUTPUT);
-    digitalWrite(bPin, 1);
+    setPinMode(bPin, Platform::Output);
+    writePin(bPin, 1);
   } else {
-    pinMode(bPin, INPUT);
+    setPinMode(bPin, Platform::Input);
   }
 }
 
 void Led::off() {
   // dirty hack: set back to Output before writing
-  pinMode(rPin, OUTPUT);
-  pinMode(gPin, OUTPUT);
-  pinMode(gPin, OUTPUT);
-  digitalWrite(rPin, 1);
-  digitalWrite(gPin, 1);
-  digitalWrite(bPin, 1);
+  setPinMode(rPin, Platform::Output);
+  setPinMode(gPin, Platform::Output);
+  setPinMode(gPin, Platform::Output);
+  writePin(rPin, 1);
+  writePin(gPin, 1);
+  writePin(bPin, 1);
 }
\ No newline at end of file
@@ -10,17 +10,26 @@
 //----------------------------------------------------------------------
 #include "MotorBoard.hpp"
 
+#include <algorithm>
 #include <iostream>
 
 #include "Camera.hpp"
+#include "Clock.hpp"
 #include "Globals.hpp"
 #include "MotorBoardDefs.hpp"
 #include "TimeLogger.hpp"
 
+using namespace std::chrono;
+
 //----------------------------------------------------------------------
 // METHODS
 //----------------------------------------------------------------------
 
+MotorBoard::MotorBoard() {
+  std::fill(std::begin(rtpShadow), std::end(rtpShadow), unknownValue);
+}
+
+//________________________________________________
 // initially set up all TCA9548A, DRV2605 and the actuators
 void MotorBoard::setupGlove() {
   {
@@ -29,79 +38,144 @@ void MotorBoard::setupGlove() {
   }
   // resetAll(); //to stop ongoing vibrations or faulty settings
   // Write settings to all drivers and start simultaneous auto calibration
-  for (int u = 0; u < 9; u++) {
-    drvSelect(u); // select the driver to write to
-    while (setupLRA(startupCalib) != 0) {
-      // printf("writing settings to no %i failed \n", u); //Send all register
-      // settings and "GO" bit to start auto calibration
-    }
-  }
+  setupAllLRAs(startupCalib);
+  drivenMotors = 0;
   // the following calibration process can be skipped (startupCalib=false).
   // The standard values do their job well enough
   if (startupCalib) {
     runCalib();
+    return;
+  }
+  // the results of the last calibration instead of the standard values, or
+  // a calibration once the glove runs (nothing to read back from simulated
+  // outputs)
+  if (calibPath.empty() || !Glob::i2c.readsDevices()) {
+    return;
+  }
+  if (calibCache.load(calibPath, hardwareFingerprint(),
+                      Glob::layout.motorCount())) {
+    applyCalibration();
+    calibDue = false;
+    printf("calibration of %i LRAs from %s\n", calibCache.size(),
+           calibPath.c_str());
+  } else {
+    calibDue = true;
+    printf("no calibration of this glove in %s, calibrating while running\n",
+           calibPath.c_str());
   }
 }
 
+//________________________________________________
+// Send the values of all motors and finish the frame
 void MotorBoard::sendValuesToGlove(unsigned char inValues[], int size) {
-  patternOn = !patternOn;
+  sendValuesToGlove(inValues, size, (1 << size) - 1);
+  finishFrame();
+}
+
+//________________________________________________
+// Send the values of the motors in motorMask (bit i -> inValues[i]) only.
+// The processing thread streams the tiles row by row, so a frame usually
+// gets sent in several parts, finishFrame() marks its end.
+void MotorBoard::sendValuesToGlove(unsigned char inValues[], int size,
+                                   uint16_t motorMask) {
+  // the first part of a new frame toggles the warning pattern
+  if (!frameStarted) {
+    frameStarted = true;
+    patternOn = !patternOn;
+    Glob::logger.motorSendLog.reset();
+    Glob::logger.motorSendLog.store("startSendGlove");
+  }
   bool patternThreshEx = false;
   // WRITE VALUES TO GLOVE
-  unsigned char values[] = {0, 0, 0, 0, 0, 0, 0, 0, 0};
-  Glob::logger.motorSendLog.reset();
-  Glob::logger.motorSendLog.store("startSendGlove");
+  unsigned char values[ActuatorLayout::maxMotors] = {0};
+  size = std::min(size, Glob::layout.motorCount());
   {
     for (int i = 0; i < size; i++) {
-      //check: object closer than 20cm? -> activate warning pattern
+      // check: object closer than 20cm? -> activate warning pattern
+      // (motors that aren't in this part still hold their latest value)
       if (inValues[i] > 234)
         patternThreshEx = true;
-      // stronger vibrations on left motors
-      if (i == 0 || i == 3 || i == 6) {
-        values[i] = static_cast<int>(inValues[i] * 1);
-      } else {
-        values[i] = static_cast<int>(inValues[i] * 0.90);
-      }
+      // gain of the motor (glove: stronger vibrations on left motors)
+      values[i] = static_cast<int>(inValues[i] * Glob::layout.gain(i));
     }
   }
   Glob::logger.motorSendLog.store("copy");
   // Write Values to the registers of the motor drivers (drv..)
   // All drv have same addr. -> two i2c multiplexer (tca) are needed.
   if (!Glob::modes.a_muted && !Glob::royalStats.a_isCalibRunning) {
-    // For speed's sake start with drvs that are on the first tca
-    for (int i = 0; i < size; ++i) {
-      if (order[i] <= 4) {
-        drvSelect(order[i]); // route the value to the right TCA and DRV
-        if (!patternThreshEx) {
-          // write value if there is no on/off warning pattern
-          protectedWrite(drv, RTP_INPUT, altCurve[values[i]]);
-        } else {
-          // do pattern with all motors if there is a close object
-          if (patternOn)
-            protectedWrite(drv, RTP_INPUT, altCurve[values[i]]);
-          else
-            protectedWrite(drv, RTP_INPUT, 0);
+    // Only the values that changed get written (shadow registers), starting
+    // with the bank whose TCA is still open from the last part. The mux
+    // selects and writes of a bank go to the bus as one batch.
+    int firstBank = 0;
+    for (int pass = 0; pass < 2; pass++) {
+      uint16_t reached = 0; // motors of the bank (for the FrameTracer)
+      uint16_t written = 0;
+      int bank = pass == 0 ? 0 : 1 - firstBank;
+      {
+        std::lock_guard<std::mutex> locki2c(Glob::i2cMux);
+        if (pass == 0) {
+          if (refreshDue) {
+            refreshShadows();
+          }
+          firstBank = bank = Glob::i2c.activeMux() != 0;
+        }
+        Glob::i2c.beginBatch();
+        for (int i = 0; i < size; ++i) {
+          if ((Glob::layout.channel(i).mux != 0) != (bank != 0) ||
+              !(motorMask & (1 << i))) {
+            continue;
+          }
+          // write value if there is no on/off warning pattern, else do the
+          // pattern with all motors (there is a close object)
+          int value = !patternThreshEx || patternOn ? altCurve[values[i]] : 0;
+          reached |= 1 << i;
+          if (value) {
+            drivenMotors |= 1 << i;
+          }
+          if (rtpShadow[i] == value) {
+            a_savedWrites += 2; // the select and the register
+            continue;
+          }
+          queueMotorWrite(i, value);
+          rtpShadow[i] = value;
+          written |= 1 << i;
+        }
+        if (Glob::i2c.endBatch() != 0) {
+          // don't know which of them got through: all again next time
+          for (int i = 0; i < size; ++i) {
+            if (written & (1 << i)) {
+              rtpShadow[i] = unknownValue;
+            }
+          }
         }
       }
-    }
-    Glob::logger.motorSendLog.store("TCA1");
-    // Now all drv on the 2nd tca together
-    for (int i = 0; i < size; ++i) {
-      if (order[i] > 4) {
-        drvSelect(order[i]); // route the value to the right TCA and DRV
-        if (!patternThreshEx) {
-          // write value if there is no on/off warning pattern
-          protectedWrite(drv, RTP_INPUT, altCurve[values[i]]);
-        } else {
-          // do pattern with all motors if there is a close object
-          if (patternOn)
-            protectedWrite(drv, RTP_INPUT, altCurve[values[i]]);
-          else
-            protectedWrite(drv, RTP_INPUT, 0);
+      for (int i = 0; i < size; ++i) {
+        if (reached & (1 << i)) {
+          Glob::tracer.markMotor(traceId, i);
         }
       }
+      if (reached) {
+        Glob::tracer.mark(traceId, bank ? FrameTracer::BANK_1
+                                        : FrameTracer::BANK_0);
+      }
+      if (pass == 0) {
+        Glob::logger.motorSendLog.store("TCA1");
+      }
     }
   }
   Glob::logger.motorSendLog.store("TCA2");
+}
+
+//________________________________________________
+// All motors of the current frame are sent: log and publish the timings
+void MotorBoard::finishFrame() {
+  frameStarted = false;
+  // rewrite everything now and then, in case a DRV or TCA lost its state
+  // (reset, brown-out) or a write got lost without an error
+  if (++framesSinceRefresh >= refreshInterval) {
+    framesSinceRefresh = 0;
+    refreshDue = true;
+  }
   Glob::logger.motorSendLog.store("end");
   Glob::logger.mainLogger.store("end");
   // This is the end of the processing and sending of one frame. Nothing to do
@@ -116,6 +190,13 @@ void MotorBoard::sendValuesToGlove(unsigned char inValues[], int size) {
   Glob::logger.mainLogger.udpTimeSpan("processing", "us", "startProcess",
                                       "endProcess");
   Glob::logger.mainLogger.udpTimeSpan("wholeCycle", "us", "start", "end");
+  long cycle = Glob::logger.mainLogger.usBetween("start", "end");
+  if (cycle >= 0) {
+    reportCycle(cycle);
+  }
+  if (Glob::recorder.isRecording()) {
+    Glob::recorder.recordSpans(Glob::logger.mainLogger);
+  }
   Glob::logger.mainLogger.reset();
   Glob::logger.motorSendLog.printAll("SEND VALUES TO MOTORS", "us", "ms");
   Glob::logger.motorSendLog.udpTimeSpan("gloveSending", "us", "startSendGlove",
@@ -126,108 +207,265 @@ void MotorBoard::sendValuesToGlove(unsigned char inValues[], int size) {
 }
 
 //________________________________________________
-// Route DRV 0-4 to first TCA multiplexer and 5-8 to the second TCA
+// Collect the whole cycle durations to compare the p50/p99 of the inline and
+// the threaded mode (both are sent via udp and printed now and then)
+void MotorBoard::reportCycle(long us) {
+  Glob::cycleLatency.record((uint32_t)us);
+  uint64_t frames = Glob::cycleLatency.count();
+  if (frames % 30 != 0) {
+    return;
+  }
+  int p50 = Glob::cycleLatency.percentile(50);
+  int p99 = Glob::cycleLatency.percentile(99);
+  {
+    std::lock_guard<std::mutex> lockSendDur(Glob::udpServMux);
+    Glob::udpServer.preparePacket("cycleP50", p50);
+    Glob::udpServer.preparePacket("cycleP99", p99);
+    Glob::udpServer.preparePacket("i2cSaved", (int)savedWrites());
+  }
+  if (frames % 900 == 0) {
+    printf("wholeCycle (%s): p50 %i us, p99 %i us, max %u us (%llu frames)\n",
+           Glob::modes.a_inline ? "inline" : "threaded", p50, p99,
+           Glob::cycleLatency.max(), (unsigned long long)frames);
+  }
+}
+
+//________________________________________________
+// Route the DRV of a motor to its TCA multiplexer and line (glove: DRV 0-4
+// on the first TCA and 5-8 on the second TCA, see ActuatorLayout)
 int MotorBoard::drvSelect(uint8_t drvNo) {
+  ActuatorLayout::Channel ch = Glob::layout.channel(drvNo);
+  // whatever gets written now isn't tracked by the shadow registers
+  rtpShadow[drvNo] = unknownValue;
   std::lock_guard<std::mutex> locki2c(Glob::i2cMux);
-  if (drvNo <= 4) {
-    Glob::i2c.selectSingleMuxLine(0, drvNo);
-  } else if (drvNo > 4) {
-    // substract 5 as the 6th drv is on position 0 again
-    Glob::i2c.selectSingleMuxLine(1, drvNo - 5);
-  }
+  Glob::i2c.selectSingleMuxLine(ch.mux, ch.line);
   return 0;
 }
 
+//________________________________________________
+// Forget the values of the DRVs and the states of the TCAs, so everything
+// gets written again (the caller holds Glob::i2cMux)
+void MotorBoard::refreshShadows() {
+  refreshDue = false;
+  std::fill(std::begin(rtpShadow), std::end(rtpShadow), unknownValue);
+  Glob::i2c.invalidateMuxes();
+}
+
+//________________________________________________
+// i2c writes the shadow registers made unnecessary (DRV values and mux
+// selects that were already there)
+long MotorBoard::savedWrites() const {
+  return a_savedWrites + Glob::i2c.savedCount();
+}
+
+//________________________________________________
+// Open the lines of all DRVs on a TCA at once: writes go to all of them
+// (they share their address), don't read. -1 if the TCA has no motors.
+int MotorBoard::drvSelectBank(int mux) {
+  uint8_t lines = 0;
+  for (int i = 0; i < Glob::layout.motorCount(); i++) {
+    ActuatorLayout::Channel ch = Glob::layout.channel(i);
+    if (ch.mux == mux) {
+      lines |= 1 << ch.line;
+      rtpShadow[i] = unknownValue;
+    }
+  }
+  if (lines == 0) {
+    return -1;
+  }
+  std::lock_guard<std::mutex> locki2c(Glob::i2cMux);
+  return Glob::i2c.selectMuxLines(mux, lines);
+}
+
+//________________________________________________
+// Write a register of every DRV: one write per TCA (broadcast). -1 if a
+// write failed.
+int MotorBoard::writeAllDrvs(unsigned char ucRegAddress, uint8_t value) {
+  int result = 0;
+  for (int mux = 0; mux < 2; mux++) {
+    if (drvSelectBank(mux) == 0) {
+      if (protectedWrite(drv, ucRegAddress, value) != 0) {
+        result = -1;
+      }
+    }
+  }
+  return result;
+}
+
+//________________________________________________
+// Route to the DRV of a motor and write its RTP value, queued into the
+// current i2c batch (the caller holds Glob::i2cMux)
+void MotorBoard::queueMotorWrite(int motor, unsigned char value) {
+  ActuatorLayout::Channel ch = Glob::layout.channel(motor);
+  Glob::i2c.selectSingleMuxLine(ch.mux, ch.line);
+  Glob::i2c.writeReg(drv, RTP_INPUT, value);
+}
+
 //________________________________________________
 // Set the settings of the DRVs by writing to their registers
 int MotorBoard::setupLRA(bool calib) {
-  if (protectedWrite(drv, MODE, 0x07) != 0)
+  if (writeSettings() != 0)
     return -1;
-  if (protectedWrite(drv, FB_CON, 0b11000000) != 0)
-    return -1;
-  if (protectedWrite(drv, RATED_VOLTAGE, 0b01101000) != 0)
-    return -1;
-  if (protectedWrite(drv, OD_CLAMP, 0b10001000) != 0)
-    return -1;
-  if (protectedWrite(drv, CONTRL1, 0b10011000) != 0)
-    return -1;
-  if (protectedWrite(drv, CONTRL2, 0b01000101) != 0)
-    return -1;
-  if (protectedWrite(drv, CONTRL3, 0b00001000) != 0)
-    return -1;
-  if (protectedWrite(drv, CONTRL4, 0b00000000) != 0)
+  return startLRA(calib);
+}
+
+//________________________________________________
+// The settings of the selected DRVs (auto calibration mode, which also ends
+// the standby, and the drvConfig program)
+int MotorBoard::writeSettings() {
+  if (protectedWrite(drv, MODE, 0x07) != 0)
     return -1;
+  return writeProgram(drvConfig);
+}
+
+//________________________________________________
+// GO to start Auto-Calib process, else RTP mode with the vibration at 0
+int MotorBoard::startLRA(bool calib) {
   if (calib) {
-    if (protectedWrite(drv, GO, 0x01) != 0)
-      return -1; // GO to start Auto-Calib process
-  } else {
-    while (protectedWrite(drv, MODE, 0x05) != 0) // set DRV to RTP Mode
-    {
+    return protectedWrite(drv, GO, 0x01);
+  }
+  while (writeProgram(drvRtpMode) != 0) {
+  }
+  return 0;
+}
+
+//________________________________________________
+// Settings to all DRVs of a TCA at once, read back from every single one
+// (written to it alone again if they didn't stick), then the calibration or
+// RTP mode started on all DRVs of a TCA at once
+void MotorBoard::setupAllLRAs(bool calib) {
+  for (int mux = 0; mux < 2; mux++) {
+    if (drvSelectBank(mux) != 0) {
+      continue; // no motors on it
     }
-    while (protectedWrite(drv, RTP_INPUT, 0x00) !=
-           0) // set vibration value to 0
-    {
+    while (writeSettings() != 0) {
+      // printf("writing settings to bank %i failed \n", mux);
+    }
+  }
+  for (int u = 0; u < Glob::layout.motorCount() && Glob::i2c.readsDevices();
+       u++) {
+    drvSelect(u);
+    int passes = 0;
+    while (!verifyProgram(drvConfig) && passes < maxSetupPasses) {
+      printf("settings of DRV %i didn't stick, writing them again\n", u);
+      writeSettings();
+      passes++;
+    }
+    if (passes == maxSetupPasses) {
+      printf("DRV %i doesn't take its settings\n", u);
+    }
+  }
+  for (int mux = 0; mux < 2; mux++) {
+    if (drvSelectBank(mux) != 0) {
+      continue;
+    }
+    while (startLRA(calib) != 0) {
+    }
+  }
+}
+
+//________________________________________________
+// Block writes of a register program (see MotorBoardDefs.hpp)
+int MotorBoard::writeProgram(const RegisterProgram &program) {
+  std::lock_guard<std::mutex> locki2c(Glob::i2cMux);
+  for (int b = 0; b < program.size(); b++) {
+    const RegisterProgram::Block &block = program[b];
+    if (Glob::i2c.writeBlock(drv, block.reg, block.values, block.length) !=
+        0) {
+      return -1;
     }
   }
   return 0;
 }
 
+//________________________________________________
+// Does the selected DRV hold the values of the program? All registers from
+// the first to the last one of the program (blocks in ascending order) in
+// one read, a single DRV has to be selected.
+bool MotorBoard::verifyProgram(const RegisterProgram &program) {
+  const RegisterProgram::Block &last = program[program.size() - 1];
+  uint8_t first = program[0].reg;
+  uint8_t values[256];
+  {
+    std::lock_guard<std::mutex> locki2c(Glob::i2cMux);
+    if (Glob::i2c.readBlock(drv, first, values,
+                            last.reg + last.length - first) != 0) {
+      return false;
+    }
+  }
+  for (int b = 0; b < program.size(); b++) {
+    const RegisterProgram::Block &block = program[b];
+    for (int i = 0; i < block.length; i++) {
+      uint8_t value = values[block.reg - first + i];
+      if (value != block.values[i]) {
+        printf("register 0x%02x is 0x%02x instead of 0x%02x\n",
+               block.reg + i, value, block.values[i]);
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
 //________________________________________________
 // When an error occurs or the program is exited: mute the DRVs first.
 void MotorBoard::muteAll() {
-  for (int i = 0; i < 9; ++i) {
-    drvSelect(i);
-    protectedWrite(drv, RTP_INPUT, 0);
-    delay(1);
+  // silent anyway, writes would disturb the calibration's reads
+  if (Glob::royalStats.a_isCalibRunning) {
+    return;
+  }
+  // all DRVs of a TCA at once, one by one if that didn't work
+  if (writeAllDrvs(RTP_INPUT, 0) != 0) {
+    for (int i = 0; i < Glob::layout.motorCount(); ++i) {
+      drvSelect(i);
+      protectedWrite(drv, RTP_INPUT, 0);
+      Clock::sleepFor(milliseconds(1));
+    }
   }
-  delay(1);
+  Clock::sleepFor(milliseconds(1));
   // printf("Muted all LRAs \n");
 }
 
 //________________________________________________
 // Play an on off pattern
 void MotorBoard::runOnOffPattern(int onTime, int offTime, int passes) {
-  for (int i = 0; i < 9; ++i) {
-    drvSelect(i);
-    protectedWrite(drv, RTP_INPUT, 0);
+  if (Glob::royalStats.a_isCalibRunning) {
+    return; // see muteAll()
   }
-  delay(offTime);
+  writeAllDrvs(RTP_INPUT, 0);
+  Clock::sleepFor(milliseconds(offTime));
   for (int u = 0; u < passes; ++u) {
-    for (int i = 0; i < 9; ++i) {
-      drvSelect(i);
-      protectedWrite(drv, RTP_INPUT, 255);
-    }
-    delay(onTime);
-    for (int i = 0; i < 9; ++i) {
-      drvSelect(i);
-      protectedWrite(drv, RTP_INPUT, 0);
-    }
-    delay(offTime);
+    writeAllDrvs(RTP_INPUT, 255);
+    Clock::sleepFor(milliseconds(onTime));
+    writeAllDrvs(RTP_INPUT, 0);
+    Clock::sleepFor(milliseconds(offTime));
   }
 }
 
 //________________________________________________
 // Reset all DRV shields
 void MotorBoard::resetAll() {
-  for (int u = 0; u < 9; u++) {
-    drvSelect(u);
-    delay(1);
-    // First: Set DEV_RESET bit to 1
+  // First: Set DEV_RESET bit to 1 (all DRVs of a TCA at once)
+  for (int mux = 0; mux < 2; mux++) {
+    if (drvSelectBank(mux) != 0) {
+      continue;
+    }
+    Clock::sleepFor(milliseconds(1));
     while (protectedWrite(drv, MODE, 0x80) != 0) // Do until the shield is reset
     {
       printf("Reset failed\n");
     }
   }
-  delay(10);
-  for (int u = 0; u < 9; u++) {
+  Clock::sleepFor(milliseconds(10));
+  for (int u = 0; u < Glob::layout.motorCount(); u++) {
     drvSelect(u);
-    delay(1);
+    Clock::sleepFor(milliseconds(1));
     // Check DEV_RESET bit until it gets cleared (reset finished)
     uint8_t getMODE = 0x80;
     while ((getMODE & 0x80) != 0x00) // Do until the shield is reset
     {
       getMODE = protectedRead(drv, MODE);
-      delay(1);
+      Clock::sleepFor(milliseconds(1));
     }
     // Get device in active mode (end standby)
     while (protectedWrite(drv, MODE, 0x40) != 0) {
@@ -238,7 +476,7 @@ void MotorBoard::resetAll() {
     while ((getMODE & 0x04) != 0x00) // Check until it is active
     {
       getMODE = protectedRead(drv, MODE);
-      delay(1);
+      Clock::sleepFor(milliseconds(1));
     }
     printf("reset actuator %i successfull\n", u);
   }
@@ -282,7 +520,7 @@ void MotorBoard::printStatusToSerial(uint8_t status) {
 void MotorBoard::printSummary() {
   printf("\n\n\n here are the results of the calib test-run: \n");
   printf("______________________________\n");
-  for (int u = 0; u < 9; u++) {
+  for (int u = 0; u < Glob::layout.motorCount(); u++) {
     printf("LRA No %i: \t ", u);
     drvSelect(u);
     uint8_t getReg = 0x00;
@@ -303,17 +541,14 @@ void MotorBoard::printSummary() {
 
 // Do the Calibration Process
 void MotorBoard::runCalib() {
+  std::fill(std::begin(calibSuccess), std::end(calibSuccess), false);
+  availableLRAs = 0;
   resetAll();
-  for (int u = 0; u < 9; u++) {
-    drvSelect(u); // select the driver to write to
-    while (setupLRA(true) != 0) {
-      // printf("writing settings to no %i failed \n", u); //Send all register
-      // settings and "GO" bit to start auto calibration
-    }
-  }
+  // Send all register settings and "GO" bit to start auto calibration
+  setupAllLRAs(true);
   // Check if autocalibration already was finished and successfull. If not, do
   // subsequent calibration passes
-  for (int u = 0; u < 9; u++) {
+  for (int u = 0; u < Glob::layout.motorCount(); u++) {
     drvSelect(u); // select the driver to write to
     printf("\n\n\n\nDRV No: %i\n", u);
     printf("_________________\n");
@@ -322,7 +557,7 @@ void MotorBoard::runCalib() {
     uint8_t getGO = 0x01;
     while ((getGO & 0x01) != 0x00) {
       getGO = protectedRead(drv, GO);
-      delay(5);
+      Clock::sleepFor(milliseconds(5));
     }
     // Get status register to check if auto calibration was successfull
     uint8_t getStatus = protectedRead(drv, STATUS);
@@ -339,11 +574,11 @@ void MotorBoard::runCalib() {
                  u); // Send all register settings and "GO" bit to start auto
                      // calibration
         }
-        delay(50);
+        Clock::sleepFor(milliseconds(50));
         getGO = 0x01;
         while ((getGO & 0x01) != 0x00) {
           getGO = protectedRead(drv, GO);
-          delay(5);
+          Clock::sleepFor(milliseconds(5));
         }
         getStatus = protectedRead(drv, STATUS);
         if ((getStatus & 0x08) == 0x00) {
@@ -371,6 +606,139 @@ void MotorBoard::runCalib() {
     }
   }
   printSummary();
+  drivenMotors = 0;
+  calibDue = false;
+  if (calibPath.empty() || !Glob::i2c.readsDevices()) {
+    return;
+  }
+  if (availableLRAs == Glob::layout.motorCount()) {
+    storeCalibration();
+  } else {
+    // no drift checks against the old values (would calibrate again and
+    // again), the next start tries with them
+    calibCache.clear();
+    printf("not all LRAs calibrated, %s stays as it is\n", calibPath.c_str());
+  }
+}
+
+//________________________________________________
+// Everything else that writes to the DRVs holds Glob::motors.mut and checks
+// a_isCalibRunning (sendValuesToGlove(), muteAll(), runOnOffPattern()), so
+// once it's set under the lock nothing else touches them. The calibration
+// itself takes a second or more and runs without the lock: the processing
+// thread keeps publishing the tiles, the sending thread drops them.
+void MotorBoard::runCalibWhileRunning() {
+  {
+    std::lock_guard<std::mutex> lockMotorTiles(Glob::motors.mut);
+    if (Glob::royalStats.a_isCalibRunning) {
+      return; // one is running already
+    }
+    muteAll();
+    Glob::royalStats.a_isCalibRunning = true;
+  }
+  // its selects forgot the shadow registers (drvSelect()): the next frame
+  // writes every motor again
+  runCalib();
+  Glob::royalStats.a_isCalibRunning = false;
+}
+
+//________________________________________________
+// The device IDs of the DRVs (STATUS bits 7:5, 0xFF if one doesn't answer)
+// with the layout, see CalibrationCache. Tells which drivers are there, not
+// which glove it is (the ID is the same on every DRV2605L).
+uint32_t MotorBoard::hardwareFingerprint() {
+  uint8_t ids[ActuatorLayout::maxMotors];
+  for (int u = 0; u < Glob::layout.motorCount(); u++) {
+    drvSelect(u);
+    int status = protectedRead(drv, STATUS);
+    ids[u] = status < 0 ? 0xFF : status >> 5;
+  }
+  return CalibrationCache::fingerprint(Glob::layout, ids);
+}
+
+//________________________________________________
+// The cached calibration into the DRVs: A_CAL_COMP, A_CAL_BEMF and FB_CON
+// follow each other, one block write per DRV (LRA_RESON is read only)
+void MotorBoard::applyCalibration() {
+  static_assert(A_CAL_BEMF == A_CAL_COMP + 1 && FB_CON == A_CAL_COMP + 2,
+                "calibration registers in one block");
+  for (int u = 0; u < calibCache.size(); u++) {
+    const CalibrationCache::Drv &cal = calibCache[u];
+    uint8_t values[] = {cal.compensation, cal.backEmf, cal.feedback};
+    drvSelect(u);
+    std::lock_guard<std::mutex> locki2c(Glob::i2cMux);
+    if (Glob::i2c.writeBlock(drv, A_CAL_COMP, values, 3) != 0) {
+      printf("writing the calibration of LRA %i failed\n", u);
+    }
+  }
+}
+
+//________________________________________________
+// Read the results of the calibration that just finished and keep them
+void MotorBoard::storeCalibration() {
+  std::vector<CalibrationCache::Drv> values;
+  for (int u = 0; u < Glob::layout.motorCount(); u++) {
+    drvSelect(u);
+    uint8_t cal[3];
+    int resonance;
+    {
+      std::lock_guard<std::mutex> locki2c(Glob::i2cMux);
+      resonance = Glob::i2c.readBlock(drv, A_CAL_COMP, cal, 3) == 0
+                      ? Glob::i2c.readReg(drv, LRA_RESON)
+                      : -1;
+    }
+    if (resonance <= 0) {
+      printf("can't read the calibration of LRA %i, not saved\n", u);
+      return;
+    }
+    values.push_back({cal[0], cal[1], cal[2], (uint8_t)resonance});
+  }
+  calibCache.assign(hardwareFingerprint(), values);
+  if (calibCache.save(calibPath)) {
+    printf("calibration saved to %s\n", calibPath.c_str());
+  }
+}
+
+//________________________________________________
+// One read per actuator that vibrated since the last check (A_CAL_COMP up
+// to LRA_RESON). Values the DRV lost (reset, brown-out) are simply written
+// again, only a resonance that moved away needs a new calibration.
+bool MotorBoard::checkCalibration() {
+  if (calibDue || !calibCache.valid()) {
+    return calibDue;
+  }
+  int motors = std::min(calibCache.size(), Glob::layout.motorCount());
+  for (int u = 0; u < motors; u++) {
+    if (!(drivenMotors & (1 << u))) {
+      continue;
+    }
+    drvSelect(u);
+    uint8_t regs[LRA_RESON - A_CAL_COMP + 1];
+    {
+      std::lock_guard<std::mutex> locki2c(Glob::i2cMux);
+      if (Glob::i2c.readBlock(drv, A_CAL_COMP, regs, sizeof(regs)) != 0) {
+        continue;
+      }
+    }
+    const CalibrationCache::Drv &cal = calibCache[u];
+    if (regs[0] != cal.compensation || regs[1] != cal.backEmf ||
+        regs[2] != cal.feedback) {
+      printf("LRA %i lost its calibration, writing it again\n", u);
+      uint8_t values[] = {cal.compensation, cal.backEmf, cal.feedback};
+      std::lock_guard<std::mutex> locki2c(Glob::i2cMux);
+      Glob::i2c.writeBlock(drv, A_CAL_COMP, values, 3);
+      continue;
+    }
+    uint8_t resonance = regs[LRA_RESON - A_CAL_COMP];
+    if (calibCache.drifted(u, resonance)) {
+      printf("resonance of LRA %i drifted to %.1f Hz (calibrated: %.1f Hz)\n",
+             u, 1 / (resonance * 0.00009846),
+             1 / (cal.resonance * 0.00009846));
+      calibDue = true;
+    }
+  }
+  drivenMotors = 0;
+  return calibDue;
 }
 
 int MotorBoard::protectedRead(int addr, unsigned char ucRegAddress) {
@@ -378,7 +746,7 @@ int MotorBoard::protectedRead(int addr, unsigned char ucRegAddress) {
   return Glob::i2c.readReg(addr, ucRegAddress);
 }
 int MotorBoard::protectedWrite(int addr, unsigned char ucRegAddress,
-                               char cValue) {
+                               uint8_t value) {
   std::lock_guard<std::mutex> locki2c(Glob::i2cMux);
-  return Glob::i2c.writeReg(addr, ucRegAddress, cValue);
+  return Glob::i2c.writeReg(addr, ucRegAddress, value);
 }
@@ -6,42 +6,75 @@
 #include <stdint.h>
 #include <stdio.h>
 #include <unistd.h>
-#include <wiringPi.h>
-#include <wiringPiI2C.h>
 
 #include <array>
+#include <atomic>
 #include <ctime>
 #include <fstream>
 #include <sstream>
 
+#include "ActuatorLayout.hpp"
+#include "CalibrationCache.hpp"
+#include "RegisterProgram.hpp"
+
 //****************************************************************
 //                          MotorBoard
 //****************************************************************
 class MotorBoard {
 public:
+  MotorBoard();
   void muteAll();
   void setupGlove();
   void sendValuesToGlove(unsigned char values[], int size);
+  void sendValuesToGlove(unsigned char values[], int size, uint16_t motorMask);
+  void finishFrame();
+  // FrameTracer ID of the frame the next values belong to (0: none)
+  void traceFrame(uint32_t id) { traceId = id; }
   void runOnOffPattern(int, int, int);
   void runCalib();
+  // runCalib() while the glove runs (watchdog loop, udp 'c'): mutes the
+  // motors and keeps the other writers off the DRVs until it's done, without
+  // holding Glob::motors.mut (the processing goes on). Call without the lock.
+  void runCalibWhileRunning();
+  // keep the calibration in this file ("": calibrate at every start if
+  // startupCalib, else run on the standard values)
+  void useCalibrationCache(const std::string &path) { calibPath = path; }
+  // Should the actuators get calibrated (again)? No calibration for this
+  // glove, or the resonance of a driven actuator moved away from it.
+  bool checkCalibration();
+  // i2c writes skipped because the DRV / TCA already had the value
+  long savedWrites() const;
 
 private:
   uint8_t initI2CDevice(uint8_t addr);
   int drvSelect(uint8_t);
+  int drvSelectBank(int mux);
+  int writeAllDrvs(unsigned char ucRegAddress, uint8_t value);
+  void queueMotorWrite(int motor, unsigned char value);
+  void refreshShadows();
   int setupLRA(bool);
+  int writeSettings();
+  int startLRA(bool calib);
+  void setupAllLRAs(bool calib);
+  int writeProgram(const RegisterProgram &program);
+  bool verifyProgram(const RegisterProgram &program);
   void resetAll();
   void printStatusToSerial(uint8_t);
   void printSummary();
+  uint32_t hardwareFingerprint();
+  void applyCalibration();
+  void storeCalibration();
+  void reportCycle(long us);
   int protectedRead(int addr, unsigned char ucRegAddress);
-  int protectedWrite(int addr, unsigned char ucRegAddress, char cValue);
+  int protectedWrite(int addr, unsigned char ucRegAddress, uint8_t value);
 
   uint8_t maxCalibPasses = 2; // max trys for calib before skipping
+  int maxSetupPasses = 3;     // max rewrites of settings that didn't stick
   uint8_t availableLRAs = 0;  // number of LRAs
-  bool calibSuccess[9];       // was calibration successfull?
+  bool calibSuccess[ActuatorLayout::maxMotors]; // was calibration successfull?
   int retVal;
   int lastTCA;
-  // uint8_t order[9] = {0, 2, 1, 3, 4, 5, 8, 7, 6};
-     uint8_t order[9] = {0, 1, 2, 3, 4, 5, 6, 7, 8};
+  // which TCA / line each motor is connected to comes from Glob::layout
 
   // Should there be a calibration in the beginning? Else: Take standard Values
   bool startupCalib = false;
@@ -51,4 +84,26 @@ private:
 
   //vibration ON/OFF pattern for high values
   bool patternOn=0;
+
+  // some motors of the current frame were already sent (see finishFrame())
+  bool frameStarted = false;
+  uint32_t traceId = 0;
+
+  // Shadow registers: RTP_INPUT last written to each DRV (only the changed
+  // ones get written), everything gets written again every refreshInterval
+  // frames
+  static const int unknownValue = -1;
+  static const int refreshInterval = 50;
+  int rtpShadow[ActuatorLayout::maxMotors];
+  int framesSinceRefresh = 0;
+  bool refreshDue = false;
+  std::atomic<long> a_savedWrites{0};
+
+  // Calibration results of this glove (see CalibrationCache). A background
+  // calibration is due if there were none, the drift check looks at the
+  // actuators that vibrated since (LRA_RESON gets measured while driving).
+  std::string calibPath;
+  CalibrationCache calibCache;
+  bool calibDue = false;
+  uint16_t drivenMotors = 0;
 };
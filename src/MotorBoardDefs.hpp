@@ -1,3 +1,5 @@
+#include "RegisterProgram.hpp"
+
 //----------------------------------------------------------------------
 // ADDRESSES for Registers and I2C
 //----------------------------------------------------------------------
@@ -43,6 +45,25 @@
 //... and of DRV2605
 #define DRV2605_ADDRESS 0x5A
 
+//----------------------------------------------------------------------
+// DRV2605 REGISTER PROGRAMS (block writes, see RegisterProgram.hpp)
+//----------------------------------------------------------------------
+// LRA settings: closed loop, rated voltage and overdrive clamp of the
+// actuator, drive time, ... Written to all DRVs of a TCA at once, then read
+// back from each one (the calibration changes some of them, so before it).
+constexpr RegSetting drvConfigSettings[] = {
+    {RATED_VOLTAGE, 0b01101000}, {OD_CLAMP, 0b10001000},
+    {FB_CON, 0b11000000},        {CONTRL1, 0b10011000},
+    {CONTRL2, 0b01000101},       {CONTRL3, 0b00001000},
+    {CONTRL4, 0b00000000}};
+constexpr RegisterProgram drvConfig(drvConfigSettings);
+// real time playback, vibration value 0
+constexpr RegSetting drvRtpSettings[] = {{MODE, 0x05}, {RTP_INPUT, 0x00}};
+constexpr RegisterProgram drvRtpMode(drvRtpSettings);
+static_assert(drvConfig.size() == 2 && drvRtpMode.size() == 1,
+              "RATED_VOLTAGE..OD_CLAMP, FB_CON..CONTRL4 and MODE, RTP_INPUT "
+              "are one block write each");
+
 //----------------------------------------------------------------------
 // DEFINE ACTUATORS STRENGTH CURVE
 //----------------------------------------------------------------------
@@ -0,0 +1,604 @@
+/* INFO
+ * Checks the optimized processing against a reference implementation on
+ * synthetic frames (see PipelineCheck.hpp).
+ */
+
+//----------------------------------------------------------------------
+// INCLUDES
+//----------------------------------------------------------------------
+#include "PipelineCheck.hpp"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <algorithm>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "Camera.hpp"
+#include "DepthCodec.hpp"
+#include "DepthKernel.hpp"
+#include "DepthSearch.hpp"
+#include "Globals.hpp"
+#include "SyntheticSource.hpp"
+#include "WorkerPool.hpp"
+
+//----------------------------------------------------------------------
+// DECLARATIONS AND VARIABLES
+//----------------------------------------------------------------------
+// the known camera resolutions (kernels specialized for the 3x3 grid) and
+// others (generic kernel), incl. an odd one
+const int checkSizes[][2] = {{224, 172}, {352, 288}, {320, 240}, {97, 61}};
+// ground truth: a value counts as close within this many bins
+const int closeBins = 4;
+// tolerance of the incremental mode by default (--incremental)
+const int defaultTol = 2;
+// mismatches printed in detail
+const long maxReported = 10;
+
+namespace {
+
+// one way to run processData()
+struct Variant {
+  const char *kernel;
+  int workers;
+  int changeTol; // -1: incremental mode off
+  std::unique_ptr<DepthDataUtilities> processing;
+  long mismatches;
+  // with a tolerance: bins the histograms should hold (see keepBins())
+  std::vector<uint8_t> kept;
+  int framesSinceFull;
+  uint8_t values[ActuatorLayout::maxMotors]; // of the last frame
+};
+
+const char *modeName(int changeTol) {
+  return changeTol < 0 ? "full" : changeTol == 0 ? "incremental" : "tolerance";
+}
+
+//________________________________________________
+// Plain model of the incremental mode with the tolerance tol: updates `kept`
+// to the bins the histograms hold after the frame with the bins `bins`. A
+// block (run of the map) takes the frame's bins if one of its pixels is more
+// than tol bins away from the kept one, every block does on a full frame.
+void keepBins(const std::vector<uint8_t> &bins, const ActuatorMap &map,
+              int tol, std::vector<uint8_t> &kept, int &framesSinceFull) {
+  if (kept.size() != bins.size() ||
+      framesSinceFull >= DepthDataUtilities::fullFrameInterval) {
+    kept = bins;
+    framesSinceFull = 0;
+    return;
+  }
+  framesSinceFull++;
+  for (int y = 0; y < map.height(); y++) {
+    for (const ActuatorMap::Run *run = map.rowBegin(y); run != map.rowEnd(y);
+         run++) {
+      size_t x0 = (size_t)y * map.width() + run->x0;
+      size_t x1 = (size_t)y * map.width() + run->x1;
+      bool changed = false;
+      for (size_t i = x0; i < x1; i++) {
+        changed |= abs(bins[i] - kept[i]) > tol;
+      }
+      if (changed) {
+        std::copy(bins.begin() + x0, bins.begin() + x1, kept.begin() + x0);
+      }
+    }
+  }
+}
+
+//________________________________________________
+// DepthSearch's queries on the histograms of synthetic frames against a
+// plain scan of each histogram. Returns the number of answers that differ.
+long checkSearchQueries(long frames, float range) {
+  const int width = 224;
+  const int height = 172;
+  const int percents[] = {0, 1, 10, 50, 90, 100};
+  SyntheticScene scene(std::max(1L, frames / SyntheticScene::kinds));
+  ActuatorMap map;
+  map.prepare(Glob::layout, width, height);
+  const int motors = map.motorCount();
+  DepthKernel kernel;
+  kernel.setMaxDepth(range);
+  std::unique_ptr<DepthSearch> search(new DepthSearch());
+  DepthFrame rendered;
+  rendered.resize(width, height);
+  long mismatches = 0;
+  long secondObjects = 0;
+  for (long f = 0; f < frames; f++) {
+    scene.render(f, rendered);
+    std::vector<int> histos((size_t)motors * 256, 0);
+    for (int y = 0; y < height; y++) {
+      for (int x = 0; x < width; x++) {
+        uint8_t motor = map.motorAt(x, y);
+        if (motor == ActuatorMap::skip) {
+          continue;
+        }
+        int bin = rendered.confRow(y)[x] > DepthKernel::confidenceThresh
+                      ? DepthKernel::quantize(rendered.depthRow(y)[x],
+                                              kernel.maxDepthMm(),
+                                              kernel.binFactor())
+                      : 255;
+        histos[motor * 256 + bin]++;
+      }
+    }
+    for (int m = 0; m < motors; m++) {
+      search->setHistogram(m, &histos[m * 256]);
+    }
+    for (int m = 0; m < motors; m++) {
+      const int *h = &histos[m * 256];
+      // window sum ending at every bin, added up bin by bin
+      auto counted = [&](int i) {
+        return i >= DepthSearch::offset && h[i] > DepthSearch::pixelThresh
+                   ? h[i]
+                   : 0;
+      };
+      int window[256] = {};
+      for (int i = DepthSearch::offset; i < 256; i++) {
+        int start = std::max(DepthSearch::offset, i - DepthSearch::range + 1);
+        for (int j = start; j <= i; j++) {
+          window[i] += counted(j);
+        }
+        if (start > DepthSearch::offset) {
+          window[i] += counted(DepthSearch::offset); // never dropped
+        }
+      }
+      // nearest object, its end and the next one
+      int second = 0;
+      int state = 0;
+      for (int i = DepthSearch::offset; i < 256 && second == 0; i++) {
+        bool object = window[i] >= DepthSearch::minObjSize;
+        if (state == 0 && object) {
+          state = 1;
+        } else if (state == 1 && !object) {
+          state = 2;
+        } else if (state == 2 && object) {
+          second = i;
+        }
+      }
+      int found = search->secondNearest(m);
+      secondObjects += second != 0;
+      if (found != second) {
+        mismatches++;
+        printf("  MISMATCH second nearest: frame %li motor %i: %i instead "
+               "of %i\n",
+               f, m, found, second);
+      }
+      int inRange = 0;
+      for (int i = 0; i < 255; i++) {
+        inRange += h[i];
+      }
+      for (int percent : percents) {
+        int expected = 255;
+        int below = 0;
+        for (int i = 0; i < 255 && inRange > 0; i++) {
+          below += h[i];
+          if (100L * below >= (long)inRange * percent) {
+            expected = i;
+            break;
+          }
+        }
+        int answer = search->percentile(m, percent);
+        if (answer != expected) {
+          mismatches++;
+          printf("  MISMATCH %i%% percentile: frame %li motor %i: %i instead "
+                 "of %i\n",
+                 percent, f, m, answer, expected);
+        }
+      }
+    }
+  }
+  printf("verify search queries: %s (%li answers differ, %li second "
+         "objects)\n",
+         mismatches == 0 ? "ok" : "FAILED", mismatches, secondObjects);
+  return mismatches;
+}
+
+//________________________________________________
+// First mm that falls into the bin `target`
+uint16_t firstMmOf(const DepthKernel &kernel, int target) {
+  uint16_t mm = 0;
+  while (DepthKernel::quantize(mm, kernel.maxDepthMm(), kernel.binFactor()) <
+         target) {
+    mm++;
+  }
+  return mm;
+}
+
+//________________________________________________
+// Incremental mode with tolerance changeTol: processes `base`, then
+// `changed` and returns the number of motor values that differ from the
+// reference of `changed`
+long checkChange(const DepthFrame &base, const DepthFrame &changed,
+                 const ActuatorMap &map, float range, int changeTol) {
+  Glob::modes.a_workers = 1;
+  Glob::modes.a_changeTol = changeTol;
+  DepthDataUtilities processing;
+  for (const DepthFrame *frame : {&base, &changed}) {
+    Glob::frameMailbox.writeSlot().copyFrom(*frame);
+    Glob::frameMailbox.publish();
+    processing.processData();
+  }
+  uint8_t expected[ActuatorLayout::maxMotors];
+  PipelineCheck::reference(changed, map, range, expected);
+  long mismatches = 0;
+  std::lock_guard<std::mutex> lock(Glob::motors.mut);
+  for (int m = 0; m < map.motorCount(); m++) {
+    mismatches += Glob::motors.tiles[m] != expected[m];
+  }
+  return mismatches;
+}
+
+//________________________________________________
+// Incremental mode on blocks that change without changing their sums: a
+// plane in bin `bin`, then every row of every block becomes bins
+// bin + k, bin - 2k, bin + k, ... (a near object in a third of the pixels).
+// Returns the number of motor values that differ from the reference.
+long checkCancellingChanges(float range) {
+  const int width = 224;
+  const int height = 172;
+  const int bin = 150;
+  const int k = 60;
+  DepthKernel kernel;
+  kernel.setMaxDepth(range);
+  const uint16_t pattern[3] = {firstMmOf(kernel, bin + k),
+                               firstMmOf(kernel, bin - 2 * k),
+                               firstMmOf(kernel, bin + k)};
+  ActuatorMap map;
+  map.prepare(Glob::layout, width, height);
+  DepthFrame base;
+  DepthFrame changed;
+  base.resize(width, height);
+  changed.resize(width, height);
+  for (int y = 0; y < height; y++) {
+    std::fill(base.depthRow(y), base.depthRow(y) + width,
+              firstMmOf(kernel, bin));
+    std::fill(base.confRow(y), base.confRow(y) + width, 255);
+    std::copy(base.depthRow(y), base.depthRow(y) + width, changed.depthRow(y));
+    std::copy(base.confRow(y), base.confRow(y) + width, changed.confRow(y));
+    for (const ActuatorMap::Run *run = map.rowBegin(y); run != map.rowEnd(y);
+         run++) {
+      for (int x = run->x0; x + 3 <= run->x1; x += 3) {
+        std::copy(pattern, pattern + 3, changed.depthRow(y) + x);
+      }
+    }
+  }
+
+  long mismatches = checkChange(base, changed, map, range, 0);
+  printf("verify incremental, changes that cancel out: %s (%li values "
+         "differ)\n",
+         mismatches == 0 ? "ok" : "FAILED", mismatches);
+  return mismatches;
+}
+
+//________________________________________________
+// Incremental mode with a tolerance on a thin near obstacle: a plane in bin
+// `bin` with one pixel per block in bin `dot` (keeps the block's minimum),
+// then a pole two pixels wide in bin `pole` appears in every block. Every
+// block keeps its minimum and pixels in range and its sum moves by less than
+// tolerance x pixels, but the pole is a near object and has to show up at
+// once. Returns the number of motor values that differ from the reference.
+long checkThinObstacle(float range) {
+  const int width = 224;
+  const int height = 172;
+  const int tol = 2;
+  const int bin = 150;
+  const int dot = 60;
+  const int pole = bin - 74; // 2 x 74 <= tol x the narrowest block
+  DepthKernel kernel;
+  kernel.setMaxDepth(range);
+  ActuatorMap map;
+  map.prepare(Glob::layout, width, height);
+  DepthFrame base;
+  DepthFrame changed;
+  base.resize(width, height);
+  changed.resize(width, height);
+  for (int y = 0; y < height; y++) {
+    std::fill(base.depthRow(y), base.depthRow(y) + width,
+              firstMmOf(kernel, bin));
+    std::fill(base.confRow(y), base.confRow(y) + width, 255);
+    for (const ActuatorMap::Run *run = map.rowBegin(y); run != map.rowEnd(y);
+         run++) {
+      base.depthRow(y)[run->x0] = firstMmOf(kernel, dot);
+    }
+    std::copy(base.depthRow(y), base.depthRow(y) + width, changed.depthRow(y));
+    std::copy(base.confRow(y), base.confRow(y) + width, changed.confRow(y));
+    for (const ActuatorMap::Run *run = map.rowBegin(y); run != map.rowEnd(y);
+         run++) {
+      int x = (run->x0 + run->x1) / 2;
+      std::fill(changed.depthRow(y) + x, changed.depthRow(y) + x + 2,
+                firstMmOf(kernel, pole));
+    }
+  }
+
+  long mismatches = checkChange(base, changed, map, range, tol);
+  printf("verify incremental, thin near obstacle (tolerance %i): %s (%li "
+         "values differ)\n",
+         tol, mismatches == 0 ? "ok" : "FAILED", mismatches);
+  return mismatches;
+}
+
+//________________________________________________
+// DepthCodec round trip of synthetic frames at every check size (key and
+// temporal frames), lossless and near-lossless: the depth within the max
+// error, the confidence exact, and what the decoder gets has to be what the
+// encoder predicts from. The confidence plane also goes through the 8 bit
+// image. Returns the number of frames that don't come back.
+long checkCodec(long frames) {
+  const int maxErrors[] = {0, 2};
+  SyntheticScene scene(std::max(1L, frames / SyntheticScene::kinds));
+  DepthFrame rendered;
+  long failures = 0;
+  for (const auto &size : checkSizes) {
+    const int width = size[0];
+    const int height = size[1];
+    std::vector<uint8_t> encoded(DepthCodec::maxEncodedSize(width, height));
+    std::vector<uint8_t> image;
+    for (int maxError : maxErrors) {
+      DepthCodec encoder;
+      encoder.setMaxError(maxError);
+      DepthCodec decoder;
+      long failed = 0;
+      size_t bytes = 0;
+      for (long f = 0; f < frames; f++) {
+        rendered.resize(width, height);
+        scene.render(f, rendered);
+        size_t n = encoder.encode(rendered.depthRow(0), rendered.confRow(0),
+                                  width, height, rendered.stride(),
+                                  encoded.data());
+        bytes += n;
+        bool ok = decoder.decode(encoded.data(), n);
+        for (int y = 0; y < height && ok; y++) {
+          const uint16_t *depth = decoder.depth() + (size_t)y * width;
+          const uint16_t *predicted = encoder.depth() + (size_t)y * width;
+          const uint8_t *conf = decoder.conf() + (size_t)y * width;
+          for (int x = 0; x < width && ok; x++) {
+            ok = abs(depth[x] - rendered.depthRow(y)[x]) <= maxError &&
+                 depth[x] == predicted[x] && conf[x] == rendered.confRow(y)[x];
+          }
+        }
+        if (ok && maxError == 0) {
+          int w = 0;
+          int h = 0;
+          n = DepthCodec::encodeImage(rendered.confRow(0), width, height,
+                                      rendered.stride(), encoded.data());
+          ok = DepthCodec::decodeImage(encoded.data(), n, image, w, h) &&
+               w == width && h == height;
+          for (int y = 0; y < height && ok; y++) {
+            ok = std::equal(rendered.confRow(y), rendered.confRow(y) + width,
+                            image.begin() + (size_t)y * width);
+          }
+        }
+        if (!ok) {
+          if (failed++ < maxReported) {
+            printf("  MISMATCH codec %i x %i, max error %i mm: frame %li "
+                   "(%s%s)\n",
+                   width, height, maxError, f,
+                   SyntheticScene::name(scene.kind(f)),
+                   DepthCodec::isKey(encoded.data()) ? ", key" : "");
+          }
+        }
+      }
+      double raw = (double)frames * width * height * 3;
+      printf("verify codec %i x %i, max error %i mm: %s (%li frames differ, "
+             "%.2f:1)\n",
+             width, height, maxError, failed == 0 ? "ok" : "FAILED", failed,
+             raw / bytes);
+      failures += failed;
+    }
+  }
+  return failures;
+}
+
+} // namespace
+
+//----------------------------------------------------------------------
+// METHODS
+//----------------------------------------------------------------------
+
+//________________________________________________
+// Like processData() before any optimization: histogram per motor pixel by
+// pixel, then the sliding window from the near end
+void PipelineCheck::reference(const DepthFrame &frame, const ActuatorMap &map,
+                              float range,
+                              uint8_t tiles[ActuatorLayout::maxMotors]) {
+  std::vector<uint8_t> bins;
+  binsOf(frame, range, bins);
+  reference(bins, map, tiles);
+}
+
+//________________________________________________
+// Depth bin of every pixel of the frame, row by row
+void PipelineCheck::binsOf(const DepthFrame &frame, float range,
+                           std::vector<uint8_t> &bins) {
+  DepthKernel kernel;
+  kernel.setMaxDepth(range);
+  uint16_t maxMm = kernel.maxDepthMm();
+  uint16_t mul = kernel.binFactor();
+  bins.resize((size_t)frame.width() * frame.height());
+  for (int y = 0; y < frame.height(); y++) {
+    for (int x = 0; x < frame.width(); x++) {
+      bins[y * frame.width() + x] =
+          frame.confRow(y)[x] > DepthKernel::confidenceThresh
+              ? DepthKernel::quantize(frame.depthRow(y)[x], maxMm, mul)
+              : 255; // invalid pixels count as "out of range"
+    }
+  }
+}
+
+//________________________________________________
+void PipelineCheck::reference(const std::vector<uint8_t> &bins,
+                              const ActuatorMap &map,
+                              uint8_t tiles[ActuatorLayout::maxMotors]) {
+  int motors = map.motorCount();
+  int width = map.width();
+  std::vector<int> histo((size_t)motors * 256, 0);
+  for (int y = 0; y < map.height(); y++) {
+    for (int x = 0; x < width; x++) {
+      uint8_t motor = map.motorAt(x, y);
+      if (motor != ActuatorMap::skip) {
+        histo[motor * 256 + bins[y * width + x]]++;
+      }
+    }
+  }
+  for (int m = 0; m < motors; m++) {
+    if (map.pixelCount(m) == 0) {
+      tiles[m] = 0; // masked motors stay off
+      continue;
+    }
+    const int *h = &histo[m * 256];
+    int sum = 0;
+    int val = 0;
+    for (int i = DepthSearch::offset; i < 256; i++) {
+      if (h[i] > DepthSearch::pixelThresh) {
+        sum += h[i];
+      }
+      if (i > DepthSearch::range + DepthSearch::offset &&
+          h[i - DepthSearch::range] > DepthSearch::pixelThresh) {
+        sum -= h[i - DepthSearch::range];
+      }
+      if (sum >= DepthSearch::minObjSize) {
+        val = i;
+        break;
+      }
+    }
+    tiles[m] = 255 - val;
+  }
+}
+
+//________________________________________________
+long PipelineCheck::run(long frames) {
+  const float range = DepthDataUtilities::viewingRange();
+  const int several = std::max(2, WorkerPool::autoDetect());
+  // every scene kind gets the same share of the frames
+  SyntheticScene scene(std::max(1L, frames / SyntheticScene::kinds));
+  DepthKernel kernel;
+  kernel.setMaxDepth(range);
+  // the search ignores the first bins -> so does the ground truth
+  int minMm = 0;
+  while (DepthKernel::quantize(minMm, kernel.maxDepthMm(),
+                               kernel.binFactor()) < DepthSearch::offset) {
+    minMm++;
+  }
+  // not started by --verify, but just in case
+  Glob::modes.a_inline = false;
+  int workersBefore = Glob::modes.a_workers;
+  int changeTolBefore = Glob::modes.a_changeTol;
+
+  long total = 0;
+  long reported = 0;
+  DepthFrame rendered;
+  for (const auto &size : checkSizes) {
+    int width = size[0];
+    int height = size[1];
+    printf("verify %i x %i: %li frames\n", width, height, frames);
+    std::vector<Variant> variants;
+    for (const char *name : DepthKernel::available()) {
+      for (int workers : {1, several}) {
+        for (int changeTol : {-1, 0, defaultTol}) {
+          DepthKernel::prefer(name);
+          variants.push_back({name, workers, changeTol,
+                              std::unique_ptr<DepthDataUtilities>(
+                                  new DepthDataUtilities()),
+                              0, {}, 0, {}});
+        }
+      }
+    }
+    DepthKernel::prefer(nullptr);
+    ActuatorMap map;
+    map.prepare(Glob::layout, width, height);
+    int motors = map.motorCount();
+    // ground truth: sum of the differences and values close to it per scene
+    long diffSum[SyntheticScene::kinds] = {};
+    long close[SyntheticScene::kinds] = {};
+    long compared[SyntheticScene::kinds] = {};
+
+    for (long f = 0; f < frames; f++) {
+      rendered.resize(width, height);
+      scene.render(f, rendered);
+      std::vector<uint8_t> bins;
+      binsOf(rendered, range, bins);
+      uint8_t expected[ActuatorLayout::maxMotors];
+      reference(bins, map, expected);
+      uint16_t truth[ActuatorLayout::maxMotors];
+      scene.groundTruth(map, minMm, truth);
+      SyntheticScene::Kind kind = scene.kind(f);
+      for (int m = 0; m < motors; m++) {
+        if (truth[m] == 0) {
+          continue; // no object in range
+        }
+        int truthTile = 255 - DepthKernel::quantize(truth[m],
+                                                    kernel.maxDepthMm(),
+                                                    kernel.binFactor());
+        int diff = abs(truthTile - expected[m]);
+        diffSum[kind] += diff;
+        close[kind] += diff <= closeBins;
+        compared[kind]++;
+      }
+
+      for (Variant &v : variants) {
+        Glob::modes.a_workers = v.workers;
+        Glob::modes.a_changeTol = v.changeTol;
+        {
+          // motors whose search gets skipped keep the value they have
+          std::lock_guard<std::mutex> lock(Glob::motors.mut);
+          std::copy(v.values, v.values + motors, Glob::motors.tiles);
+        }
+        Glob::frameMailbox.writeSlot().copyFrom(rendered);
+        Glob::frameMailbox.publish();
+        v.processing->processData();
+        uint8_t *values = v.values;
+        {
+          std::lock_guard<std::mutex> lock(Glob::motors.mut);
+          std::copy(Glob::motors.tiles, Glob::motors.tiles + motors, values);
+        }
+        uint8_t kept[ActuatorLayout::maxMotors];
+        const uint8_t *want = expected;
+        if (v.changeTol > 0) {
+          keepBins(bins, map, v.changeTol, v.kept, v.framesSinceFull);
+          reference(v.kept, map, kept);
+          want = kept;
+        }
+        for (int m = 0; m < motors; m++) {
+          if (values[m] == want[m]) {
+            continue;
+          }
+          v.mismatches++;
+          if (reported++ < maxReported) {
+            printf("  MISMATCH %s, %i workers, %s: frame %li (%s) motor %i: "
+                   "%i instead of %i\n",
+                   v.kernel, v.workers,
+                   modeName(v.changeTol), f,
+                   SyntheticScene::name(kind), m, values[m], want[m]);
+          }
+        }
+      }
+    }
+
+    for (const Variant &v : variants) {
+      printf("  %-6s %i worker%s %-11s: %s (%li values differ)\n", v.kernel,
+             v.workers, v.workers > 1 ? "s" : " ",
+             modeName(v.changeTol), v.mismatches == 0 ? "ok" : "FAILED",
+             v.mismatches);
+      total += v.mismatches;
+    }
+    for (int k = 0; k < SyntheticScene::kinds; k++) {
+      if (compared[k] == 0) {
+        continue;
+      }
+      printf("  ground truth %-10s: mean difference %.1f bins, %.0f%% "
+             "within %i bins\n",
+             SyntheticScene::name((SyntheticScene::Kind)k),
+             (double)diffSum[k] / compared[k], 100.0 * close[k] / compared[k],
+             closeBins);
+    }
+  }
+  total += checkSearchQueries(frames, range);
+  total += checkCancellingChanges(range);
+  total += checkThinObstacle(range);
+  total += checkCodec(frames);
+  Glob::modes.a_workers = workersBefore;
+  Glob::modes.a_changeTol = changeTolBefore;
+  printf("verify: %s\n", total == 0 ? "all variants match the reference"
+                                    : "MISMATCHES");
+  return total;
+}
@@ -0,0 +1,45 @@
+#pragma once
+
+//----------------------------------------------------------------------
+// INCLUDES
+//----------------------------------------------------------------------
+#include <stdint.h>
+
+#include <vector>
+
+#include "ActuatorLayout.hpp"
+#include "DepthFrame.hpp"
+
+//****************************************************************
+//                        PIPELINE CHECK
+//****************************************************************
+// --verify: runs synthetic frames (SyntheticScene) through
+// DepthDataUtilities::processData() with every depth kernel this CPU has,
+// with one and several workers, without incremental mode, with it and with
+// a tolerance, at several resolutions, and compares every motor value with a
+// plain reference implementation (the original per-pixel loop and sliding
+// window search; with a tolerance on the bins a plain model of the
+// incremental mode keeps). Also reports how close the values get to the
+// scene's ground truth, checks DepthSearch's other queries against a plain
+// scan of the histograms, the incremental mode on block changes that keep
+// the block's sums or minimum and DepthCodec's round trip (lossless and
+// near-lossless). Runs on the main thread before any other thread is
+// started.
+
+class PipelineCheck {
+public:
+  // motor values of one frame the straightforward way
+  static void reference(const DepthFrame &frame, const ActuatorMap &map,
+                        float range, uint8_t tiles[ActuatorLayout::maxMotors]);
+  // check `frames` frames per resolution, returns the number of motor
+  // values that differ from the reference (all variants)
+  static long run(long frames);
+
+private:
+  static void binsOf(const DepthFrame &frame, float range,
+                     std::vector<uint8_t> &bins);
+  // motor values of the depth bins of every pixel of a frame
+  static void reference(const std::vector<uint8_t> &bins,
+                        const ActuatorMap &map,
+                        uint8_t tiles[ActuatorLayout::maxMotors]);
+};
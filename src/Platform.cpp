@@ -0,0 +1,21 @@
+/* INFO
+ * GPIO on the Unfolding Space Carrier Board (wiringPi).
+ */
+
+//----------------------------------------------------------------------
+// INCLUDES
+//----------------------------------------------------------------------
+#include "Platform.hpp"
+
+#include <wiringPi.h>
+
+//----------------------------------------------------------------------
+// METHODS
+//----------------------------------------------------------------------
+void Platform::setup() { wiringPiSetup(); }
+
+void Platform::pinMode(int pin, PinMode mode) {
+  ::pinMode(pin, mode == Output ? OUTPUT : INPUT);
+}
+
+void Platform::digitalWrite(int pin, int value) { ::digitalWrite(pin, value); }
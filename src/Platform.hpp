@@ -0,0 +1,20 @@
+#pragma once
+
+//****************************************************************
+//                           PLATFORM
+//****************************************************************
+// Everything the app needs from the board besides the i2c bus (see
+// i2c/I2cBus.hpp) and the time (see Clock.hpp): GPIO. Platform.cpp
+// implements it with wiringPi; targets that run without the board (the
+// simulator, the benchmarks) link their own implementation instead, so
+// wiringPi is only needed by these two translation units and
+// i2c/WiringPiBus.cpp.
+
+namespace Platform {
+enum PinMode { Input, Output };
+
+// call once at startup before any GPIO access (not with simulated outputs)
+void setup();
+void pinMode(int pin, PinMode mode);
+void digitalWrite(int pin, int value);
+} // namespace Platform
@@ -0,0 +1,375 @@
+/* INFO
+ * Field recorder: lock-free rings filled by the pipeline threads and a writer
+ * thread that appends them to a recording file (see Recorder.hpp).
+ */
+
+//----------------------------------------------------------------------
+// INCLUDES
+//----------------------------------------------------------------------
+#include "Recorder.hpp"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+
+#include "TimeLogger.hpp"
+
+using namespace std::chrono;
+
+//----------------------------------------------------------------------
+// DECLARATIONS AND VARIABLES
+//----------------------------------------------------------------------
+// how often the writer thread looks for new data when the rings are empty
+const auto writerPoll = milliseconds(2);
+// how often the written data is synced to the disk
+const auto syncInterval = seconds(1);
+
+static int64_t steadyUs() {
+  return duration_cast<microseconds>(Clock::now().time_since_epoch()).count();
+}
+
+//----------------------------------------------------------------------
+// METHODS
+//----------------------------------------------------------------------
+void SlotRing::allocate(int slots, size_t bytes) {
+  slotBytes = Recording::padded(bytes);
+  count = slots;
+  buffer.assign(slotBytes / sizeof(uint64_t) * slots, 0);
+  head = 0;
+  tail = 0;
+}
+
+//________________________________________________
+uint8_t *SlotRing::claim() {
+  uint32_t h = head.load(std::memory_order_relaxed);
+  if (h - tail.load(std::memory_order_acquire) >= count) {
+    return nullptr; // writer is behind
+  }
+  return (uint8_t *)buffer.data() + (size_t)(h % count) * slotBytes;
+}
+
+void SlotRing::commit() {
+  head.store(head.load(std::memory_order_relaxed) + 1,
+             std::memory_order_release);
+}
+
+//________________________________________________
+const uint8_t *SlotRing::peek() {
+  uint32_t t = tail.load(std::memory_order_relaxed);
+  if (t == head.load(std::memory_order_acquire)) {
+    return nullptr;
+  }
+  return (const uint8_t *)buffer.data() + (size_t)(t % count) * slotBytes;
+}
+
+void SlotRing::release() {
+  tail.store(tail.load(std::memory_order_relaxed) + 1,
+             std::memory_order_release);
+}
+
+//________________________________________________
+void Recorder::setCompression(bool enabled, int maxError) {
+  compress = enabled;
+  codec.setMaxError(maxError);
+}
+
+//________________________________________________
+// New file <dir>/session-<date>-<time>.unf, all memory is allocated here
+bool Recorder::start(const std::string &dir) {
+  char name[64];
+  time_t now = time(nullptr);
+  struct tm local;
+  localtime_r(&now, &local);
+  strftime(name, sizeof(name), "session-%Y%m%d-%H%M%S.unf", &local);
+  path = dir + "/" + name;
+  fd = open(path.c_str(), O_WRONLY | O_CREAT | O_EXCL, 0644);
+  if (fd < 0) {
+    printf("can't create recording %s: %s\n", path.c_str(), strerror(errno));
+    return false;
+  }
+  Recording::FileHeader header = {};
+  memcpy(header.magic, Recording::fileMagic, 8);
+  header.version = Recording::version;
+  header.headerSize = sizeof(header);
+  header.startTime =
+      duration_cast<microseconds>(system_clock::now().time_since_epoch())
+          .count();
+  if (write(fd, &header, sizeof(header)) != (ssize_t)sizeof(header)) {
+    printf("can't write recording %s: %s\n", path.c_str(), strerror(errno));
+    close(fd);
+    return false;
+  }
+  offset = sizeof(header);
+  frames.allocate(frameSlots, sizeof(Recording::ChunkHeader) +
+                                  sizeof(Recording::FramePayload) +
+                                  maxPixels * 3);
+  samples.allocate(sampleSlots, sampleBytes);
+  encoded.assign(Recording::padded(sizeof(Recording::ChunkHeader) +
+                                   sizeof(Recording::FramePayload) +
+                                   DepthCodec::maxEncodedSize(352, 288)) /
+                     sizeof(uint64_t),
+                 0);
+  codec.reset();
+  index.reserve(100000); // ~37 min at 45 fps before it has to grow
+  a_stopping = false;
+  a_recording = true;
+  writer = std::thread([this] { writerLoop(); });
+  printf("recording to %s\n", path.c_str());
+  return true;
+}
+
+//________________________________________________
+void Recorder::stop() {
+  if (!a_recording) {
+    return;
+  }
+  a_recording = false;
+  a_stopping = true;
+  writer.join();
+  finish();
+}
+
+//________________________________________________
+// Copy the frame into a free slot (as a ready to write FRAME chunk). Drops
+// the frame if the writer is too far behind.
+void Recorder::recordFrame(const DepthFrame &frame) {
+  int64_t start = steadyUs();
+  int width = frame.width();
+  int height = frame.height();
+  size_t pixels = (size_t)width * height;
+  uint8_t *slot = pixels <= (size_t)maxPixels ? frames.claim() : nullptr;
+  if (slot == nullptr) {
+    a_framesDropped++;
+    return;
+  }
+  Recording::ChunkHeader *chunk = (Recording::ChunkHeader *)slot;
+  Recording::FramePayload *payload = (Recording::FramePayload *)(chunk + 1);
+  chunk->type = Recording::FRAME;
+  chunk->size = sizeof(Recording::FramePayload) + pixels * 3;
+  chunk->timeUs = start;
+  memset(payload, 0, sizeof(*payload));
+  payload->width = width;
+  payload->height = height;
+  payload->encoding = Recording::RAW;
+  payload->timeStamp = frame.timeStamp;
+  // planes without the row padding of the DepthFrame
+  uint16_t *depth = (uint16_t *)(payload + 1);
+  uint8_t *conf = (uint8_t *)(depth + pixels);
+  for (int y = 0; y < height; y++) {
+    memcpy(depth + y * width, frame.depthRow(y), width * sizeof(uint16_t));
+    memcpy(conf + y * width, frame.confRow(y), width);
+  }
+  uint8_t *end = (uint8_t *)payload + chunk->size;
+  memset(end, 0, Recording::padded(chunk->size) - chunk->size);
+  frames.commit();
+  copyLatency.record((uint32_t)(steadyUs() - start));
+}
+
+//________________________________________________
+// Free sample slot with the chunk header filled in (nullptr if full)
+uint8_t *Recorder::claimSample(uint32_t type, size_t size) {
+  uint8_t *slot = samples.claim();
+  if (slot == nullptr) {
+    a_samplesDropped++;
+    return nullptr;
+  }
+  Recording::ChunkHeader *chunk = (Recording::ChunkHeader *)slot;
+  chunk->type = type;
+  chunk->size = size;
+  chunk->timeUs = steadyUs();
+  // zero the payload incl. padding, so the file doesn't get random bytes
+  memset(chunk + 1, 0, Recording::padded(size));
+  return (uint8_t *)(chunk + 1);
+}
+
+//________________________________________________
+void Recorder::recordTiles(const unsigned char *values, int count) {
+  Recording::TilesPayload *tiles = (Recording::TilesPayload *)claimSample(
+      Recording::TILES, sizeof(Recording::TilesPayload));
+  if (tiles == nullptr) {
+    return;
+  }
+  count = std::min(count, (int)sizeof(tiles->values));
+  tiles->count = count;
+  memcpy(tiles->values, values, count);
+  samples.commit();
+}
+
+//________________________________________________
+void Recorder::recordImu(const Recording::ImuPayload &imu) {
+  uint8_t *payload = claimSample(Recording::IMU, sizeof(imu));
+  if (payload == nullptr) {
+    return;
+  }
+  memcpy(payload, &imu, sizeof(imu));
+  samples.commit();
+}
+
+//________________________________________________
+// All entries of the logger (one frame), the size is only known afterwards
+void Recorder::recordSpans(TimeLogger &logger) {
+  const size_t maxSize = maxSpans * sizeof(Recording::Span);
+  Recording::Span *spans =
+      (Recording::Span *)claimSample(Recording::SPANS, maxSize);
+  if (spans == nullptr) {
+    return;
+  }
+  int count = logger.copySpans(spans, maxSpans);
+  ((Recording::ChunkHeader *)spans - 1)->size =
+      count * sizeof(Recording::Span);
+  samples.commit();
+}
+
+//________________________________________________
+// Append everything the rings hold, until the recording gets stopped
+void Recorder::writerLoop() {
+  // the signal handlers (ctrl + c) call stop() -> must not run on this thread
+  sigset_t set;
+  sigemptyset(&set);
+  sigaddset(&set, SIGINT);
+  sigaddset(&set, SIGTERM);
+  pthread_sigmask(SIG_BLOCK, &set, nullptr);
+
+  steady_clock::time_point lastSync = steady_clock::now();
+  while (true) {
+    // everything committed before stop() gets written
+    bool stopping = a_stopping;
+    bool idle = true;
+    const uint8_t *chunk;
+    while ((chunk = samples.peek()) != nullptr) {
+      writeChunk(chunk);
+      samples.release();
+      idle = false;
+    }
+    if ((chunk = frames.peek()) != nullptr) {
+      const Recording::FramePayload *payload =
+          (const Recording::FramePayload *)(chunk +
+                                            sizeof(Recording::ChunkHeader));
+      Recording::IndexEntry entry = {offset, payload->timeStamp};
+      const uint8_t *out = compress ? encodeFrame(chunk) : chunk;
+      if (writeChunk(out)) {
+        rawBytes += ((const Recording::ChunkHeader *)chunk)->size;
+        frameBytes += ((const Recording::ChunkHeader *)out)->size;
+        index.push_back(entry);
+        a_framesWritten++;
+      } else {
+        a_framesDropped++;
+      }
+      frames.release();
+      idle = false;
+    }
+    if (!failed && steady_clock::now() - lastSync > syncInterval) {
+      fdatasync(fd);
+      lastSync = steady_clock::now();
+    }
+    if (idle) {
+      if (stopping) {
+        return;
+      }
+      std::this_thread::sleep_for(writerPoll);
+    }
+  }
+}
+
+//________________________________________________
+// FRAME chunk with the planes of a raw one compressed. Frames that don't get
+// smaller stay raw (and the next one becomes a key frame).
+const uint8_t *Recorder::encodeFrame(const uint8_t *chunk) {
+  if (failed) {
+    return chunk;
+  }
+  int64_t start = steadyUs();
+  const Recording::ChunkHeader *rawChunk =
+      (const Recording::ChunkHeader *)chunk;
+  const Recording::FramePayload *rawPayload =
+      (const Recording::FramePayload *)(rawChunk + 1);
+  int width = rawPayload->width;
+  int height = rawPayload->height;
+  const uint16_t *depth = (const uint16_t *)(rawPayload + 1);
+  const uint8_t *conf = (const uint8_t *)(depth + (size_t)width * height);
+
+  Recording::ChunkHeader *header = (Recording::ChunkHeader *)encoded.data();
+  Recording::FramePayload *payload = (Recording::FramePayload *)(header + 1);
+  *header = *rawChunk;
+  *payload = *rawPayload;
+  payload->encoding = Recording::CODEC;
+  size_t size = codec.encode(depth, conf, width, height, width,
+                             (uint8_t *)(payload + 1));
+  header->size = sizeof(Recording::FramePayload) + size;
+  encodeLatency.record((uint32_t)(steadyUs() - start));
+  if (header->size >= rawChunk->size) {
+    codec.reset();
+    return chunk;
+  }
+  uint8_t *end = (uint8_t *)payload + header->size;
+  memset(end, 0, Recording::padded(header->size) - header->size);
+  return (const uint8_t *)header;
+}
+
+//________________________________________________
+// Write one chunk (header + padded payload) at the end of the file
+bool Recorder::writeChunk(const uint8_t *chunk) {
+  if (failed) {
+    return false;
+  }
+  const Recording::ChunkHeader *header =
+      (const Recording::ChunkHeader *)chunk;
+  size_t size =
+      sizeof(Recording::ChunkHeader) + Recording::padded(header->size);
+  size_t done = 0;
+  while (done < size) {
+    ssize_t written = write(fd, chunk + done, size - done);
+    if (written < 0 && errno == EINTR) {
+      continue;
+    }
+    if (written <= 0) {
+      printf("recording stopped, can't write %s: %s\n", path.c_str(),
+             strerror(errno));
+      failed = true;
+      return false;
+    }
+    done += written;
+  }
+  offset += size;
+  return true;
+}
+
+//________________________________________________
+// INDEX chunk + trailer, so the replay doesn't have to scan the file
+void Recorder::finish() {
+  if (!failed) {
+    uint64_t indexOffset = offset;
+    Recording::ChunkHeader header = {Recording::INDEX,
+                                     (uint32_t)(index.size() *
+                                                sizeof(Recording::IndexEntry)),
+                                     steadyUs()};
+    Recording::Trailer trailer = {indexOffset, {}};
+    memcpy(trailer.magic, Recording::indexMagic, 8);
+    bool ok = write(fd, &header, sizeof(header)) == (ssize_t)sizeof(header);
+    ok = ok && write(fd, index.data(), header.size) == (ssize_t)header.size;
+    ok = ok && write(fd, &trailer, sizeof(trailer)) == (ssize_t)sizeof(trailer);
+    if (!ok) {
+      printf("can't write the index of %s\n", path.c_str());
+    }
+    fdatasync(fd);
+  }
+  close(fd);
+  fd = -1;
+  printf("recording %s: %li frames (%li dropped, %li samples dropped), %.1f "
+         "MB, frame copy p50 %u us, p99 %u us\n",
+         path.c_str(), framesWritten(), framesDropped(), samplesDropped(),
+         offset / 1e6, copyLatency.percentile(50), copyLatency.percentile(99));
+  if (compress && frameBytes > 0) {
+    printf("recording: frames compressed %.2f : 1 (max error %i mm), encode "
+           "p50 %u us, p99 %u us\n",
+           (double)rawBytes / frameBytes, codec.maxError(),
+           encodeLatency.percentile(50), encodeLatency.percentile(99));
+  }
+}
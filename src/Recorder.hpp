@@ -0,0 +1,120 @@
+#pragma once
+
+//----------------------------------------------------------------------
+// INCLUDES
+//----------------------------------------------------------------------
+#include <stddef.h>
+#include <stdint.h>
+
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "DepthCodec.hpp"
+#include "DepthFrame.hpp"
+#include "LatencyHistogram.hpp"
+#include "Recording.hpp"
+
+class TimeLogger;
+
+//****************************************************************
+//                           SLOT RING
+//****************************************************************
+// Lock-free ring of fixed size slots between exactly one producer and one
+// consumer. The producer never waits: if all slots are full, claim() fails
+// and the caller drops its data.
+
+class SlotRing {
+public:
+  void allocate(int slots, size_t slotBytes);
+  size_t slotSize() const { return slotBytes; }
+
+  // PRODUCER SIDE: free slot to fill (nullptr if full), then commit() it
+  uint8_t *claim();
+  void commit();
+  // CONSUMER SIDE: oldest committed slot (nullptr if empty), then release()
+  const uint8_t *peek();
+  void release();
+
+private:
+  std::vector<uint64_t> buffer; // 8 byte aligned slots
+  size_t slotBytes = 0;
+  uint32_t count = 0;
+  // keep the indices of both sides on separate cache lines
+  alignas(64) std::atomic<uint32_t> head{0}; // next slot to fill
+  alignas(64) std::atomic<uint32_t> tail{0}; // next slot to write to disk
+};
+
+//****************************************************************
+//                            RECORDER
+//****************************************************************
+// Records a session (--record <dir>) into a file readable by ReplaySource
+// (format see Recording.hpp). The pipeline threads only copy their data into
+// preallocated rings and never wait: the processing thread its frames, the
+// sending thread motor values, IMU samples and the TimeLogger spans. A
+// writer thread appends them to the file (with an fsync every second) and
+// writes the index when the recording is stopped. If the disk can't keep up
+// and a ring is full, the data gets dropped and counted.
+// The writer thread compresses the frames with DepthCodec (unless disabled),
+// the producers always copy the raw planes.
+
+class Recorder {
+public:
+  static const int frameSlots = 64;          // ~1.4 s of frames at 45 fps
+  static const int maxPixels = 352 * 288;    // biggest camera resolution
+  static const int sampleSlots = 1024;       // tiles, imu and spans
+  static const int sampleBytes = 1024;       // per slot
+  static const int maxSpans = (sampleBytes - sizeof(Recording::ChunkHeader)) /
+                              sizeof(Recording::Span);
+
+  // frames compressed (default, lossless with maxError 0) or raw. Has to be
+  // set before start().
+  void setCompression(bool enabled, int maxError);
+  // create a new recording in dir and start the writer thread
+  bool start(const std::string &dir);
+  // write everything that's left and the index, close the file
+  void stop();
+  bool isRecording() const { return a_recording; }
+
+  // PRODUCERS: processing thread
+  void recordFrame(const DepthFrame &frame);
+  // PRODUCERS: sending thread
+  void recordTiles(const unsigned char *values, int count);
+  void recordImu(const Recording::ImuPayload &imu);
+  void recordSpans(TimeLogger &logger);
+
+  long framesWritten() const { return a_framesWritten; }
+  long framesDropped() const { return a_framesDropped; }
+  long samplesDropped() const { return a_samplesDropped; }
+
+private:
+  uint8_t *claimSample(uint32_t type, size_t size);
+  void writerLoop();
+  const uint8_t *encodeFrame(const uint8_t *chunk);
+  bool writeChunk(const uint8_t *chunk);
+  void finish();
+
+  std::string path;
+  int fd = -1;
+  uint64_t offset = 0; // end of the file
+  std::vector<Recording::IndexEntry> index;
+  SlotRing frames;
+  SlotRing samples;
+  std::thread writer;
+  std::atomic<bool> a_recording{false};
+  std::atomic<bool> a_stopping{false};
+  bool failed = false; // disk full or similar: stop writing
+  std::atomic<long> a_framesWritten{0};
+  std::atomic<long> a_framesDropped{0};
+  std::atomic<long> a_samplesDropped{0};
+  // time the processing thread spends copying a frame
+  LatencyHistogram copyLatency;
+  // compression (writer thread only)
+  bool compress = true;
+  DepthCodec codec;
+  std::vector<uint64_t> encoded; // chunk of the last encoded frame
+  uint64_t rawBytes = 0;         // frame chunks before compression
+  uint64_t frameBytes = 0;       // and as written
+  LatencyHistogram encodeLatency;
+};
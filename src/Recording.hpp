@@ -0,0 +1,97 @@
+#pragma once
+
+//----------------------------------------------------------------------
+// INCLUDES
+//----------------------------------------------------------------------
+#include <stddef.h>
+#include <stdint.h>
+
+//****************************************************************
+//                        RECORDING FORMAT
+//****************************************************************
+// File format of recorded sessions (read by ReplaySource). Little endian,
+// laid out so a memory-mapped file can be read in place:
+//
+//   FileHeader                       64 bytes
+//   Chunk, Chunk, ...                ChunkHeader + payload, each padded to
+//                                    8 bytes
+//   INDEX chunk + Trailer            written when the recording is closed
+//
+// A FRAME chunk holds a FramePayload followed by the depth plane (uint16 in
+// mm, width * height) and the confidence plane (uint8, width * height), or
+// with encoding CODEC a DepthCodec stream of both (frames in between key
+// frames can only be decoded in order, starting at the last key frame).
+// TILES, IMU and SPANS chunks hold the structs below.
+// The INDEX chunk is an array of IndexEntry, one per FRAME chunk. Recordings
+// that were not closed properly have no index and get scanned chunk by
+// chunk instead.
+
+namespace Recording {
+const char fileMagic[8] = {'U', 'N', 'F', 'R', 'E', 'C', '0', '1'};
+const char indexMagic[8] = {'U', 'N', 'F', 'R', 'I', 'D', 'X', '1'};
+const uint32_t version = 1;
+
+enum ChunkType : uint32_t {
+  FRAME = 1, // depth frame
+  TILES = 2, // motor values
+  IMU = 3,   // glove position
+  SPANS = 4, // TimeLogger spans
+  INDEX = 5, // offsets of all frames
+};
+
+enum Encoding : uint8_t {
+  RAW = 0,   // planes as they are
+  CODEC = 1, // compressed with DepthCodec
+};
+
+struct FileHeader {
+  char magic[8];
+  uint32_t version;
+  uint32_t headerSize; // sizeof(FileHeader), first chunk starts here
+  int64_t startTime;   // wall clock (us since epoch) at the start
+  uint8_t reserved[40];
+};
+static_assert(sizeof(FileHeader) == 64, "file header has to be 64 bytes");
+
+struct ChunkHeader {
+  uint32_t type;
+  uint32_t size;  // of the payload, without padding
+  int64_t timeUs; // when the chunk was recorded (steady clock)
+};
+
+struct FramePayload {
+  uint16_t width;
+  uint16_t height;
+  uint8_t encoding;
+  uint8_t reserved[3];
+  int64_t timeStamp; // capture time from royale in us
+};
+
+struct TilesPayload {
+  uint8_t count;      // motors of the layout
+  uint8_t values[16]; // one per motor (up to ActuatorLayout::maxMotors)
+};
+
+struct ImuPayload {
+  float ax, ay, az; // in mg
+  float gx, gy, gz; // in 0.1 dps
+};
+
+// SPANS: array of Span, the TimeLogger entries of one frame
+struct Span {
+  int32_t us;   // since the first entry
+  char tag[20]; // zero terminated (cut off if longer)
+};
+
+struct IndexEntry {
+  uint64_t offset; // of the ChunkHeader
+  int64_t timeStamp;
+};
+
+struct Trailer {
+  uint64_t indexOffset; // of the INDEX ChunkHeader
+  char magic[8];
+};
+
+inline size_t padded(size_t size) { return (size + 7) & ~(size_t)7; }
+} // namespace Recording
@@ -0,0 +1,56 @@
+#pragma once
+
+//----------------------------------------------------------------------
+// INCLUDES
+//----------------------------------------------------------------------
+#include <stddef.h>
+#include <stdint.h>
+
+//****************************************************************
+//                       REGISTER PROGRAM
+//****************************************************************
+// Settings of a device as (register, value) pairs in the order they have to
+// be written, compiled into block writes: registers that follow each other
+// go into one write, the device moves its register pointer on by itself
+// (e.g. {0x16, a}, {0x17, b} -> 0x16: a b). The blocks are built by the
+// compiler (constexpr with loops: C++14, the standard the Makefile pins), at
+// runtime there is only the loop over them.
+
+struct RegSetting {
+  uint8_t reg;
+  uint8_t value;
+};
+
+class RegisterProgram {
+public:
+  static const int maxSettings = 8;
+
+  struct Block {
+    uint8_t reg = 0; // first register
+    uint8_t length = 0;
+    uint8_t values[maxSettings] = {};
+  };
+
+  template <size_t N>
+  constexpr RegisterProgram(const RegSetting (&settings)[N])
+      : blocks(), count(0) {
+    static_assert(N > 0 && N <= maxSettings, "1 to 8 settings per program");
+    for (size_t i = 0; i < N; i++) {
+      Block *last = count ? &blocks[count - 1] : nullptr;
+      if (last && settings[i].reg == last->reg + last->length) {
+        last->values[last->length++] = settings[i].value;
+      } else {
+        blocks[count].reg = settings[i].reg;
+        blocks[count].length = 1;
+        blocks[count].values[0] = settings[i].value;
+        count++;
+      }
+    }
+  }
+  constexpr int size() const { return count; }
+  constexpr const Block &operator[](int i) const { return blocks[i]; }
+
+private:
+  Block blocks[maxSettings];
+  int count;
+};
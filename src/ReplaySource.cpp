@@ -0,0 +1,348 @@
+/* INFO
+ * Replay of recorded sessions: memory-maps the recording, indexes its frames
+ * and feeds them to the pipeline like the camera would (see ReplaySource.hpp).
+ */
+
+//----------------------------------------------------------------------
+// INCLUDES
+//----------------------------------------------------------------------
+#include "ReplaySource.hpp"
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "Globals.hpp"
+
+using namespace std::chrono;
+
+//----------------------------------------------------------------------
+// DECLARATIONS AND VARIABLES
+//----------------------------------------------------------------------
+// fast playback: how often to check if the last frame got picked up
+const auto backPressurePoll = microseconds(50);
+
+//----------------------------------------------------------------------
+// METHODS
+//----------------------------------------------------------------------
+ReplaySource::ReplaySource(const Options &options) : opts(options) {}
+
+ReplaySource::~ReplaySource() {
+  stop();
+  if (base != nullptr) {
+    munmap((void *)base, size);
+  }
+  if (fd >= 0) {
+    close(fd);
+  }
+}
+
+//________________________________________________
+// Map the file and index its frames. Only done once, unfolding() calls this
+// again after every restart.
+bool ReplaySource::open() {
+  if (base != nullptr) {
+    return true;
+  }
+  const char *path = opts.path.c_str();
+  fd = ::open(path, O_RDONLY);
+  struct stat st;
+  if (fd < 0 || fstat(fd, &st) != 0) {
+    printf("can't open recording %s: %s\n", path, strerror(errno));
+    return false;
+  }
+  size = (size_t)st.st_size;
+  if (size < sizeof(Recording::FileHeader)) {
+    printf("recording %s is too short\n", path);
+    return false;
+  }
+  void *mapped = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+  if (mapped == MAP_FAILED) {
+    printf("can't map recording %s: %s\n", path, strerror(errno));
+    return false;
+  }
+  base = (const uint8_t *)mapped;
+  // frames are read front to back (and every one of them just once)
+  madvise(mapped, size, MADV_SEQUENTIAL);
+
+  const Recording::FileHeader *header = (const Recording::FileHeader *)base;
+  if (memcmp(header->magic, Recording::fileMagic, 8) != 0 ||
+      header->version != Recording::version ||
+      header->headerSize < sizeof(Recording::FileHeader) ||
+      header->headerSize > size) {
+    printf("%s is no recording (or of an unknown version)\n", path);
+    return false;
+  }
+  if (!buildIndex()) {
+    printf("recording %s has no frames\n", path);
+    return false;
+  }
+  const Recording::FramePayload *first = frameAt(0);
+  const Recording::FramePayload *last = frameAt(frameCount() - 1);
+  printf("replay %s: %li frames of %i x %i, %.1f s\n", path, frameCount(),
+         first->width, first->height,
+         (last->timeStamp - first->timeStamp) / 1e6);
+  if (opts.startFrame > 0 && !seek(opts.startFrame)) {
+    printf("can't start at frame %li\n", opts.startFrame);
+    return false;
+  }
+  return true;
+}
+
+//________________________________________________
+// Use the index at the end of the file, or find the frames chunk by chunk
+// if the recording wasn't closed properly
+bool ReplaySource::buildIndex() {
+  frames.clear();
+  if (!readIndex()) {
+    frames.clear();
+    printf("recording has no index, scanning it\n");
+    scanChunks();
+  }
+  return !frames.empty();
+}
+
+//________________________________________________
+bool ReplaySource::readIndex() {
+  const size_t headerSize = sizeof(Recording::ChunkHeader);
+  if (size < sizeof(Recording::FileHeader) + sizeof(Recording::Trailer)) {
+    return false;
+  }
+  const Recording::Trailer *trailer =
+      (const Recording::Trailer *)(base + size - sizeof(Recording::Trailer));
+  if (memcmp(trailer->magic, Recording::indexMagic, 8) != 0 ||
+      trailer->indexOffset % 8 != 0 ||
+      trailer->indexOffset + headerSize > size) {
+    return false;
+  }
+  const Recording::ChunkHeader *chunk =
+      (const Recording::ChunkHeader *)(base + trailer->indexOffset);
+  if (chunk->type != Recording::INDEX ||
+      trailer->indexOffset + headerSize + chunk->size > size) {
+    return false;
+  }
+  const Recording::IndexEntry *entries =
+      (const Recording::IndexEntry *)(chunk + 1);
+  size_t count = chunk->size / sizeof(Recording::IndexEntry);
+  for (size_t i = 0; i < count; i++) {
+    uint64_t offset = entries[i].offset;
+    if (offset % 8 != 0 || offset + headerSize > size) {
+      return false;
+    }
+    if (playable(offset)) {
+      frames.push_back(offset);
+    }
+  }
+  return true;
+}
+
+//________________________________________________
+// Walk through all chunks, stops at the first truncated one
+void ReplaySource::scanChunks() {
+  const size_t headerSize = sizeof(Recording::ChunkHeader);
+  size_t offset = ((const Recording::FileHeader *)base)->headerSize;
+  offset = Recording::padded(offset);
+  while (offset + headerSize <= size) {
+    const Recording::ChunkHeader *chunk =
+        (const Recording::ChunkHeader *)(base + offset);
+    if (offset + headerSize + chunk->size > size) {
+      break; // the recording got cut off here
+    }
+    if (chunk->type == Recording::FRAME && playable(offset)) {
+      frames.push_back(offset);
+    }
+    offset += headerSize + Recording::padded(chunk->size);
+  }
+}
+
+//________________________________________________
+// A complete FRAME chunk with planes this version can decode
+bool ReplaySource::playable(uint64_t offset) const {
+  const Recording::ChunkHeader *chunk =
+      (const Recording::ChunkHeader *)(base + offset);
+  if (chunk->type != Recording::FRAME ||
+      offset + sizeof(Recording::ChunkHeader) + chunk->size > size ||
+      chunk->size < sizeof(Recording::FramePayload)) {
+    return false;
+  }
+  const Recording::FramePayload *payload =
+      (const Recording::FramePayload *)(chunk + 1);
+  size_t pixels = (size_t)payload->width * payload->height;
+  if (payload->encoding == Recording::CODEC) {
+    return DepthCodec::valid((const uint8_t *)(payload + 1),
+                             chunk->size - sizeof(Recording::FramePayload),
+                             payload->width, payload->height);
+  }
+  return payload->encoding == Recording::RAW &&
+         chunk->size >= sizeof(Recording::FramePayload) + pixels * 3;
+}
+
+//________________________________________________
+const Recording::FramePayload *ReplaySource::frameAt(long n) const {
+  return (const Recording::FramePayload *)(base + frames[n] +
+                                           sizeof(Recording::ChunkHeader));
+}
+
+//________________________________________________
+bool ReplaySource::seek(long n) {
+  if (n < 0 || n >= frameCount()) {
+    return false;
+  }
+  next = n;
+  seeked = true;
+  return true;
+}
+
+//________________________________________________
+// Raw frames and key frames can be decoded on their own
+bool ReplaySource::isKeyFrame(long n) const {
+  const Recording::FramePayload *payload = frameAt(n);
+  return payload->encoding == Recording::RAW ||
+         DepthCodec::isKey((const uint8_t *)(payload + 1));
+}
+
+//________________________________________________
+// Bring the codec to frame n: just the next one in a row, otherwise all
+// from the last key frame on
+bool ReplaySource::decodeFrame(long n) {
+  long from = n;
+  if (decoded < 0 || n != decoded + 1) {
+    while (from > 0 && !isKeyFrame(from)) {
+      from--;
+    }
+  }
+  for (long i = from; i <= n; i++) {
+    const uint8_t *chunk = base + frames[i];
+    const Recording::FramePayload *payload =
+        (const Recording::FramePayload *)(chunk +
+                                          sizeof(Recording::ChunkHeader));
+    size_t bytes = ((const Recording::ChunkHeader *)chunk)->size -
+                   sizeof(Recording::FramePayload);
+    if (payload->encoding != Recording::CODEC ||
+        !codec.decode((const uint8_t *)(payload + 1), bytes)) {
+      decoded = -1;
+      return false;
+    }
+    decoded = i;
+  }
+  return true;
+}
+
+//________________________________________________
+// Copy one frame from the mapping (or the codec) into the frame mailbox (the
+// planes are stored without row padding, the DepthFrame rows are 64 byte
+// aligned)
+bool ReplaySource::copyFrame(long n) {
+  const Recording::FramePayload *payload = frameAt(n);
+  int width = payload->width;
+  int height = payload->height;
+  const uint16_t *depth = (const uint16_t *)(payload + 1);
+  const uint8_t *conf = (const uint8_t *)(depth + (size_t)width * height);
+  if (payload->encoding == Recording::CODEC) {
+    if (!decodeFrame(n)) {
+      printf("replay: can't decode frame %li, skipped\n", n);
+      return false;
+    }
+    depth = codec.depth();
+    conf = codec.conf();
+  }
+  DepthFrame &frame = beginFrame();
+  frame.resize(width, height);
+  frame.timeStamp = payload->timeStamp;
+  for (int y = 0; y < height; y++) {
+    memcpy(frame.depthRow(y), depth + y * width, width * sizeof(uint16_t));
+    memcpy(frame.confRow(y), conf + y * width, width);
+  }
+  publishFrame();
+  return true;
+}
+
+//________________________________________________
+bool ReplaySource::start() {
+  if (player.joinable()) {
+    return true;
+  }
+  stopping = false;
+  done = false;
+  playing = true;
+  Clock::addParticipant();
+  player = std::thread([this] { playbackLoop(); });
+  return true;
+}
+
+//________________________________________________
+bool ReplaySource::stop() {
+  stopping = true;
+  if (player.joinable()) {
+    Clock::Idle idle;
+    player.join();
+  }
+  return true;
+}
+
+//________________________________________________
+// Plays the frames on this thread, like libroyale calls onNewData() from its
+// own thread
+void ReplaySource::playbackLoop() {
+  Clock::Participant participant;
+  Clock::time_point syncTime;
+  int64_t syncStamp = 0;
+  bool resync = true;
+  played = 0;
+  startTime = Clock::now();
+  while (!stopping) {
+    long n = next;
+    if (n >= frameCount()) {
+      if (!opts.loop) {
+        break;
+      }
+      next = 0;
+      continue;
+    }
+    if (seeked.exchange(false) || n == 0) {
+      resync = true;
+    }
+    const Recording::FramePayload *payload = frameAt(n);
+    if (opts.fast) {
+      // don't let frames get overwritten: wait until the last one got
+      // picked up by the processing
+      while (Glob::frameMailbox.hasNew() && !stopping) {
+        Clock::sleepFor(backPressurePoll);
+      }
+    } else {
+      // recorded timing, relative to the first frame played (or the last
+      // seek / jump back in time)
+      if (resync || payload->timeStamp < syncStamp) {
+        syncTime = Clock::now();
+        syncStamp = payload->timeStamp;
+        resync = false;
+      }
+      Clock::sleepUntil(syncTime +
+                        microseconds(payload->timeStamp - syncStamp));
+    }
+    if (stopping) {
+      break;
+    }
+    if (copyFrame(n)) {
+      played++;
+    }
+    // keep a seek that happened in between
+    next.compare_exchange_strong(n, n + 1);
+  }
+  endTime = Clock::now();
+  playing = false;
+  done = !stopping;
+}
+
+//________________________________________________
+void ReplaySource::printSummary() {
+  double seconds = duration<double>(endTime - startTime).count();
+  printf("replay: %li frames in %.2f s (%.1f fps), %li overwritten before "
+         "processing\n",
+         played, seconds, seconds > 0 ? played / seconds : 0.0,
+         Glob::frameMailbox.overwritten());
+  printPipelineSummary();
+}
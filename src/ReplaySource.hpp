@@ -0,0 +1,83 @@
+#pragma once
+
+//----------------------------------------------------------------------
+// INCLUDES
+//----------------------------------------------------------------------
+#include <stddef.h>
+#include <stdint.h>
+
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "DepthCodec.hpp"
+#include "Clock.hpp"
+#include "FrameSource.hpp"
+#include "Recording.hpp"
+
+//****************************************************************
+//                          REPLAY SOURCE
+//****************************************************************
+// Plays a recorded session (format see Recording.hpp) through the same
+// pipeline as the live camera. The file is memory-mapped, frames are copied
+// straight from the mapping into the frame mailbox by a playback thread,
+// either at the recorded timing or as fast as the processing can take them
+// (next frame as soon as the last one got picked up). Compressed frames get
+// decoded on the way (after a seek starting at the last key frame).
+
+class ReplaySource : public FrameSource {
+public:
+  struct Options {
+    std::string path;
+    bool fast = false; // don't wait for the recorded timing
+    bool loop = false; // start over at the end
+    long startFrame = 0;
+  };
+
+  explicit ReplaySource(const Options &options);
+  ~ReplaySource();
+
+  bool open() override;
+  bool start() override;
+  bool stop() override;
+  bool isConnected() override { return base != nullptr; }
+  bool isCapturing() override { return playing; }
+  bool finished() override { return done; }
+  const char *name() const override { return "replay"; }
+
+  long frameCount() const { return (long)frames.size(); }
+  // continue playback at frame n (0..frameCount()-1)
+  bool seek(long n);
+  void printSummary() override;
+
+private:
+  bool buildIndex();
+  bool readIndex();
+  void scanChunks();
+  bool playable(uint64_t offset) const;
+  const Recording::FramePayload *frameAt(long n) const;
+  bool isKeyFrame(long n) const;
+  bool decodeFrame(long n);
+  bool copyFrame(long n);
+  void playbackLoop();
+
+  Options opts;
+  int fd = -1;
+  const uint8_t *base = nullptr; // the mapped file
+  size_t size = 0;
+  std::vector<uint64_t> frames; // offsets of all FRAME chunks
+  DepthCodec codec;
+  long decoded = -1; // frame the codec holds
+
+  std::thread player;
+  std::atomic<bool> playing{false};
+  std::atomic<bool> stopping{false};
+  std::atomic<bool> done{false};
+  std::atomic<long> next{0};   // frame to play next
+  std::atomic<bool> seeked{false};
+  long played = 0;
+  Clock::time_point startTime;
+  Clock::time_point endTime;
+};
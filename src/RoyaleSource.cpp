@@ -0,0 +1,261 @@
+/* INFO
+ * Live frames from the Pico Flexx: finding and initializing the camera,
+ * the onNewData() callback that gets called from the libroyale lib whenever
+ * a new depth data frame is ready, and the royale event listener.
+ */
+
+//----------------------------------------------------------------------
+// INCLUDES
+//----------------------------------------------------------------------
+#include "RoyaleSource.hpp"
+
+#include <iostream>
+#include <mutex>
+#include <sstream>
+#include <string>
+
+#include "Clock.hpp"
+#include "Globals.hpp"
+
+using std::cerr;
+using std::cout;
+using std::endl;
+using namespace royale;
+using namespace std::chrono;
+
+//----------------------------------------------------------------------
+// METHODS
+//----------------------------------------------------------------------
+FrameSource *FrameSource::camera() { return new RoyaleSource(); }
+
+//________________________________________________
+// Wait until a camera is plugged in, then initialize it with the selected
+// use case and register the listeners
+bool RoyaleSource::open() {
+  CameraManager manager;
+  Vector<String> camlist;
+  cameraDevice.reset();
+
+  // check if the cam is connected before init anything
+  bool cameraSearchBlink = false;
+  while (camlist.empty()) {
+    cameraSearchBlink = !cameraSearchBlink;
+    camlist = manager.getConnectedCameraList();
+    if (!camlist.empty()) {
+      cameraDevice = manager.createCamera(camlist[0]);
+      break;
+    }
+    Glob::led1.setG(0);
+    cout << ":";
+    cout.flush();
+    Clock::sleepFor(milliseconds(100));
+    if (cameraSearchBlink)
+      Glob::led1.setB(1);
+    else
+      Glob::led1.setB(0);
+  }
+  // Turn Off Camera Search blink
+  Glob::led1.setB(0);
+  Glob::led1.setG(1);
+  Glob::logger.mainLogger.store("search");
+
+  //  camera device is now available, CameraManager can be deallocated here
+  if (cameraDevice == nullptr) {
+    // no cameraDevice available
+    cerr << "Cannot create the camera device" << endl;
+    return false;
+  }
+  // IMPORTANT: call the initialize method before working with camera device
+  // #costly: rpi4 1000ms
+  auto status = cameraDevice->initialize();
+  Glob::logger.mainLogger.store("cam");
+
+  if (status != CameraStatus::SUCCESS) {
+    cerr << "Cannot initialize the camera device, error string : "
+         << getErrorString(status) << endl;
+    return false;
+  }
+  Vector<String> useCases;
+  auto usecaseStatus = cameraDevice->getUseCases(useCases);
+
+  if (usecaseStatus != CameraStatus::SUCCESS || useCases.empty()) {
+    cerr << "No use cases are available" << endl;
+    cerr << "getUseCases() returned: " << getErrorString(usecaseStatus) << endl;
+    return false;
+  }
+  cerr << useCases << endl;
+  // choose a use case
+  uint selectedUseCaseIdx = 0u;
+  if (Glob::modes.a_cameraUseCase) {
+    cerr << "got the argument:" << Glob::modes.a_cameraUseCase << endl;
+    auto useCaseFound = false;
+    if (Glob::modes.a_cameraUseCase < useCases.size()) {
+      selectedUseCaseIdx = Glob::modes.a_cameraUseCase;
+      useCaseFound = true;
+    }
+
+    if (!useCaseFound) {
+      cerr << "Error: the chosen use case is not supported by this camera"
+           << endl;
+      cerr << "A list of supported use cases is printed by sampleCameraInfo"
+           << endl;
+      return false;
+    }
+  } else {
+    cerr << "Here: autousecase id" << endl;
+    // choose the first use case
+    selectedUseCaseIdx = 0;
+  }
+  // set an operation mode
+  if (cameraDevice->setUseCase(useCases.at(selectedUseCaseIdx)) !=
+      CameraStatus::SUCCESS) {
+    cerr << "Error setting use case" << endl;
+    return false;
+  }
+  // retrieve the lens parameters from Royale
+  LensParameters lensParameters;
+  status = cameraDevice->getLensParameters(lensParameters);
+  if (status != CameraStatus::SUCCESS) {
+    cerr << "Can't read out the lens parameters" << endl;
+    return false;
+  }
+
+  // register a data listener
+  if (cameraDevice->registerDataListener(this) != CameraStatus::SUCCESS) {
+    cerr << "Error registering data listener" << endl;
+    return false;
+  }
+  Glob::logger.mainLogger.store("regist");
+  // register a EVENT listener
+  cameraDevice->registerEventListener(&eventReporter);
+  return true;
+}
+
+//________________________________________________
+// start capture mode
+// #costly: rpi4 500ms
+bool RoyaleSource::start() {
+  if (cameraDevice->startCapture() != CameraStatus::SUCCESS) {
+    cerr << "Error starting the capturing" << endl;
+    return false;
+  }
+  return true;
+}
+
+//________________________________________________
+bool RoyaleSource::stop() {
+  if (cameraDevice->stopCapture() != CameraStatus::SUCCESS) {
+    cerr << "Error stopping the capturing" << endl;
+    return false;
+  }
+  return true;
+}
+
+//________________________________________________
+// Get all the data of the royal lib to see if camera is working
+bool RoyaleSource::isConnected() {
+  bool connected = false;
+  cameraDevice->isConnected(connected);
+  return connected;
+}
+
+bool RoyaleSource::isCapturing() {
+  bool capturing = false;
+  cameraDevice->isCapturing(capturing);
+  return capturing;
+}
+
+/******************************************************************************
+ *                                 ON NEW DATA
+ *                               ***************
+ * gets called everytime there is a new depth frame from the Pico Flexx
+ * As this is a callback function and the code is unknown we want it to
+ * return as fast as possible. Therefore it only copies the data into the
+ * lock-free frame mailbox and wakes the processing thread.
+ * In the inline mode (--inline) it processes the frame right away instead,
+ * saving the thread hop. Only the motor values go to the sending thread.
+ ******************************************************************************/
+void RoyaleSource::onNewData(const DepthData *data) {
+  // copy depth and confidence of the frame into the free slot of the mailbox
+  // and publish it. Everything else in DepthData (x, y, noise, grayValue,
+  // ...) isn't used by the pipeline and therefore not copied.
+  DepthFrame &frame = beginFrame();
+  int width = data->width;
+  int height = data->height;
+  frame.resize(width, height);
+  frame.timeStamp = data->timeStamp.count();
+  const DepthPoint *points = data->points.data();
+  for (int y = 0; y < height; y++) {
+    const DepthPoint *rowPoints = points + y * width;
+    uint16_t *depthRow = frame.depthRow(y);
+    uint8_t *confRow = frame.confRow(y);
+    for (int x = 0; x < width; x++) {
+      depthRow[x] = DepthFrame::toMillimeters(rowPoints[x].z);
+      confRow[x] = rowPoints[x].depthConfidence;
+    }
+  }
+  publishFrame();
+}
+//                                    _____
+//                                 [onNewData]
+//____________________________________________________________________________
+
+/******************************************************************************
+ *                                EVENT REPORTER
+ ******************************************************************************/
+
+void EventReporter::onEvent(std::unique_ptr<IEvent> &&event) {
+  EventSeverity severity = event->severity();
+  switch (severity) {
+  case EventSeverity::ROYALE_INFO:
+    // cerr << "info: " << event->describe() << endl;
+    extractDrops(event->describe());
+    break;
+  case EventSeverity::ROYALE_WARNING:
+    // cerr << "warning: " << event->describe() << endl;
+    extractDrops(event->describe());
+    break;
+  case EventSeverity::ROYALE_ERROR:
+    cerr << "error: " << event->describe() << endl;
+    break;
+  case EventSeverity::ROYALE_FATAL:
+    cerr << "fatal: " << event->describe() << endl;
+    break;
+  default:
+    // cerr << "waits..." << event->describe() << endl;
+    break;
+  }
+}
+//________________________________________________
+// Royale Event Listener reports dropped frames as string.
+// This functions extracts the number of frames that got lost at Bridge/FC.
+// I believe, that dropped frames cause instability – PMDtec confirmed this
+void EventReporter::extractDrops(String str) {
+  using namespace std;
+  stringstream ss;
+  /* Storing the whole string into string stream */
+  ss << str;
+  /* Running loop till the end of the stream */
+  string temp;
+  int found;
+  int i = 0;
+  while (!ss.eof()) {
+    /* extracting word by word from stream */
+    ss >> temp;
+    /* Checking the given word is integer or not */
+    if (stringstream(temp) >> found) {
+      if (i == 0) {
+        std::lock_guard<std::mutex> lock(Glob::udpServMux);
+        Glob::udpServer.preparePacket("drpBridge", found);
+        Glob::udpServer.preparePacket("drpFC", found);
+        Glob::udpServer.preparePacket("delivFrames", found);
+      }
+      i++;
+    }
+    /* To save from space at the end of string */
+    temp = "";
+  }
+  // {std::lock_guard<std::mutex> lock(Glob::udpServMux);
+  // Glob::udpServer.preparePacket("11", tenSecsDrops);}
+  // tenSecsDrops += droppedAtBridge + droppedAtFC;
+}
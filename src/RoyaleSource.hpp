@@ -0,0 +1,46 @@
+#pragma once
+
+//----------------------------------------------------------------------
+// INCLUDES
+//----------------------------------------------------------------------
+#include <memory>
+#include <royale.hpp>
+#include <royale/IEvent.hpp>
+
+#include "FrameSource.hpp"
+
+//****************************************************************
+//                          ROYALE SOURCE
+//****************************************************************
+// The live Pico Flexx camera via libroyale. Its onNewData() gets called by
+// libroyale whenever a new depth frame is ready.
+
+//________________________________________________
+// Gets called by Royale irregularily.
+// Holds the camera state, errors and info about drops
+class EventReporter : public royale::IEventListener {
+public:
+  virtual ~EventReporter() = default;
+
+  virtual void onEvent(std::unique_ptr<royale::IEvent> &&event) override;
+
+private:
+  void extractDrops(royale::String str);
+};
+
+class RoyaleSource : public FrameSource, public royale::IDepthDataListener {
+public:
+  bool open() override;
+  bool start() override;
+  bool stop() override;
+  bool isConnected() override;
+  bool isCapturing() override;
+  const char *name() const override { return "pico flexx"; }
+
+  void onNewData(const royale::DepthData *data) override;
+
+private:
+  // this represents the main camera device object
+  std::unique_ptr<royale::ICameraDevice> cameraDevice;
+  EventReporter eventReporter;
+};
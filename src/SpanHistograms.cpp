@@ -0,0 +1,98 @@
+/* INFO
+ * Session-long latency histograms of the TimeLogger spans (see
+ * SpanHistograms.hpp).
+ */
+
+//----------------------------------------------------------------------
+// INCLUDES
+//----------------------------------------------------------------------
+#include "SpanHistograms.hpp"
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+//----------------------------------------------------------------------
+// METHODS
+//----------------------------------------------------------------------
+
+//________________________________________________
+// The slot of the span, or the first free one gets claimed for it. Spans
+// beyond maxSpans aren't recorded.
+void SpanHistograms::record(TimeLogger::Tag span, uint32_t us) {
+  for (Slot &slot : slots) {
+    uint32_t id = slot.id.load(std::memory_order_acquire);
+    if (id == 0) {
+      // claim it (or somebody else was faster, maybe with the same span)
+      if (slot.id.compare_exchange_strong(id, span.id(),
+                                          std::memory_order_acq_rel)) {
+        slot.name.store(span.name(), std::memory_order_release);
+        id = span.id();
+      }
+    }
+    if (id == span.id()) {
+      slot.histo.record(us);
+      return;
+    }
+  }
+}
+
+//________________________________________________
+// Spans keep their slots, only the values are cleared
+void SpanHistograms::reset() {
+  for (Slot &slot : slots) {
+    slot.histo.reset();
+  }
+}
+
+//________________________________________________
+std::vector<unsigned char> SpanHistograms::summary() const {
+  auto put = [](std::vector<unsigned char> &out, uint32_t value) {
+    for (int i = 0; i < 4; i++) {
+      out.push_back((value >> (8 * i)) & 0xFF);
+    }
+  };
+  std::vector<unsigned char> out;
+  for (const Slot &slot : slots) {
+    const char *name = slot.name.load(std::memory_order_acquire);
+    if (name == nullptr) {
+      continue;
+    }
+    out.insert(out.end(), name, name + strlen(name) + 1);
+    put(out, slot.histo.percentile(50));
+    put(out, slot.histo.percentile(99));
+    put(out, slot.histo.max());
+    put(out, (uint32_t)slot.histo.count());
+  }
+  return out;
+}
+
+//________________________________________________
+bool SpanHistograms::dump(const std::string &path) const {
+  FILE *file = fopen(path.c_str(), "a");
+  if (file == nullptr) {
+    printf("can't write span histograms to %s\n", path.c_str());
+    return false;
+  }
+  time_t now = time(nullptr);
+  char date[32];
+  strftime(date, sizeof(date), "%Y-%m-%d %H:%M:%S", localtime(&now));
+  fprintf(file, "# span latencies (us), %s\n", date);
+  fprintf(file, "%-14s %8s %8s %8s %8s %8s %10s\n", "span", "p50", "p90",
+          "p99", "p99.9", "max", "count");
+  for (const Slot &slot : slots) {
+    const char *name = slot.name.load(std::memory_order_acquire);
+    if (name == nullptr) {
+      continue;
+    }
+    const LatencyHistogram &histo = slot.histo;
+    fprintf(file, "%-14s %8u %8u %8u %8u %8u %10llu\n", name,
+            histo.percentile(50), histo.percentile(90), histo.percentile(99),
+            histo.percentile(99.9), histo.max(),
+            (unsigned long long)histo.count());
+  }
+  fprintf(file, "\n");
+  fclose(file);
+  printf("span histograms appended to %s\n", path.c_str());
+  return true;
+}
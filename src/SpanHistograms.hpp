@@ -0,0 +1,45 @@
+#pragma once
+
+//----------------------------------------------------------------------
+// INCLUDES
+//----------------------------------------------------------------------
+#include <stdint.h>
+
+#include <atomic>
+#include <string>
+#include <vector>
+
+#include "LatencyHistogram.hpp"
+#include "TimeLogger.hpp"
+
+//****************************************************************
+//                        SPAN HISTOGRAMS
+//****************************************************************
+// A LatencyHistogram for every named span of the TimeLoggers (onNewData,
+// processing, gloveSending, pause, wholeCycle, imu), filled by
+// TimeLogger::udpTimeSpan() for the whole session, so the p50/p99/max show
+// up and not only single values. A span gets its histogram the first time
+// it's recorded. Lock-free: any thread may record, read or reset.
+// The UdpServer sends a summary once a second (spanStats), SIGUSR1 appends
+// a table to a file (--spanDump) and the udp request 'r' resets them.
+
+class SpanHistograms {
+public:
+  static const int maxSpans = 16;
+
+  void record(TimeLogger::Tag span, uint32_t us);
+  void reset();
+  // per span: its name and 0, then p50, p99, max and count as uint32 (us,
+  // little endian)
+  std::vector<unsigned char> summary() const;
+  // append the table to the file (false if it can't be written)
+  bool dump(const std::string &path) const;
+
+private:
+  struct Slot {
+    std::atomic<uint32_t> id{0}; // 0: free
+    std::atomic<const char *> name{nullptr};
+    LatencyHistogram histo;
+  };
+  Slot slots[maxSpans];
+};
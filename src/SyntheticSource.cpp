@@ -0,0 +1,314 @@
+/* INFO
+ * Generated depth frames with ground truth (SyntheticScene) and the frame
+ * source feeding them to the pipeline (see SyntheticSource.hpp).
+ */
+
+//----------------------------------------------------------------------
+// INCLUDES
+//----------------------------------------------------------------------
+#include "SyntheticSource.hpp"
+
+#include <math.h>
+#include <stdio.h>
+
+#include <algorithm>
+
+#include "DepthKernel.hpp"
+#include "DepthSearch.hpp"
+#include "Globals.hpp"
+
+using namespace std::chrono;
+
+//----------------------------------------------------------------------
+// DECLARATIONS AND VARIABLES
+//----------------------------------------------------------------------
+// camera model (Pico Flexx): field of view 62 x 45 deg -> slope of the ray
+// through the left / top border of the image
+const float slopeX = 0.601f; // tan(31 deg)
+const float slopeY = 0.414f; // tan(22.5 deg)
+// the confidence is 255 up to this distance and falls off with 1/z^2
+const float fullConfidenceMm = 700;
+// pixels (per mille) that drop out (confidence 0) in every scene
+const uint32_t dropoutPerMille = 3;
+// fps 0: how often to check if the last frame got picked up
+const auto backPressurePoll = microseconds(50);
+
+namespace {
+
+//________________________________________________
+// xorshift32, seeded per frame
+struct Random {
+  explicit Random(long frame)
+      : state((uint32_t)frame * 2654435761u ^ 0x9e3779b9u) {
+    if (state == 0) {
+      state = 1;
+    }
+  }
+  inline uint32_t next() {
+    state ^= state << 13;
+    state ^= state >> 17;
+    state ^= state << 5;
+    return state;
+  }
+  // roughly normal (sum of 4 uniform bytes), mean 0 and sigma 1
+  inline float normal() {
+    uint32_t r = next();
+    int sum = (int)(r & 255) + (int)((r >> 8) & 255) + (int)((r >> 16) & 255) +
+              (int)(r >> 24);
+    return (sum - 510) * (1.0f / 147.8f);
+  }
+  uint32_t state;
+};
+
+// the fractional part (wraps positions moving through the image)
+inline float frac(float v) { return v - floorf(v); }
+
+//________________________________________________
+// Depth (mm) of the nearest surface at image position u, v (0..1) in scene
+// `kind` at phase p (0..1 through the scene). invalid: a surface the camera
+// can't see (no signal).
+float sceneDepth(SyntheticScene::Kind kind, float p, float u, float v,
+                 bool &invalid) {
+  // slopes of the ray through this pixel
+  float sx = (2 * u - 1) * slopeX;
+  float sy = (2 * v - 1) * slopeY;
+  invalid = false;
+  switch (kind) {
+  case SyntheticScene::PLANE: {
+    // wall turned by 20 deg, moving between 0.4 and 2.2 m
+    float z = 400 + 1800 * (0.5f - 0.5f * cosf(2 * (float)M_PI * p));
+    return z / (1 - sx * 0.364f);
+  }
+  case SyntheticScene::CORRIDOR: {
+    // 2 m wide, camera 1.2 m above the floor, end wall coming closer
+    float z = 4000 - 3000 * p;
+    if (sy > 0.01f) {
+      z = std::min(z, 1200 / sy);
+    }
+    if (fabsf(sx) > 0.01f) {
+      z = std::min(z, 1000 / fabsf(sx));
+    }
+    return z;
+  }
+  case SyntheticScene::POLES: {
+    // poles with a radius of 60 mm in front of a wall, moving sideways
+    float z = 2200;
+    for (int i = 0; i < 3; i++) {
+      float poleZ = 600 + 500 * i;
+      float center = frac(0.15f + 0.33f * i + 0.5f * p);
+      float halfWidth = 60 / (2 * slopeX * poleZ);
+      float t = (u - center) / halfWidth;
+      if (fabsf(t) < 1) {
+        z = std::min(z, poleZ - 60 * sqrtf(1 - t * t));
+      }
+    }
+    return z;
+  }
+  case SyntheticScene::NEAR_FIELD: {
+    // a hand 7 to 15 cm in front of the camera, wall behind it
+    float du = (u - (0.25f + 0.5f * p)) / 0.22f;
+    float dv = (v - 0.65f) / 0.3f;
+    float r2 = du * du + dv * dv;
+    return r2 < 1 ? 70 + 80 * r2 : 1500;
+  }
+  case SyntheticScene::INVALID: {
+    // floor-like plane, patches that absorb the light moving over it
+    for (int i = 0; i < 4; i++) {
+      float cu = frac(0.2f + 0.25f * i + 0.3f * p);
+      float cv = 0.2f + 0.2f * i;
+      if (fabsf(u - cu) < 0.09f && fabsf(v - cv) < 0.1f) {
+        invalid = true;
+      }
+    }
+    return 900 + 800 * (1 - v);
+  }
+  case SyntheticScene::STAIRS:
+  default: {
+    // steps of 28 cm, the lower the nearer, walking up towards them
+    float steps = (1 - v) * 9 + 3 * p;
+    return 450 + 280 * (floorf(steps) - 3 * p);
+  }
+  }
+}
+
+} // namespace
+
+//----------------------------------------------------------------------
+// METHODS
+//----------------------------------------------------------------------
+SyntheticScene::SyntheticScene(int frames)
+    : framesPerScene(std::max(frames, 1)) {}
+
+//________________________________________________
+const char *SyntheticScene::name(Kind kind) {
+  static const char *names[kinds] = {"plane",      "corridor", "poles",
+                                     "near field", "invalid",  "stairs"};
+  return kind >= 0 && kind < kinds ? names[kind] : "?";
+}
+
+//________________________________________________
+void SyntheticScene::render(long frame, DepthFrame &out) {
+  w = out.width();
+  h = out.height();
+  clean.resize((size_t)w * h);
+  Kind k = kind(frame);
+  float p = (float)(frame % framesPerScene) / framesPerScene;
+  Random random(frame);
+  for (int y = 0; y < h; y++) {
+    uint16_t *depthRow = out.depthRow(y);
+    uint8_t *confRow = out.confRow(y);
+    uint16_t *cleanRow = &clean[(size_t)y * w];
+    float v = (y + 0.5f) / h;
+    for (int x = 0; x < w; x++) {
+      float u = (x + 0.5f) / w;
+      bool invalid;
+      float z = sceneDepth(k, p, u, v, invalid);
+      if (invalid || random.next() % 1000 < dropoutPerMille) {
+        depthRow[x] = 0;
+        confRow[x] = 0;
+        cleanRow[x] = 0;
+        continue;
+      }
+      if (z < nearFieldMm) {
+        // saturated: the depth is off and mostly not trusted
+        depthRow[x] = DepthFrame::toMillimeters((z + 40 * random.normal()) *
+                                                0.001f);
+        confRow[x] = random.next() % 30;
+        cleanRow[x] = 0;
+        continue;
+      }
+      float fall = fullConfidenceMm / z;
+      float signal = std::min(255.0f, 255 * fall * fall);
+      float conf = std::min(std::max(signal + 2 * random.normal(), 0.0f),
+                            255.0f);
+      depthRow[x] =
+          DepthFrame::toMillimeters(z * (1 + 0.01f * random.normal()) * 0.001f);
+      confRow[x] = (uint8_t)conf;
+      cleanRow[x] = signal > DepthKernel::confidenceThresh
+                        ? DepthFrame::toMillimeters(z * 0.001f)
+                        : 0;
+    }
+  }
+}
+
+//________________________________________________
+// minObjSize-th nearest valid depth of every motor
+void SyntheticScene::groundTruth(const ActuatorMap &map, int minMm,
+                                 uint16_t mm[ActuatorLayout::maxMotors]) {
+  int motors = map.motorCount();
+  motorDepths.resize(motors);
+  for (auto &depths : motorDepths) {
+    depths.clear();
+  }
+  for (int y = 0; y < h; y++) {
+    for (int x = 0; x < w; x++) {
+      uint16_t z = clean[(size_t)y * w + x];
+      uint8_t motor = map.motorAt(x, y);
+      if (z >= minMm && z > 0 && motor != ActuatorMap::skip) {
+        motorDepths[motor].push_back(z);
+      }
+    }
+  }
+  const size_t n = DepthSearch::minObjSize;
+  for (int m = 0; m < motors; m++) {
+    std::vector<uint16_t> &depths = motorDepths[m];
+    mm[m] = 0;
+    if (depths.size() >= n) {
+      std::nth_element(depths.begin(), depths.begin() + n - 1, depths.end());
+      mm[m] = depths[n - 1];
+    }
+  }
+}
+
+//________________________________________________
+SyntheticSource::SyntheticSource(const Options &options) : opts(options) {}
+
+SyntheticSource::~SyntheticSource() { stop(); }
+
+//________________________________________________
+bool SyntheticSource::open() {
+  if (opts.width < 1 || opts.height < 1 || opts.width > 65535 ||
+      opts.height > 65535) {
+    printf("synthetic: invalid resolution %i x %i\n", opts.width,
+           opts.height);
+    return false;
+  }
+  if (opts.fps > 0) {
+    printf("synthetic frames: %i x %i at %.1f fps\n", opts.width, opts.height,
+           opts.fps);
+  } else {
+    printf("synthetic frames: %i x %i as fast as they get processed\n",
+           opts.width, opts.height);
+  }
+  return true;
+}
+
+//________________________________________________
+bool SyntheticSource::start() {
+  if (generator.joinable()) {
+    return true;
+  }
+  stopping = false;
+  done = false;
+  playing = true;
+  Clock::addParticipant();
+  generator = std::thread([this] { generateLoop(); });
+  return true;
+}
+
+//________________________________________________
+bool SyntheticSource::stop() {
+  stopping = true;
+  if (generator.joinable()) {
+    Clock::Idle idle;
+    generator.join();
+  }
+  return true;
+}
+
+//________________________________________________
+// Renders right into the frame mailbox on this thread, like libroyale
+// calls onNewData() from its own thread
+void SyntheticSource::generateLoop() {
+  Clock::Participant participant;
+  Clock::time_point due = Clock::now();
+  const auto interval = duration_cast<Clock::duration>(
+      duration<double>(opts.fps > 0 ? 1.0 / opts.fps : 0.0));
+  generated = 0;
+  startTime = Clock::now();
+  while (!stopping && (opts.frames == 0 || generated < opts.frames)) {
+    if (opts.fps > 0) {
+      Clock::sleepUntil(due);
+      // don't try to catch up after a stall
+      due = std::max(due + interval, Clock::now() - interval);
+    } else {
+      while (Glob::frameMailbox.hasNew() && !stopping) {
+        Clock::sleepFor(backPressurePoll);
+      }
+    }
+    if (stopping) {
+      break;
+    }
+    DepthFrame &frame = beginFrame();
+    frame.resize(opts.width, opts.height);
+    frame.timeStamp =
+        duration_cast<microseconds>(Clock::now().time_since_epoch()).count();
+    scene.render(next++, frame);
+    publishFrame();
+    generated++;
+  }
+  endTime = Clock::now();
+  playing = false;
+  done = !stopping;
+}
+
+//________________________________________________
+void SyntheticSource::printSummary() {
+  double seconds = duration<double>(endTime - startTime).count();
+  printf("synthetic: %li frames of %i x %i in %.2f s (%.1f fps), %li "
+         "overwritten before processing\n",
+         generated, opts.width, opts.height, seconds,
+         seconds > 0 ? generated / seconds : 0.0,
+         Glob::frameMailbox.overwritten());
+  printPipelineSummary();
+}
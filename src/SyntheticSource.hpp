@@ -0,0 +1,99 @@
+#pragma once
+
+//----------------------------------------------------------------------
+// INCLUDES
+//----------------------------------------------------------------------
+#include <stdint.h>
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+#include "ActuatorLayout.hpp"
+#include "Clock.hpp"
+#include "FrameSource.hpp"
+
+//****************************************************************
+//                        SYNTHETIC SCENE
+//****************************************************************
+// Procedurally generated depth frames of any resolution. The scene changes
+// every `framesPerScene` frames and cycles through: a plane moving to and
+// from the camera, a corridor (walls, floor and an end wall coming closer),
+// poles in front of a wall, a hand in the near field (saturated: noisy and
+// mostly low confidence), patches of invalid pixels and stairs.
+// Everything is described in image coordinates (0..1), so every resolution
+// shows the same scene. Like on the camera the depth gets ~1% of noise, the
+// confidence falls off with the distance and a few pixels drop out.
+// The same frame number always gives the same frame.
+
+class SyntheticScene {
+public:
+  enum Kind { PLANE, CORRIDOR, POLES, NEAR_FIELD, INVALID, STAIRS, kinds };
+  static const int nearFieldMm = 150; // closer pixels are saturated
+
+  explicit SyntheticScene(int framesPerScene = 90);
+  // frame number `frame` in the size of `out`
+  void render(long frame, DepthFrame &out);
+  // GROUND TRUTH of the last frame rendered, per motor of the map: the
+  // depth (mm) at which the motor's region holds minObjSize valid pixels
+  // at least minMm away (noise-free), 0 if it never does
+  void groundTruth(const ActuatorMap &map, int minMm,
+                   uint16_t mm[ActuatorLayout::maxMotors]);
+
+  Kind kind(long frame) const {
+    return (Kind)((frame / framesPerScene) % kinds);
+  }
+  static const char *name(Kind kind);
+
+private:
+  int framesPerScene;
+  int w = 0;
+  int h = 0;
+  std::vector<uint16_t> clean; // noise-free depth, 0 where invalid
+  std::vector<std::vector<uint16_t>> motorDepths; // ground truth scratch
+};
+
+//****************************************************************
+//                       SYNTHETIC SOURCE
+//****************************************************************
+// Feeds SyntheticScene frames to the pipeline like the camera would, from
+// its own thread: at a fixed frame rate or (fps 0) as fast as the processing
+// picks them up. Any resolution and rate, to load test the pipeline beyond
+// what the Pico Flexx delivers.
+
+class SyntheticSource : public FrameSource {
+public:
+  struct Options {
+    int width = 224;
+    int height = 172;
+    float fps = 45;  // 0: next frame as soon as the last one got picked up
+    long frames = 0; // 0: endless
+  };
+
+  explicit SyntheticSource(const Options &options);
+  ~SyntheticSource();
+
+  bool open() override;
+  bool start() override;
+  bool stop() override;
+  bool isConnected() override { return true; }
+  bool isCapturing() override { return playing; }
+  bool finished() override { return done; }
+  const char *name() const override { return "synthetic"; }
+  void printSummary() override;
+
+private:
+  void generateLoop();
+
+  Options opts;
+  SyntheticScene scene;
+  std::thread generator;
+  std::atomic<bool> playing{false};
+  std::atomic<bool> stopping{false};
+  std::atomic<bool> done{false};
+  long next = 0; // frame number, continues after a restart
+  long generated = 0;
+  Clock::time_point startTime;
+  Clock::time_point endTime;
+};
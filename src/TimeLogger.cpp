@@ -1,14 +1,15 @@
 /* INFO
- * Small library to log how much time the processing steps take. 
+ * Small library to log how much time the processing steps take.
  * Can be used to monitor and detect anomalies.
+ * Lock-free and without allocations on the storing side (see TimeLogger.hpp).
  */
 
 #include "TimeLogger.hpp"
 
-#include <array>
+#include <algorithm>
 #include <chrono>
 #include <iostream>
-#include <string>
+#include <string.h>
 
 #include "Camera.hpp"
 #include "Globals.hpp"
@@ -16,41 +17,104 @@
 using namespace std::chrono;
 using std::cout;
 
-void TimeLogger::store(const std::string name) {
+//________________________________________________
+// Claims the next slot of the pass. The slot is marked as being written
+// first, so a reader never takes half an entry.
+void TimeLogger::store(Tag tag) {
   if (Glob::modes.a_doLog == true) {
-    std::lock_guard<std::mutex> lockStore(mut);
-    timePoint.push_back(steady_clock::now());
-    nameTag.push_back(name);
+    uint64_t s = state.fetch_add(1, std::memory_order_acq_rel);
+    uint32_t n = (uint32_t)s;
+    if (n >= (uint32_t)capacity) {
+      a_dropped.fetch_add(1, std::memory_order_relaxed);
+      return;
+    }
+    Entry &entry = entries[n];
+    entry.pass.store(0, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    entry.id.store(tag.id(), std::memory_order_relaxed);
+    entry.name.store(tag.name(), std::memory_order_relaxed);
+    entry.ticks.store(Clock::now().time_since_epoch().count(),
+                      std::memory_order_relaxed);
+    entry.pass.store((uint32_t)(s >> 32) + 1, std::memory_order_release);
   }
 }
 
-void TimeLogger::printAll(const std::string instName, const std::string incr,
-                          const std::string sum) {
+//________________________________________________
+// A new pass: the entries of the old one are no longer valid
+void TimeLogger::reset() {
+  if (Glob::modes.a_doLog == true) {
+    uint64_t s = state.load(std::memory_order_relaxed);
+    while (!state.compare_exchange_weak(s, ((s >> 32) + 1) << 32,
+                                        std::memory_order_acq_rel)) {
+    }
+  }
+}
+
+//________________________________________________
+// The complete entries of the current pass, in the order they were stored
+void TimeLogger::collect(Snapshot &out) const {
+  uint64_t s = state.load(std::memory_order_acquire);
+  uint32_t pass = (uint32_t)(s >> 32) + 1;
+  int n = (int)std::min<uint32_t>((uint32_t)s, capacity);
+  out.count = 0;
+  for (int x = 0; x < n; x++) {
+    const Entry &entry = entries[x];
+    if (entry.pass.load(std::memory_order_acquire) != pass) {
+      continue; // still being written or from an old pass
+    }
+    uint32_t id = entry.id.load(std::memory_order_relaxed);
+    const char *name = entry.name.load(std::memory_order_relaxed);
+    int64_t ticks = entry.ticks.load(std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (entry.pass.load(std::memory_order_relaxed) != pass) {
+      continue; // overwritten while reading
+    }
+    out.id[out.count] = id;
+    out.name[out.count] = name;
+    out.time[out.count] = Clock::time_point(Clock::duration(ticks));
+    out.count++;
+  }
+}
+
+// index of the first entry with the tag, -1 if there is none
+int TimeLogger::Snapshot::find(uint32_t tagId) const {
+  for (int x = 0; x < count; x++) {
+    if (id[x] == tagId) {
+      return x;
+    }
+  }
+  return -1;
+}
+
+//________________________________________________
+void TimeLogger::printAll(const char *instName, const char *incr,
+                          const char *sum) {
   if (Glob::modes.a_doLogPrint == true && Glob::modes.a_doLog == true) {
-    std::lock_guard<std::mutex> lockPrintAll(mut);
-    if (timePoint.size() > 1) { // if there is sth to print
+    Snapshot snap;
+    collect(snap);
+    if (snap.count > 1) { // if there is sth to print
       cout << "\n";
       cout << "-------------------------------\n";
       cout << "TIMER: " << instName << ":\n";
       cout << "-------------------------------\n";
 
-      for (unsigned int x = 1; x < timePoint.size(); x++) {
-        auto timeSpan = timePoint[x] - timePoint[x - 1];
-        if (incr.compare("ms") == 0) {
+      for (int x = 1; x < snap.count; x++) {
+        auto timeSpan = snap.time[x] - snap.time[x - 1];
+        if (strcmp(incr, "ms") == 0) {
           cout << duration_cast<milliseconds>(timeSpan).count();
-        } else if (incr.compare("us") == 0) {
+        } else if (strcmp(incr, "us") == 0) {
           cout << duration_cast<microseconds>(timeSpan).count();
         }
-        cout << "\t" << incr << "\t from: \t " << nameTag[x] << "\n";
+        cout << "\t" << incr << "\t from: \t " << snap.name[x] << "\n";
       }
 
       cout << "_________________\n";
       cout << "OVERALL dur: ";
-      auto timeSum = timePoint[timePoint.size() - 1] - timePoint[0];
-      if (sum.compare("ms") == 0) {
+      auto timeSum = snap.time[snap.count - 1] - snap.time[0];
+      if (strcmp(sum, "ms") == 0) {
         cout << duration_cast<milliseconds>(timeSum).count();
       }
-      if (sum.compare("us") == 0) {
+      if (strcmp(sum, "us") == 0) {
         cout << duration_cast<microseconds>(timeSum).count();
       }
       cout << "\t" << sum << "\n";
@@ -62,50 +126,69 @@ void TimeLogger::printAll(const std::string instName, const std::string incr,
   }
 }
 
-void TimeLogger::udpTimeSpan(std::string ident, std::string incr,
-                             std::string from, std::string to) {
+//________________________________________________
+// Sends the span and records it (in us) into its session histogram
+void TimeLogger::udpTimeSpan(Tag ident, const char *incr, Tag from, Tag to) {
   if (Glob::modes.a_doLog == true) {
-    std::lock_guard<std::mutex> lockTimeSpan(mut);
-    // find "from" keyword and "to" keyword and return iterator
-    std::vector<std::string>::iterator fromIt =
-        std::find(nameTag.begin(), nameTag.end(), from);
-    std::vector<std::string>::iterator toIt =
-        std::find(nameTag.begin(), nameTag.end(), to);
-    if (fromIt != nameTag.end() && toIt != nameTag.end()) { // when in bound:
-      int fromInd = std::distance(nameTag.begin(), fromIt); // get indexes
-      int toInd = std::distance(nameTag.begin(), toIt);     // get indexes
+    Snapshot snap;
+    collect(snap);
+    int fromInd = snap.find(from.id());
+    int toInd = snap.find(to.id());
+    if (fromInd >= 0 && toInd >= 0) { // when in bound:
+      auto timeSpan = snap.time[toInd] - snap.time[fromInd];
+      unsigned int spanUs = duration_cast<microseconds>(timeSpan).count();
+      Glob::spanHistograms.record(ident, spanUs);
       unsigned int duration = 0;
-      if (incr.compare("ms") == 0) {
-        duration =
-            duration_cast<milliseconds>(timePoint[toInd] - timePoint[fromInd])
-                .count();
-      } else if (incr.compare("us") == 0) {
-        duration =
-            duration_cast<microseconds>(timePoint[toInd] - timePoint[fromInd])
-                .count();
+      if (strcmp(incr, "ms") == 0) {
+        duration = duration_cast<milliseconds>(timeSpan).count();
+      } else if (strcmp(incr, "us") == 0) {
+        duration = spanUs;
       }
       {
         std::lock_guard<std::mutex> lockSendDur(Glob::udpServMux);
-        Glob::udpServer.preparePacket(ident, duration);
+        Glob::udpServer.preparePacket(ident.name(), duration);
       }
     }
   }
 }
 
-void TimeLogger::reset() {
-  if (Glob::modes.a_doLog == true) {
-    std::lock_guard<std::mutex> lockClear(mut);
-    timePoint.clear();
-    nameTag.clear();
+//________________________________________________
+// Time between two stored tags in us (-1 if one of them is missing)
+long TimeLogger::usBetween(Tag from, Tag to) {
+  Snapshot snap;
+  collect(snap);
+  int fromInd = snap.find(from.id());
+  int toInd = snap.find(to.id());
+  if (fromInd < 0 || toInd < 0) {
+    return -1;
+  }
+  return duration_cast<microseconds>(snap.time[toInd] - snap.time[fromInd])
+      .count();
+}
+
+//________________________________________________
+// All stored entries (up to max) with the time since the first one, for the
+// recorder. Returns the number of entries copied.
+int TimeLogger::copySpans(Recording::Span *spans, int max) {
+  Snapshot snap;
+  collect(snap);
+  int count = std::min(snap.count, max);
+  for (int x = 0; x < count; x++) {
+    spans[x].us =
+        duration_cast<microseconds>(snap.time[x] - snap.time[0]).count();
+    strncpy(spans[x].tag, snap.name[x], sizeof(spans[x].tag) - 1);
+    spans[x].tag[sizeof(spans[x].tag) - 1] = 0;
   }
+  return count;
 }
 
+//________________________________________________
 long TimeLogger::msSinceEntry(unsigned int id) {
-  std::lock_guard<std::mutex> lockGetDur(mut);
+  Snapshot snap;
+  collect(snap);
   long val = 0;
-  if (timePoint.size() > id) { // if there is a first entry
-    val = duration_cast<milliseconds>(steady_clock::now() - timePoint[id])
-              .count();
+  if ((unsigned int)snap.count > id) { // if there is a first entry
+    val = duration_cast<milliseconds>(Clock::now() - snap.time[id]).count();
   } else {
     val = -1;
   }
@@ -1,24 +1,83 @@
 #pragma once
 
-#include <array>
+#include <stddef.h>
+#include <stdint.h>
+
+#include <atomic>
 #include <chrono>
-#include <mutex>
-#include <string>
-#include <vector>
+#include <type_traits>
 
-class TimeLogger {
-  std::vector<std::chrono::steady_clock::time_point> timePoint;
-  std::vector<std::string> nameTag;
-  int i;
-  int pos = -1;
-  std::mutex mut;
+#include "Clock.hpp"
+#include "Recording.hpp"
+
+//****************************************************************
+//                          TIME LOGGER
+//****************************************************************
+// Timestamps of the steps of one pass (e.g. one frame), from the store() of
+// any thread until the next reset(). store() is lock-free and doesn't
+// allocate: its tag is a string literal interned at compile time (an ID, the
+// literal's hash), the entry goes into a fixed ring slot. The spans are only
+// resolved by the readers (printAll, udpTimeSpan, ...), by comparing IDs.
+// Entries beyond `capacity` in one pass get dropped.
 
+class TimeLogger {
 public:
-  void store(std::string name);
+  static const int capacity = 64;
+
+  // A string literal as a tag: converts implicitly, its ID is the FNV-1a
+  // hash of the text (never 0). The hash gets unrolled over the length of
+  // the literal, so the compiler folds it into a constant.
+  class Tag {
+  public:
+    template <size_t N>
+    constexpr Tag(const char (&text)[N])
+        : tagName(text),
+          tagId(nonZero(hash(text, 2166136261u, Length<N - 1>()))) {}
+    constexpr uint32_t id() const { return tagId; }
+    constexpr const char *name() const { return tagName; }
+
+  private:
+    template <size_t N> using Length = std::integral_constant<size_t, N>;
+    static constexpr uint32_t hash(const char *, uint32_t h, Length<0>) {
+      return h;
+    }
+    template <size_t N>
+    static constexpr uint32_t hash(const char *s, uint32_t h, Length<N>) {
+      return hash(s + 1, (h ^ (uint8_t)*s) * 16777619u, Length<N - 1>());
+    }
+    static constexpr uint32_t nonZero(uint32_t h) { return h ? h : 1; }
+    const char *tagName;
+    uint32_t tagId;
+  };
+
+  void store(Tag tag);
   void reset();
-  // void sendAll(const std::string, const std::string, const std::string);
-  void printAll(const std::string, const std::string, const std::string);
-  void udpTimeSpan(std::string ident, std::string incr, std::string from,
-                   std::string to);
+  void printAll(const char *instName, const char *incr, const char *sum);
+  void udpTimeSpan(Tag ident, const char *incr, Tag from, Tag to);
   long msSinceEntry(unsigned int id);
+  long usBetween(Tag from, Tag to);
+  int copySpans(Recording::Span *spans, int max);
+  // stores that didn't fit into the ring (since the start)
+  long dropped() const { return a_dropped; }
+
+private:
+  struct Entry {
+    std::atomic<uint32_t> pass{0}; // pass + 1 once written, 0 while writing
+    std::atomic<uint32_t> id{0};
+    std::atomic<const char *> name{nullptr};
+    std::atomic<int64_t> ticks{0}; // Clock
+  };
+  struct Snapshot {
+    int count;
+    uint32_t id[capacity];
+    const char *name[capacity];
+    Clock::time_point time[capacity];
+    int find(uint32_t tagId) const;
+  };
+  void collect(Snapshot &out) const;
+
+  Entry entries[capacity];
+  // pass (upper 32 bits) and entries claimed in it (lower 32 bits)
+  std::atomic<uint64_t> state{0};
+  std::atomic<long> a_dropped{0};
 };
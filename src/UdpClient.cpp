@@ -30,6 +30,9 @@ UdpClient::UdpClient(udp::endpoint e) {
   endpoint = e;
   maxTime = 2000;
   isActive = false;
+  sendImg = false;
+  compressImg = false;
+  imgSize = 1;
   lastCalled = steady_clock::now();
 }
 // increment the counter and check if it is below max frames before drop
@@ -22,6 +22,7 @@ public:
   bool isEqual(boost::asio::ip::udp::endpoint *checkEndpoint);
   boost::asio::ip::udp::endpoint endpoint;
   bool sendImg;
+  bool compressImg; // as DepthCodec image ("imz" instead of "img")
   int imgSize;
 
 private:
@@ -9,10 +9,12 @@
 #include <boost/array.hpp>
 #include <boost/asio.hpp>
 #include <chrono>
+#include <cstring>
 #include <ctime>
 #include <vector>
 
 #include "Camera.hpp"
+#include "DepthCodec.hpp"
 #include "Globals.hpp"
 #include "MotorBoard.hpp"
 #include "TimeLogger.hpp"
@@ -35,13 +37,17 @@ UdpServer::UdpServer(boost::asio::io_service &io_service, int max)
       maxClients(max),
       broad_socket_(io_service, udp::endpoint(udp::v4(), 9007)),
       timer1_(io_service, boost::posix_time::milliseconds(500)),
-      timer2_(io_service, boost::posix_time::milliseconds(500)) {
+      timer2_(io_service, boost::posix_time::milliseconds(500)),
+      timer3_(io_service, boost::posix_time::milliseconds(1000)) {
   // std::lock_guard<std::mutex> l(mux);
   // invoke first broadcast
   timer1_.async_wait(strand_.wrap(std::bind(&UdpServer::broadcast, this)));
   // invoke first client timer check
   timer2_.async_wait(
       strand_.wrap(std::bind(&UdpServer::checkClientTimers, this)));
+  // invoke first span summary
+  timer3_.async_wait(
+      strand_.wrap(std::bind(&UdpServer::sendSpanSummary, this)));
   // invoke first receive
   strand_.post(strand_.wrap(std::bind(&UdpServer::start_receive, this)));
   // Open second Socket for broadcasting
@@ -74,6 +80,19 @@ void UdpServer::checkClientTimers() {
       strand_.wrap(std::bind(&UdpServer::checkClientTimers, this)));
 }
 
+//_______ Send the Span Histograms _______
+// p50 / p99 / max / count of every TimeLogger span of the session
+void UdpServer::sendSpanSummary() {
+  std::vector<unsigned char> summary = Glob::spanHistograms.summary();
+  if (summary.size()) {
+    std::lock_guard<std::mutex> lockSendSpans(Glob::udpServMux);
+    preparePacket("spanStats", summary);
+  }
+  timer3_.expires_at(timer3_.expires_at() + boost::posix_time::seconds(1));
+  timer3_.async_wait(
+      strand_.wrap(std::bind(&UdpServer::sendSpanSummary, this)));
+}
+
 void UdpServer::prepareImage() {
   // std::lock_guard<std::mutex> l(mux);
   // iterte through all active clients
@@ -85,13 +104,23 @@ void UdpServer::prepareImage() {
         // cv::cvtColor(dep, dep, cv::COLOR_HSV2RGB, 3);
         cv::flip(dep, dep, -1);
         std::vector<unsigned char> vect;
-        vect.push_back('i');
-        vect.push_back('m');
-        vect.push_back('g');
-        vect.push_back(':');
-        for (int h = 0; h < dep.rows; h++) {
-          for (int j = 0; j < dep.cols; j++) {
-            vect.push_back(*(unsigned char *)(dep.data + h * dep.step + j));
+        if (udpClient[i].compressImg) {
+          // key, then the lossless DepthCodec image
+          const char key[] = "imz:";
+          vect.resize(4 + DepthCodec::maxEncodedSize(dep.cols, dep.rows));
+          memcpy(vect.data(), key, 4);
+          size_t size = DepthCodec::encodeImage(dep.data, dep.cols, dep.rows,
+                                                dep.step, vect.data() + 4);
+          vect.resize(4 + size);
+        } else {
+          vect.push_back('i');
+          vect.push_back('m');
+          vect.push_back('g');
+          vect.push_back(':');
+          for (int h = 0; h < dep.rows; h++) {
+            for (int j = 0; j < dep.cols; j++) {
+              vect.push_back(*(unsigned char *)(dep.data + h * dep.step + j));
+            }
           }
         }
         strand_.post(
@@ -160,7 +189,7 @@ void UdpServer::handle_receive() {
   udpRecLog.store("-");
   bool inList = false;
   int curClient = 0;
-  udpRecLog.store("old client number: " + std::to_string(udpClient.size()));
+  udpRecLog.store("find client");
   for (size_t i = 0; i < udpClient.size(); ++i) {
     if (udpClient[i].isEqual(&remote_endpoint_)) {
       udpClient[i].resetTimer();
@@ -178,9 +207,10 @@ void UdpServer::handle_receive() {
     curClient = udpClient.size() - 1;
   }
 
-  udpRecLog.store("new client number: " + std::to_string(udpClient.size()));
+  udpRecLog.store("client found");
   // reset local imagSend variable (if msg contains "i" it wil be set to true)
   _imgSend = false;
+  _imgCompress = false;
   int incSize = std::find(recv_buffer_.begin(), recv_buffer_.end(), '\0') -
                 recv_buffer_.begin();
 
@@ -196,6 +226,13 @@ void UdpServer::handle_receive() {
         udpClient[curClient].imgSize = tmp;
       }
     }
+    // like "i", but compressed
+    incoming = std::find(recv_buffer_.begin(), recv_buffer_.end(), 'e');
+    if (incoming != recv_buffer_.end()) {
+      _imgSend = true;
+      _imgCompress = true;
+      udpClient[curClient].imgSize = (*std::next(incoming, 1) - 48);
+    }
     incoming = std::find(recv_buffer_.begin(), recv_buffer_.end(), 'm');
     if (incoming != recv_buffer_.end()) {
       Glob::modes.a_muted = !Glob::modes.a_muted;
@@ -219,7 +256,8 @@ void UdpServer::handle_receive() {
     incoming = std::find(recv_buffer_.begin(), recv_buffer_.end(), 'z');
     if (incoming != recv_buffer_.end()) {
       int tmp = (*std::next(incoming, 1) - 48);
-      {
+      // ignore motors the layout doesn't have
+      if (tmp >= 0 && tmp < Glob::layout.motorCount()) {
         std::lock_guard<std::mutex> lock(Glob::motors.mut);
         Glob::motors.testTiles[tmp] =
             Glob::motors.testTiles[tmp] == 0 ? 254 : 0;
@@ -233,25 +271,29 @@ void UdpServer::handle_receive() {
       Glob::a_restartUnfoldingFlag = true; // jump back to the beginning
     }
 
+    // print the frame latencies (FrameTracer) on the console
+    incoming = std::find(recv_buffer_.begin(), recv_buffer_.end(), 'l');
+    if (incoming != recv_buffer_.end()) {
+      Glob::tracer.dump();
+    }
+
+    // start the span histograms (spanStats) over
+    incoming = std::find(recv_buffer_.begin(), recv_buffer_.end(), 'r');
+    if (incoming != recv_buffer_.end()) {
+      Glob::spanHistograms.reset();
+    }
+
     incoming = std::find(recv_buffer_.begin(), recv_buffer_.end(), 'c');
     if (incoming != recv_buffer_.end()) {
-      Glob::royalStats.a_isCalibRunning = true;
-      {
-        std::lock_guard<std::mutex> lockMotorTiles(Glob::motors.mut);
-        Glob::motorBoard.muteAll();
-      }
       Glob::modes.a_muted = true;
-      {
-        std::lock_guard<std::mutex> lockMotorTiles(Glob::motors.mut);
-        Glob::motorBoard.runCalib();
-      }
-      Glob::royalStats.a_isCalibRunning = false;
+      Glob::motorBoard.runCalibWhileRunning();
     }
   }
   // Set imgSend if there's a diff to the last frame
   if (_imgSend != udpClient[curClient].sendImg) {
     udpClient[curClient].sendImg = _imgSend;
   }
+  udpClient[curClient].compressImg = _imgCompress;
 
   udpRecLog.store("deciding on action");
 
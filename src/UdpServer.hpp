@@ -30,6 +30,7 @@ private:
   std::mutex mux;
   static const int numClients = 5;
   bool _imgSend = false;
+  bool _imgCompress = false;
   std::vector<UdpClient> udpClient;
   boost::asio::io_service::strand strand_;
   TimeLogger udpRecLog;
@@ -42,12 +43,15 @@ private:
   void broadcast();
   // timer checking
   void checkClientTimers();
+  // span histograms (spanStats)
+  void sendSpanSummary();
   boost::asio::ip::udp::socket broad_socket_;
   boost::asio::ip::udp::endpoint broad_endpoint_;
   boost::system::error_code errorBroad;
   boost::system::error_code errorRec;
   boost::asio::deadline_timer timer1_;
   boost::asio::deadline_timer timer2_;
+  boost::asio::deadline_timer timer3_;
   DepthDataUtilities ddUtilities;
 
 public:
@@ -0,0 +1,86 @@
+/* INFO
+ * Persistent worker threads that process row bands of a frame in parallel
+ * (see WorkerPool.hpp).
+ */
+
+//----------------------------------------------------------------------
+// INCLUDES
+//----------------------------------------------------------------------
+#include "WorkerPool.hpp"
+
+#include <algorithm>
+
+//----------------------------------------------------------------------
+// METHODS
+//----------------------------------------------------------------------
+WorkerPool::WorkerPool(int threads) {
+  // the calling thread always takes part, so start one thread less
+  for (int band = 1; band < threads; band++) {
+    workers.emplace_back([this, band] { workerLoop(band); });
+  }
+}
+
+WorkerPool::~WorkerPool() {
+  {
+    std::lock_guard<std::mutex> lock(mut);
+    stopping = true;
+  }
+  startCond.notify_all();
+  for (auto &worker : workers) {
+    worker.join();
+  }
+}
+
+//________________________________________________
+// libroyale calculates the depth frames on the same cores, so by default
+// only use half of them for our processing
+int WorkerPool::autoDetect() {
+  int cores = (int)std::thread::hardware_concurrency();
+  return std::max(1, cores / 2);
+}
+
+//________________________________________________
+// Wake all workers, do band 0 here and wait for the rest
+void WorkerPool::dispatch(void *ctx, JobFn fn) {
+  if (!workers.empty()) {
+    std::lock_guard<std::mutex> lock(mut);
+    jobCtx = ctx;
+    jobFn = fn;
+    pending = (int)workers.size();
+    generation++;
+  }
+  startCond.notify_all();
+  fn(ctx, 0);
+  if (!workers.empty()) {
+    std::unique_lock<std::mutex> lock(mut);
+    doneCond.wait(lock, [this] { return pending == 0; });
+  }
+}
+
+//________________________________________________
+// Sleep until there is a new job, do this thread's band, report back
+void WorkerPool::workerLoop(int band) {
+  unsigned long lastGeneration = 0;
+  while (true) {
+    void *ctx;
+    JobFn fn;
+    {
+      std::unique_lock<std::mutex> lock(mut);
+      startCond.wait(lock, [this, lastGeneration] {
+        return stopping || generation != lastGeneration;
+      });
+      if (stopping) {
+        return;
+      }
+      lastGeneration = generation;
+      ctx = jobCtx;
+      fn = jobFn;
+    }
+    fn(ctx, band);
+    {
+      std::lock_guard<std::mutex> lock(mut);
+      pending--;
+    }
+    doneCond.notify_one();
+  }
+}
@@ -0,0 +1,52 @@
+#pragma once
+
+//----------------------------------------------------------------------
+// INCLUDES
+//----------------------------------------------------------------------
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+//****************************************************************
+//                          WORKER POOL
+//****************************************************************
+// Small fork-join pool of persistent threads to split the processing of one
+// frame into row bands. run() hands band 0 to the calling thread and bands
+// 1..size()-1 to the workers and returns when all of them are done.
+// Threads are created once and sleep on a condition variable in between.
+
+class WorkerPool {
+public:
+  explicit WorkerPool(int threads);
+  ~WorkerPool();
+  WorkerPool(const WorkerPool &) = delete;
+  WorkerPool &operator=(const WorkerPool &) = delete;
+
+  // number of bands run() splits the work into (workers + calling thread)
+  int size() const { return (int)workers.size() + 1; }
+
+  // Run job(band) for every band. Doesn't allocate: the job is only
+  // referenced until run() returns.
+  template <typename Job> void run(Job &job) {
+    dispatch(&job, [](void *ctx, int band) { (*(Job *)ctx)(band); });
+  }
+
+  // worker count to use when none is set on the command line
+  static int autoDetect();
+
+private:
+  typedef void (*JobFn)(void *ctx, int band);
+  void dispatch(void *ctx, JobFn fn);
+  void workerLoop(int band);
+
+  std::vector<std::thread> workers;
+  std::mutex mut;
+  std::condition_variable startCond;
+  std::condition_variable doneCond;
+  void *jobCtx = nullptr;
+  JobFn jobFn = nullptr;
+  unsigned long generation = 0; // incremented for every run()
+  int pending = 0;              // workers still busy with this generation
+  bool stopping = false;
+};
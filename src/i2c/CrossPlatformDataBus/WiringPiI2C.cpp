@@ -19,8 +19,6 @@
 #include "CrossPlatformI2C.h"
 
 #include "../../Globals.hpp"
-#include <wiringPi.h>
-#include <wiringPiI2C.h>
 
 uint8_t cpi2c_open(uint8_t address, uint8_t bus) {
   std::lock_guard<std::mutex> locki2c(Glob::i2cMux);
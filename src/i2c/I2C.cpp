@@ -11,27 +11,36 @@
 #include <iostream>
 
 #include <errno.h>
+#include <string.h>
 
 //----------------------------------------------------------------------
 // METHODS
 //----------------------------------------------------------------------
 
 //________________________________________________
-// Just call the wiring pi setup when constructed
-I2C::I2C() {
-  wiringPiSetup();
+// Not in the constructor: Glob::i2c is constructed before the command line
+// options (and with them the bus) are known
+void I2C::init(I2cBus &i2cBus) {
+  bus = &i2cBus;
   // All I2C communication goes through the two TCA/PCA muxes
   mux[0] = setupDevice(TCA9548A_0_ADDRESS);
   mux[1] = setupDevice(TCA9548A_1_ADDRESS);
   mask[0] = 0;
   mask[1] = 0;
   lastMux = 0;
+  invalidateMuxes();
+}
+
+//________________________________________________
+void I2C::invalidateMuxes() {
+  muxState[0] = -1;
+  muxState[1] = -1;
 }
 
 //________________________________________________
 // In WiringPi every I2C Device has to be initiated to get respective address:
 int I2C::setupDevice(int addr) {
-  int respectiveAddr = wiringPiI2CSetup(addr);
+  int respectiveAddr = bus->open(addr);
   if (respectiveAddr < 0) {
     printf("I2C setup of %i failed\n", respectiveAddr);
   }
@@ -49,19 +58,26 @@ int I2C::selectSingleMuxLine(uint8_t muxNo, uint8_t lineNo) {
   // 00000000 would close all channels. equal to power-up/reset/default
   // selectSingleMuxLine is written to be able to open only one line at a time:
   // It uses bitshifting to shift a "1" by lineNo digits/positions
+  return selectMuxLines(muxNo, 1 << lineNo);
+}
 
+//________________________________________________
+// Open several lines of a mux at once (one bit per line, the mask stays
+// open too). A write then reaches all devices of its address behind them,
+// e.g. every DRV of the bank; a read would get all of them answering.
+int I2C::selectMuxLines(uint8_t muxNo, uint8_t lines) {
   int retVal;
-  uint8_t regCmd = 1 << lineNo;
-  regCmd |= mask[muxNo];
+  uint8_t regCmd = lines | mask[muxNo];
 
-  retVal = wiringPiI2CWrite(mux[muxNo], regCmd);
+  retVal = muxWrite(muxNo, regCmd);
   if (retVal < 0) {
-    printf("can't connect to mux %i while setting line %i\n", muxNo, lineNo);
+    printf("can't connect to mux %i while setting lines 0x%02x\n", muxNo,
+           lines);
     return -1;
   }
   // if we used the other tca before -> reset
   if (muxNo != lastMux) {
-    retVal = wiringPiI2CWrite(mux[lastMux], mask[lastMux]); // 0b00000000);
+    retVal = muxWrite(lastMux, mask[lastMux]); // 0b00000000);
     if (retVal < 0) {
       printf("can't reset mux %i \n", lastMux);
       return -1;
@@ -71,6 +87,27 @@ int I2C::selectSingleMuxLine(uint8_t muxNo, uint8_t lineNo) {
   return 0;
 }
 
+//________________________________________________
+// The TCA switches its lines on the STOP after the control byte. Nothing is
+// written if the mux already has it.
+int I2C::muxWrite(uint8_t muxNo, uint8_t regCmd) {
+  if (muxState[muxNo] == regCmd) {
+    a_saved++;
+    return 0;
+  }
+  a_writes++;
+  muxState[muxNo] = regCmd;
+  if (batching) {
+    queue(mux[muxNo], &regCmd, 1, true);
+    return 0;
+  }
+  int retVal = bus->write(mux[muxNo], regCmd);
+  if (retVal < 0) {
+    muxState[muxNo] = -1;
+  }
+  return retVal;
+}
+
 // The i2c multiplexer forwards its input to up to 8 outputs.
 // Which outputs are active is selected via selectSingleMuxLine.
 // This is the default behavior for the motors (as each one is addressed
@@ -87,7 +124,7 @@ void I2C::appendMuxMask(uint8_t muxNo, uint8_t mask_) { mask[muxNo] |= mask_; }
 // here you have to care for the 2nd mux – e.g. reset by using resetMux()
 // int I2C::manuallySetMux(uint8_t muxNo, uint8_t regCmd) {
 //  int retVal;
-//  retVal = wiringPiI2CWrite(mux[muxNo], regCmd);
+//  retVal = bus->write(mux[muxNo], regCmd);
 //  if (retVal < 0) {
 //    printf("can't connect to %i while writing cmd ", muxNo);
 //    Glob::printBinary(regCmd, true);
@@ -100,7 +137,7 @@ void I2C::appendMuxMask(uint8_t muxNo, uint8_t mask_) { mask[muxNo] |= mask_; }
 //// send a 0 to selcted mux to reset it
 // int I2C::resetMux(uint8_t muxNo) {
 //  int retVal;
-//  retVal = wiringPiI2CWrite(mux[muxNo], 0b00000000);
+//  retVal = bus->write(mux[muxNo], 0b00000000);
 //  if (retVal < 0) {
 //    printf("can't reset mux %i\n", muxNo);
 //    return -1;
@@ -112,7 +149,7 @@ void I2C::appendMuxMask(uint8_t muxNo, uint8_t mask_) { mask[muxNo] |= mask_; }
 // Read data from a register
 int I2C::readReg(int addr, unsigned char ucRegAddress) {
   int data;
-  if ((data = wiringPiI2CReadReg8(addr, ucRegAddress)) < 0) {
+  if ((data = bus->readReg8(addr, ucRegAddress)) < 0) {
     printf("failed reading 8bit register:  addr = 0x%02x, reg = 0x%02x, "
            "result = %i errno=%i (%s)\n",
            addr, ucRegAddress, data, errno, strerror(errno));
@@ -125,7 +162,7 @@ int I2C::readReg(int addr, unsigned char ucRegAddress) {
 // Read data from a register
 int I2C::readReg16(int addr, unsigned char ucRegAddress) {
   int data;
-  if ((data = wiringPiI2CReadReg16(addr, ucRegAddress)) < 0) {
+  if ((data = bus->readReg16(addr, ucRegAddress)) < 0) {
     printf("failed reading 16bit register:  addr = 0x%02x, reg = 0x%02x, "
            "result = %i errno=%i\n",
            addr, ucRegAddress, data, errno);
@@ -136,9 +173,15 @@ int I2C::readReg16(int addr, unsigned char ucRegAddress) {
 
 //________________________________________________
 // Write data to a register
-int I2C::writeReg(int addr, unsigned char ucRegAddress, char cValue) {
+int I2C::writeReg(int addr, unsigned char ucRegAddress, uint8_t value) {
   int data;
-  if ((data = wiringPiI2CWriteReg8(addr, ucRegAddress, cValue)) != 0) {
+  a_writes++;
+  if (batching) {
+    uint8_t bytes[] = {ucRegAddress, value};
+    queue(addr, bytes, 2, false);
+    return 0;
+  }
+  if ((data = bus->writeReg8(addr, ucRegAddress, value)) != 0) {
     printf("failed writing to register:  addr = 0x%02x, reg = 0x%02x, result = "
            "%i errno=%i\n",
            addr, ucRegAddress, data, errno);
@@ -150,9 +193,10 @@ int I2C::writeReg(int addr, unsigned char ucRegAddress, char cValue) {
 
 //________________________________________________
 // Write data to a register
-int I2C::writeReg16(int addr, unsigned char ucRegAddress, char cValue) {
+int I2C::writeReg16(int addr, unsigned char ucRegAddress, uint16_t value) {
   int data;
-  if ((data = wiringPiI2CWriteReg16(addr, ucRegAddress, cValue)) != 0) {
+  a_writes++;
+  if ((data = bus->writeReg16(addr, ucRegAddress, value)) != 0) {
     printf("failed writing to register:  addr = 0x%02x, reg = 0x%02x, result = "
            "%i errno=%i\n",
            addr, ucRegAddress, data, errno);
@@ -161,3 +205,71 @@ int I2C::writeReg16(int addr, unsigned char ucRegAddress, char cValue) {
   // delayMicroseconds(100);
   return 0;
 }
+
+//________________________________________________
+// Write several registers in a row (auto increment)
+int I2C::writeBlock(int addr, unsigned char ucRegAddress, const uint8_t *data,
+                    int n) {
+  int retVal;
+  a_writes++;
+  if ((retVal = bus->writeBlock(addr, ucRegAddress, data, n)) != 0) {
+    printf("failed writing %i registers:  addr = 0x%02x, reg = 0x%02x, "
+           "result = %i errno=%i\n",
+           n, addr, ucRegAddress, retVal, errno);
+    return -1;
+  }
+  return 0;
+}
+
+//________________________________________________
+// Read several registers in a row (auto increment)
+int I2C::readBlock(int addr, unsigned char ucRegAddress, uint8_t *out, int n) {
+  int retVal;
+  if ((retVal = bus->readBlock(addr, ucRegAddress, out, n)) != 0) {
+    printf("failed reading %i registers:  addr = 0x%02x, reg = 0x%02x, "
+           "result = %i errno=%i\n",
+           n, addr, ucRegAddress, retVal, errno);
+    return -1;
+  }
+  return 0;
+}
+
+//________________________________________________
+// From now on mux selects and register writes (8 bit) only get queued. Reads
+// and everything else still go to the bus at once.
+void I2C::beginBatch() {
+  batching = true;
+  batched = 0;
+  batchFailed = false;
+}
+
+//________________________________________________
+// Send the queued writes (failures are reported here, not by the methods
+// that queued them)
+int I2C::endBatch() {
+  batching = false;
+  return flush() != 0 || batchFailed ? -1 : 0;
+}
+
+//________________________________________________
+void I2C::queue(int handle, const uint8_t *data, int length, bool stop) {
+  if (batched == maxBatch && flush() != 0) {
+    batchFailed = true; // reported by endBatch()
+  }
+  I2cBus::Write &w = batch[batched++];
+  w.handle = handle;
+  w.length = length;
+  memcpy(w.data, data, length);
+  w.stop = stop;
+}
+
+int I2C::flush() {
+  int retVal = 0;
+  if (batched > 0 && (retVal = bus->writeBatch(batch, batched)) < 0) {
+    printf("failed writing a batch of %i i2c writes: errno=%i\n", batched,
+           errno);
+    invalidateMuxes(); // don't know which of them got through
+  }
+  batched = 0;
+  return retVal < 0 ? -1 : 0;
+}
@@ -1,30 +1,73 @@
 #pragma once
 
 #include <stdint.h>
-#include <wiringPi.h>
-#include <wiringPiI2C.h>
+
+#include <atomic>
+
+#include "I2cBus.hpp"
 
 //****************************************************************
 //                          I2C Class
 //****************************************************************
 // Class that handels all the i2c communication to the various devices
+// The transactions go to an I2cBus backend: WiringPiBus on the glove, a
+// MockBus with simulated outputs (--simulate): nothing is sent, writes only
+// get counted and all reads return 0, so the whole pipeline runs on any
+// Linux box (e.g. with a replayed recording).
+// Between beginBatch() and endBatch() mux selects and register writes are
+// only queued and then go to the bus together (I2cBus::writeBatch, one
+// ioctl for several of them with I2cDevBus). The caller holds Glob::i2cMux
+// for the whole batch. A batch longer than maxBatch goes out in parts,
+// endBatch() fails if any of them did.
 
 class I2C {
 public:
-  I2C();
+  // call once at startup, before any other method
+  void init(I2cBus &bus);
+  bool isSimulated() const { return bus && bus->simulated(); }
+  // what gets read back can be checked (not with MockBus)
+  bool readsDevices() const { return bus && bus->readsDevices(); }
+  long writeCount() const { return a_writes; }
+  // mux writes skipped because the mux was already in that state
+  long savedCount() const { return a_saved; }
   int setupDevice(int addr);
   int selectSingleMuxLine(uint8_t mux, uint8_t line);
+  int selectMuxLines(uint8_t mux, uint8_t lines);
   void appendMuxMask(uint8_t muxNo, uint8_t mask);
   int manuallySetMux(uint8_t muxNo, uint8_t regCmd);
   int resetMux(uint8_t muxNo);
   int readReg(int addr, unsigned char ucRegAddress);
   int readReg16(int addr, unsigned char ucRegAddress);
-  int writeReg(int addr, unsigned char ucRegAddress, char cValue);
-  int writeReg16(int addr, unsigned char ucRegAddress, char cValue);
+  int writeReg(int addr, unsigned char ucRegAddress, uint8_t value);
+  int writeReg16(int addr, unsigned char ucRegAddress, uint16_t value);
+  // n registers from ucRegAddress on in one transaction
+  int writeBlock(int addr, unsigned char ucRegAddress, const uint8_t *data,
+                 int n);
+  int readBlock(int addr, unsigned char ucRegAddress, uint8_t *out, int n);
+  void beginBatch();
+  int endBatch();
+  // forget the states of the muxes: the next selects write them again
+  void invalidateMuxes();
+  // the mux the last line was selected on
+  int activeMux() const { return lastMux; }
 
 private:
+  // 2 mux writes and a register per motor (16 at most)
+  static const int maxBatch = 48;
+  int muxWrite(uint8_t muxNo, uint8_t regCmd);
+  void queue(int handle, const uint8_t *data, int length, bool stop);
+  int flush();
+  I2cBus::Write batch[maxBatch];
+  int batched = 0;
+  bool batching = false;
+  bool batchFailed = false; // a part that already went out
+
   int mux[2];
   uint8_t mask[2];
   int lastMux;
+  int muxState[2]; // control byte last written, -1: unknown
+  I2cBus *bus = nullptr;
+  std::atomic<long> a_writes{0};
+  std::atomic<long> a_saved{0};
   int printBinary(uint8_t, bool);
 };
@@ -0,0 +1,88 @@
+#pragma once
+
+#include <stdint.h>
+
+//****************************************************************
+//                          I2C BUS
+//****************************************************************
+// The transactions the I2C class needs from a bus. Devices are addressed by
+// the handle open() returned. Reads return the value (<0: failed), writes 0
+// (<0: failed), like wiringPiI2C does.
+// Backends: WiringPiBus (the hardware), I2cDevBus (the hardware through
+// i2c-dev, --i2cDev), MockBus (--simulate, benchmarks) and SimBus (register
+// models of the glove's devices, sim/).
+
+class I2cBus {
+public:
+  // One write of a batch: 1 to 3 bytes (a TCA9548A control byte, a register
+  // and its value, ...). `stop`: the device only acts on the STOP condition
+  // after the write (the TCA9548A switches its lines then).
+  struct Write {
+    int handle;
+    uint8_t length;
+    uint8_t data[3];
+    bool stop;
+  };
+
+  virtual ~I2cBus() {}
+  // the bus of the glove: WiringPiBus, in the host simulator (unfolding-sim)
+  // SimBus. Defined by whichever of the two gets linked.
+  static I2cBus &board();
+  virtual int open(int addr) = 0;
+  // a single byte without register (the TCA9548A's control register)
+  virtual int write(int handle, uint8_t data) = 0;
+  virtual int readReg8(int handle, uint8_t reg) = 0;
+  virtual int readReg16(int handle, uint8_t reg) = 0;
+  virtual int writeReg8(int handle, uint8_t reg, uint8_t value) = 0;
+  virtual int writeReg16(int handle, uint8_t reg, uint16_t value) = 0;
+  // `n` registers from `reg` on in one transaction (the device increments
+  // its register pointer). By default one transaction per register.
+  virtual int writeBlock(int handle, uint8_t reg, const uint8_t *data, int n) {
+    for (int i = 0; i < n; i++) {
+      if (writeReg8(handle, reg + i, data[i]) != 0) {
+        return -1;
+      }
+    }
+    return 0;
+  }
+  virtual int readBlock(int handle, uint8_t reg, uint8_t *out, int n) {
+    for (int i = 0; i < n; i++) {
+      int value = readReg8(handle, reg + i);
+      if (value < 0) {
+        return -1;
+      }
+      out[i] = value;
+    }
+    return 0;
+  }
+  // The writes in this order, as few transfers as the backend can make of
+  // them. 0, <0 if any of them failed (the others are still written). By
+  // default every write is a transaction of its own.
+  virtual int writeBatch(const Write *writes, int count) {
+    int retVal = 0;
+    for (int i = 0; i < count; i++) {
+      const Write &w = writes[i];
+      int r = -1;
+      if (w.length == 1) {
+        r = write(w.handle, w.data[0]);
+      } else if (w.length == 2) {
+        r = writeReg8(w.handle, w.data[0], w.data[1]);
+      } else if (w.length == 3) {
+        r = writeReg16(w.handle, w.data[0], w.data[1] | w.data[2] << 8);
+      }
+      if (r < 0) {
+        retVal = r;
+      }
+    }
+    return retVal;
+  }
+  // no hardware behind it
+  virtual bool simulated() const { return false; }
+  // reads come from devices (MockBus: always 0)
+  virtual bool readsDevices() const { return true; }
+
+protected:
+  // bits one transaction takes on the wire: `bytes` bytes (address byte(s)
+  // incl.) of 8 bits + ACK, `starts` start conditions and a stop
+  static int wireBits(int bytes, int starts) { return bytes * 9 + starts + 1; }
+};
@@ -0,0 +1,135 @@
+/* INFO
+ * I2cBus backend on top of the kernel's i2c-dev interface with combined
+ * transfers (see I2cDevBus.hpp).
+ */
+
+//----------------------------------------------------------------------
+// INCLUDES
+//----------------------------------------------------------------------
+#include "I2cDevBus.hpp"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <linux/i2c-dev.h>
+#include <linux/i2c.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <unistd.h>
+
+//----------------------------------------------------------------------
+// METHODS
+//----------------------------------------------------------------------
+I2cDevBus::I2cDevBus(const std::string &path) {
+  fd = ::open(path.c_str(), O_RDWR);
+  if (fd < 0) {
+    printf("can't open the i2c adapter %s: %s\n", path.c_str(),
+           strerror(errno));
+    return;
+  }
+  unsigned long funcs = 0;
+  if (ioctl(fd, I2C_FUNCS, &funcs) < 0 || !(funcs & I2C_FUNC_I2C)) {
+    printf("%s can't do plain i2c transfers (I2C_RDWR)\n", path.c_str());
+    ::close(fd);
+    fd = -1;
+    return;
+  }
+  stopInTransfer = funcs & I2C_FUNC_PROTOCOL_MANGLING;
+  printf("i2c through %s (combined transfers, %s)\n", path.c_str(),
+         stopInTransfer ? "one per batch" : "one per mux switch");
+}
+
+I2cDevBus::~I2cDevBus() {
+  if (fd >= 0) {
+    ::close(fd);
+  }
+}
+
+//________________________________________________
+// Nothing to set up: every message carries its address
+int I2cDevBus::open(int addr) { return fd < 0 ? -1 : addr; }
+
+int I2cDevBus::write(int handle, uint8_t data) {
+  return writeBytes(handle, &data, 1);
+}
+
+int I2cDevBus::writeReg8(int handle, uint8_t reg, uint8_t value) {
+  uint8_t data[] = {reg, value};
+  return writeBytes(handle, data, 2);
+}
+
+int I2cDevBus::writeReg16(int handle, uint8_t reg, uint16_t value) {
+  uint8_t data[] = {reg, (uint8_t)(value & 0xFF), (uint8_t)(value >> 8)};
+  return writeBytes(handle, data, 3);
+}
+
+int I2cDevBus::readReg8(int handle, uint8_t reg) {
+  uint8_t data[1];
+  int retVal = readBytes(handle, reg, data, 1);
+  return retVal < 0 ? retVal : data[0];
+}
+
+// SMBus word: low byte first
+int I2cDevBus::readReg16(int handle, uint8_t reg) {
+  uint8_t data[2];
+  int retVal = readBytes(handle, reg, data, 2);
+  return retVal < 0 ? retVal : data[0] | data[1] << 8;
+}
+
+int I2cDevBus::writeBlock(int handle, uint8_t reg, const uint8_t *data,
+                          int n) {
+  uint8_t buffer[33];
+  if (n < 0 || n > 32) {
+    return -1;
+  }
+  buffer[0] = reg;
+  memcpy(buffer + 1, data, n);
+  return writeBytes(handle, buffer, n + 1);
+}
+
+int I2cDevBus::readBlock(int handle, uint8_t reg, uint8_t *out, int n) {
+  return readBytes(handle, reg, out, n);
+}
+
+//________________________________________________
+int I2cDevBus::writeBytes(int addr, const uint8_t *data, int n) {
+  i2c_msg msg = {(uint16_t)addr, 0, (uint16_t)n, (uint8_t *)data};
+  i2c_rdwr_ioctl_data transfer = {&msg, 1};
+  return ioctl(fd, I2C_RDWR, &transfer) < 0 ? -1 : 0;
+}
+
+//________________________________________________
+// The register pointer, then after a repeated start `n` bytes read
+int I2cDevBus::readBytes(int addr, uint8_t reg, uint8_t *out, int n) {
+  i2c_msg msgs[2] = {{(uint16_t)addr, 0, 1, &reg},
+                     {(uint16_t)addr, I2C_M_RD, (uint16_t)n, out}};
+  i2c_rdwr_ioctl_data transfer = {msgs, 2};
+  return ioctl(fd, I2C_RDWR, &transfer) < 0 ? -1 : 0;
+}
+
+//________________________________________________
+// A transfer ends at every write that needs its STOP (unless the adapter can
+// put the STOP inside the transfer) and when it's full. A failed transfer
+// doesn't stop the ones after it.
+int I2cDevBus::writeBatch(const Write *writes, int count) {
+  i2c_msg msgs[I2C_RDWR_IOCTL_MAX_MSGS];
+  int retVal = 0;
+  int n = 0;
+  for (int i = 0; i < count; i++) {
+    const Write &w = writes[i];
+    i2c_msg &msg = msgs[n++];
+    msg.addr = (uint16_t)w.handle;
+    msg.flags = w.stop && stopInTransfer ? I2C_M_STOP : 0;
+    msg.len = w.length;
+    msg.buf = (uint8_t *)w.data;
+    bool last = i == count - 1;
+    if (last || n == I2C_RDWR_IOCTL_MAX_MSGS || (w.stop && !stopInTransfer)) {
+      i2c_rdwr_ioctl_data transfer = {msgs, (uint32_t)n};
+      if (ioctl(fd, I2C_RDWR, &transfer) < 0) {
+        retVal = -1;
+      }
+      n = 0;
+    }
+  }
+  return retVal;
+}
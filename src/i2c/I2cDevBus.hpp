@@ -0,0 +1,43 @@
+#pragma once
+
+#include <string>
+
+#include "I2cBus.hpp"
+
+//****************************************************************
+//                         I2C-DEV BUS
+//****************************************************************
+// The i2c bus through the kernel's i2c-dev interface (e.g. /dev/i2c-1), with
+// one file descriptor for all devices: every transfer is an I2C_RDWR ioctl
+// carrying the device address in its messages, so no I2C_SLAVE switching.
+// writeBatch() sends several writes (mux selects and DRV registers) in one
+// ioctl. The TCA9548A only switches its lines on a STOP, so a batch has to
+// stop after each of its writes: if the adapter can do that inside a
+// transfer (I2C_M_STOP, protocol mangling) the whole batch is one ioctl,
+// otherwise a transfer ends after every TCA write and the register writes
+// ride along in front of the next one (repeated starts).
+// Handles are the 7 bit addresses (like SimBus).
+
+class I2cDevBus : public I2cBus {
+public:
+  explicit I2cDevBus(const std::string &path);
+  ~I2cDevBus();
+  // the adapter could be opened
+  bool isOpen() const { return fd >= 0; }
+  int open(int addr) override;
+  int write(int handle, uint8_t data) override;
+  int readReg8(int handle, uint8_t reg) override;
+  int readReg16(int handle, uint8_t reg) override;
+  int writeReg8(int handle, uint8_t reg, uint8_t value) override;
+  int writeReg16(int handle, uint8_t reg, uint16_t value) override;
+  int writeBlock(int handle, uint8_t reg, const uint8_t *data, int n) override;
+  int readBlock(int handle, uint8_t reg, uint8_t *out, int n) override;
+  int writeBatch(const Write *writes, int count) override;
+
+private:
+  int readBytes(int addr, uint8_t reg, uint8_t *out, int n);
+  int writeBytes(int addr, const uint8_t *data, int n);
+
+  int fd = -1;
+  bool stopInTransfer = false; // I2C_M_STOP supported
+};
@@ -9,12 +9,14 @@
 //----------------------------------------------------------------------
 #include "Imu.hpp"
 #include "../Globals.hpp"
+#include "CrossPlatformDataBus/CrossPlatformI2C_Core.h"
+#include "CrossPlatformDataBus/LSM6DSM.h"
+#include "MMC5633.h"
 
 #include <errno.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
-#include <wiringPi.h>
 
 //----------------------------------------------------------------------
 // METHODS
@@ -57,6 +59,11 @@ void Imu::init() {
 
 //Get all position data from umi
 void Imu::getPosition() {
+  if (Glob::modes.a_simulate) {
+    // no sensor: glove is held in the position of use (1g along -x)
+    ax = -1000, ay = 0, az = 0, gx = 0, gy = 0, gz = 0;
+    return;
+  }
   if (lsm6dsm->checkNewData()) {
     ax = 0, ay = 0, az = 0, gx = 0, gy = 0, gz = 0;
     lsm6dsm->readData(ax, ay, az, gx, gy, gz);
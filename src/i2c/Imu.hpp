@@ -1,8 +1,11 @@
 #pragma once
-#include "CrossPlatformDataBus/CrossPlatformI2C_Core.h"
-#include "CrossPlatformDataBus/LSM6DSM.h"
-#include "MMC5633.h"
+#include "../Recording.hpp"
 #include <stdint.h>
+
+// the drivers stay out of this header (it's part of Globals.hpp, the LSM6DSM
+// driver pulls in wiringPi)
+class LSM6DSM;
+class MMC5633;
 //****************************************************************
 //                          IMU Class
 //****************************************************************
@@ -14,6 +17,8 @@ public:
   void printPosition();
   bool onThreshExceeded();
   bool offThreshExceeded();
+  // last position read (for the recorder)
+  Recording::ImuPayload sample() const { return {ax, ay, az, gx, gy, gz}; }
 
 private:
   int addr;
@@ -0,0 +1,70 @@
+/* INFO
+ * I2cBus backend without hardware (see MockBus.hpp).
+ */
+
+//----------------------------------------------------------------------
+// INCLUDES
+//----------------------------------------------------------------------
+#include "MockBus.hpp"
+
+#include <chrono>
+
+using namespace std::chrono;
+
+//----------------------------------------------------------------------
+// METHODS
+//----------------------------------------------------------------------
+
+//________________________________________________
+// One transaction of `bytes` bytes (address byte(s) incl.) with `starts`
+// start conditions (2 for a read: the register is written first)
+void MockBus::transfer(int bytes, int starts) {
+  int n = wireBits(bytes, starts);
+  a_transactions++;
+  a_bits += n;
+  if (clock <= 0) {
+    return;
+  }
+  auto end = steady_clock::now() + nanoseconds(1000000000LL * n / clock);
+  while (steady_clock::now() < end) {
+  }
+}
+
+//________________________________________________
+int MockBus::write(int, uint8_t) {
+  transfer(2, 1);
+  return 0;
+}
+
+int MockBus::readReg8(int, uint8_t) {
+  transfer(4, 2);
+  return 0;
+}
+
+int MockBus::readReg16(int, uint8_t) {
+  transfer(5, 2);
+  return 0;
+}
+
+int MockBus::writeReg8(int, uint8_t, uint8_t) {
+  transfer(3, 1);
+  return 0;
+}
+
+int MockBus::writeReg16(int, uint8_t, uint16_t) {
+  transfer(4, 1);
+  return 0;
+}
+
+int MockBus::writeBlock(int, uint8_t, const uint8_t *, int n) {
+  transfer(n + 2, 1);
+  return 0;
+}
+
+int MockBus::readBlock(int, uint8_t, uint8_t *out, int n) {
+  transfer(n + 3, 2);
+  for (int i = 0; i < n; i++) {
+    out[i] = 0;
+  }
+  return 0;
+}
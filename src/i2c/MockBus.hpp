@@ -0,0 +1,41 @@
+#pragma once
+
+#include <atomic>
+
+#include "I2cBus.hpp"
+
+//****************************************************************
+//                          MOCK BUS
+//****************************************************************
+// An i2c bus without devices: writes only get counted, reads return 0.
+// Used with simulated outputs (--simulate) and by the benchmarks. With a
+// clock (Hz) every transaction also takes as long as its bits would take on
+// a real bus of that clock (busy wait: start, 9 bits per byte incl. ACK,
+// stop), so timings include the bus; without one it returns at once and
+// only the cost of the code is left.
+
+class MockBus : public I2cBus {
+public:
+  explicit MockBus(int clockHz = 0) : clock(clockHz) {}
+  int open(int addr) override { return addr; }
+  int write(int handle, uint8_t data) override;
+  int readReg8(int handle, uint8_t reg) override;
+  int readReg16(int handle, uint8_t reg) override;
+  int writeReg8(int handle, uint8_t reg, uint8_t value) override;
+  int writeReg16(int handle, uint8_t reg, uint16_t value) override;
+  int writeBlock(int handle, uint8_t reg, const uint8_t *data, int n) override;
+  int readBlock(int handle, uint8_t reg, uint8_t *out, int n) override;
+  bool simulated() const override { return true; }
+  bool readsDevices() const override { return false; }
+
+  long transactions() const { return a_transactions; }
+  // bits on the (imagined) wire incl. start / stop and ACKs
+  long bits() const { return a_bits; }
+
+private:
+  void transfer(int bytes, int starts);
+
+  const int clock;
+  std::atomic<long> a_transactions{0};
+  std::atomic<long> a_bits{0};
+};
@@ -0,0 +1,65 @@
+/* INFO
+ * I2cBus backend on top of wiringPiI2C (see WiringPiBus.hpp).
+ */
+
+//----------------------------------------------------------------------
+// INCLUDES
+//----------------------------------------------------------------------
+#include "WiringPiBus.hpp"
+
+#include <unistd.h>
+#include <wiringPiI2C.h>
+
+//----------------------------------------------------------------------
+// METHODS
+//----------------------------------------------------------------------
+I2cBus &I2cBus::board() {
+  static WiringPiBus bus;
+  return bus;
+}
+
+//________________________________________________
+int WiringPiBus::open(int addr) { return wiringPiI2CSetup(addr); }
+
+int WiringPiBus::write(int handle, uint8_t data) {
+  return wiringPiI2CWrite(handle, data);
+}
+
+int WiringPiBus::readReg8(int handle, uint8_t reg) {
+  return wiringPiI2CReadReg8(handle, reg);
+}
+
+int WiringPiBus::readReg16(int handle, uint8_t reg) {
+  return wiringPiI2CReadReg16(handle, reg);
+}
+
+int WiringPiBus::writeReg8(int handle, uint8_t reg, uint8_t value) {
+  return wiringPiI2CWriteReg8(handle, reg, value);
+}
+
+int WiringPiBus::writeReg16(int handle, uint8_t reg, uint16_t value) {
+  return wiringPiI2CWriteReg16(handle, reg, value);
+}
+
+//________________________________________________
+// register and data in one write() of the device's file descriptor
+int WiringPiBus::writeBlock(int handle, uint8_t reg, const uint8_t *data,
+                            int n) {
+  uint8_t buffer[33];
+  if (n < 0 || n > 32) {
+    return -1;
+  }
+  buffer[0] = reg;
+  for (int i = 0; i < n; i++) {
+    buffer[1 + i] = data[i];
+  }
+  return ::write(handle, buffer, n + 1) == n + 1 ? 0 : -1;
+}
+
+// the register pointer, then (after a STOP) the registers from there on
+int WiringPiBus::readBlock(int handle, uint8_t reg, uint8_t *out, int n) {
+  if (::write(handle, &reg, 1) != 1) {
+    return -1;
+  }
+  return ::read(handle, out, n) == n ? 0 : -1;
+}
@@ -0,0 +1,22 @@
+#pragma once
+
+#include "I2cBus.hpp"
+
+//****************************************************************
+//                        WIRINGPI BUS
+//****************************************************************
+// The i2c bus of the Raspberry Pi through wiringPiI2C (one file descriptor
+// per device). wiringPiI2C has no block transfers: they go straight to the
+// device's file descriptor (read() / write() of i2c-dev).
+
+class WiringPiBus : public I2cBus {
+public:
+  int open(int addr) override;
+  int write(int handle, uint8_t data) override;
+  int readReg8(int handle, uint8_t reg) override;
+  int readReg16(int handle, uint8_t reg) override;
+  int writeReg8(int handle, uint8_t reg, uint8_t value) override;
+  int writeReg16(int handle, uint8_t reg, uint16_t value) override;
+  int writeBlock(int handle, uint8_t reg, const uint8_t *data, int n) override;
+  int readBlock(int handle, uint8_t reg, uint8_t *out, int n) override;
+};
@@ -6,6 +6,7 @@
 // INCLUDES
 //----------------------------------------------------------------------
 #include <signal.h>
+#include <unistd.h>
 
 #include <algorithm>
 #include <boost/array.hpp>
@@ -14,6 +15,7 @@
 #include <boost/program_options.hpp>
 #include <boost/shared_ptr.hpp>
 #include <chrono>
+#include <cstdio>
 #include <ctime>
 #include <iostream>
 #include <iterator>
@@ -23,10 +25,19 @@
 namespace po = boost::program_options;
 
 #include "Camera.hpp"
+#include "Clock.hpp"
+#include "DepthCodec.hpp"
+#include "FrameSource.hpp"
 #include "Globals.hpp"
 #include "MotorBoard.hpp"
+#include "PipelineCheck.hpp"
+#include "Platform.hpp"
+#include "ReplaySource.hpp"
+#include "SyntheticSource.hpp"
 #include "TimeLogger.hpp"
 #include "UdpServer.hpp"
+#include "i2c/I2cDevBus.hpp"
+#include "i2c/MockBus.hpp"
 #include "time.h"
 
 using boost::asio::ip::udp;
@@ -40,6 +51,24 @@ using namespace std::chrono;
 // VERSION is defined by the Makefile
 #endif
 
+// how often unfolding() looks after the camera, LEDs and timeouts
+const auto watchInterval = milliseconds(10);
+// how often the actuators get checked against their calibration (drift)
+const long calibCheckMs = 60000;
+
+// where the frames come from: the camera, a recording (--replay) or
+// generated scenes (--synthetic). Lives until the program exits (never
+// destructed: exit() is called while the threads still run)
+FrameSource *frameSource = nullptr;
+
+// SIGUSR1: append the span histograms to this file (--spanDump). The handler
+// only sets the flag, unfolding() writes the file.
+std::string spanDumpPath = "unfolding-spans.txt";
+std::atomic<bool> a_dumpSpans{false};
+// SIGINT / SIGTERM: mute and exit. The handler only sets the flag,
+// unfolding() does the rest (nothing of it is async-signal-safe).
+std::atomic<bool> a_exitRequested{false};
+
 //________________________________________________
 // Check Internet Connection
 bool isInternetConnected() {
@@ -59,7 +88,9 @@ bool isInternetConnected() {
 void getCoreTemp() {
   std::string coreTemp;
   std::ifstream tempFile("/sys/class/thermal/thermal_zone0/temp");
-  tempFile >> coreTemp;
+  if (!(tempFile >> coreTemp) || coreTemp.size() < 3) {
+    return; // not on the raspi
+  }
   coreTemp = coreTemp.insert(2, 1, '.');
   float coreTempDouble = std::stod(coreTemp);
   {
@@ -69,9 +100,23 @@ void getCoreTemp() {
   tempFile.close();
 }
 
+//________________________________________________
+// A file in the directory of the binary, whatever the working directory is
+// (started as a service, over ssh, ...). The working directory if
+// /proc/self/exe can't be read.
+std::string besideBinary(const std::string &name) {
+  char path[4096];
+  ssize_t n = readlink("/proc/self/exe", path, sizeof(path));
+  if (n <= 0 || n == (ssize_t)sizeof(path)) {
+    return name;
+  }
+  std::string exe(path, n);
+  return exe.substr(0, exe.rfind('/') + 1) + name;
+}
+
 //________________________________________________
 // Mute motors before exiting the appllication
-void exitApplicationMuted(__attribute__((unused)) int dummy) {
+void exitApplicationMuted() {
   Glob::modes.a_muted = true;
   {
     std::lock_guard<std::mutex> lockMotorTiles(Glob::motors.mut);
@@ -79,7 +124,43 @@ void exitApplicationMuted(__attribute__((unused)) int dummy) {
   }
   Glob::led1.off();
   Glob::led2.off();
-  exit(0);
+  // write the rest of the recording and its index
+  Glob::recorder.stop();
+  // don't run the destructors of the globals: the other threads are still
+  // waiting on their condition variables (destroying those would block)
+  cout.flush();
+  fflush(stdout);
+  _exit(0);
+}
+
+//________________________________________________
+// ctrl + c, kill: exit muted from the watchdog loop of unfolding(). A second
+// signal before it got there (e.g. while waiting for the camera) exits at
+// once.
+void requestExit(__attribute__((unused)) int dummy) {
+  if (a_exitRequested.exchange(true)) {
+    _exit(1);
+  }
+}
+
+//________________________________________________
+// kill -USR1 <pid>: dump the span histograms
+void requestSpanDump(__attribute__((unused)) int dummy) { a_dumpSpans = true; }
+
+//________________________________________________
+// Calibrate the actuators while the glove runs if there is no calibration of
+// it yet or they drifted away from it (see MotorBoard::checkCalibration()).
+// The motors are silent for the time of the calibration (~1 s), the
+// processing goes on.
+void calibrateIfDue() {
+  {
+    std::lock_guard<std::mutex> lockMotorTiles(Glob::motors.mut);
+    if (!Glob::motorBoard.checkCalibration()) {
+      return;
+    }
+  }
+  cout << "Calibrating the actuators" << endl;
+  Glob::motorBoard.runCalibWhileRunning();
 }
 
 //**********************************************************************
@@ -90,7 +171,7 @@ void exitApplicationMuted(__attribute__((unused)) int dummy) {
 int unfolding() {
   Glob::a_restartUnfoldingFlag = false;
   bool threeSecondsAreOver = false;
-  DepthDataListener listener;
+  FrameSource &source = *frameSource;
   long timeSinceNewData;   // time passed since last "onNewData"
   int maxTimeSinceNewData; // the longest timespan without new data since start
   bool cameraDetached;     // camera got detached
@@ -105,44 +186,14 @@ int unfolding() {
 
   Glob::logger.mainLogger.store("INIT");
 
-  // Event Listener
-  EventReporter eventReporter;
-
-  royale::CameraManager manager;
-  royale::Vector<royale::String> camlist;
-  // this represents the main camera device object
-  std::unique_ptr<royale::ICameraDevice> cameraDevice;
-
   //_____________________INIT CAMERA____________________________________
-  // check if the cam is connected before init anything
-  bool cameraSearchBlink = false;
-  while (camlist.empty()) {
-    cameraSearchBlink = !cameraSearchBlink;
-    camlist = manager.getConnectedCameraList();
-    if (!camlist.empty()) {
-      cameraDevice = manager.createCamera(camlist[0]);
-      break;
-    }
-    Glob::led1.setG(0);
-    cout << ":";
-    cout.flush();
-    delay(100);
-    if (cameraSearchBlink)
-      Glob::led1.setB(1);
-    else
-      Glob::led1.setB(0);
+  // wait for the camera (or open the recording) and initialize it
+  if (!source.open()) {
+    return 1;
   }
-  // Turn Off Camera Search blink
-  Glob::led1.setB(0);
-  Glob::led1.setG(1);
-
-  // if camlist is not NULL
-  camlist.clear();
-
-  Glob::logger.mainLogger.store("search");
   // Mute the LRAs before ending the program by ctr + c (SIGINT)
-  signal(SIGINT, exitApplicationMuted);
-  signal(SIGTERM, exitApplicationMuted);
+  signal(SIGINT, requestExit);
+  signal(SIGTERM, requestExit);
 
   // Setup the LRAs on the Glove (I2C Connection, Settings, Calibration, etc.)
   {
@@ -151,79 +202,6 @@ int unfolding() {
   }
   Glob::logger.mainLogger.store("glove");
 
-  //  camera device is now available, CameraManager can be deallocated here
-  if (cameraDevice == nullptr) {
-    // no cameraDevice available
-    cerr << "Cannot create the camera device" << endl;
-    return 1;
-  }
-  // IMPORTANT: call the initialize method before working with camera device
-  // #costly: rpi4 1000ms
-  auto status = cameraDevice->initialize();
-  Glob::logger.mainLogger.store("cam");
-
-  if (status != royale::CameraStatus::SUCCESS) {
-    cerr << "Cannot initialize the camera device, error string : "
-         << getErrorString(status) << endl;
-    return 1;
-  }
-  royale::Vector<royale::String> useCases;
-  auto usecaseStatus = cameraDevice->getUseCases(useCases);
-
-  if (usecaseStatus != royale::CameraStatus::SUCCESS || useCases.empty()) {
-    cerr << "No use cases are available" << endl;
-    cerr << "getUseCases() returned: " << getErrorString(usecaseStatus) << endl;
-    return 1;
-  }
-  cerr << useCases << endl;
-  // choose a use case
-  uint selectedUseCaseIdx = 0u;
-  if (Glob::modes.a_cameraUseCase) {
-    cerr << "got the argument:" << Glob::modes.a_cameraUseCase << endl;
-    auto useCaseFound = false;
-    if (Glob::modes.a_cameraUseCase < useCases.size()) {
-      selectedUseCaseIdx = Glob::modes.a_cameraUseCase;
-      useCaseFound = true;
-    }
-
-    if (!useCaseFound) {
-      cerr << "Error: the chosen use case is not supported by this camera"
-           << endl;
-      cerr << "A list of supported use cases is printed by sampleCameraInfo"
-           << endl;
-      return 1;
-    }
-  } else {
-    cerr << "Here: autousecase id" << endl;
-    // choose the first use case
-    selectedUseCaseIdx = 0;
-  }
-  // set an operation mode
-  if (cameraDevice->setUseCase(useCases.at(selectedUseCaseIdx)) !=
-      royale::CameraStatus::SUCCESS) {
-    cerr << "Error setting use case" << endl;
-    return 1;
-  }
-  // retrieve the lens parameters from Royale
-  royale::LensParameters lensParameters;
-  status = cameraDevice->getLensParameters(lensParameters);
-  if (status != royale::CameraStatus::SUCCESS) {
-    cerr << "Can't read out the lens parameters" << endl;
-    return 1;
-  }
-
-  // Glob::listener.setLensParameters(lensParameters);
-
-  // register a data listener
-  if (cameraDevice->registerDataListener(&listener) !=
-      royale::CameraStatus::SUCCESS) {
-    cerr << "Error registering data listener" << endl;
-    return 1;
-  }
-  Glob::logger.mainLogger.store("regist");
-  // register a EVENT listener
-  cameraDevice->registerEventListener(&eventReporter);
-
   // JUST FOR TESTING IF THE LSM DEVICE IS THERE
   {
     std::lock_guard<std::mutex> lockimu(Glob::imuMux);
@@ -232,9 +210,7 @@ int unfolding() {
 
   //_____________________START CAPTURING_________________________________
   // start capture mode
-  //#costly: rpi4 500ms
-  if (cameraDevice->startCapture() != royale::CameraStatus::SUCCESS) {
-    cerr << "Error starting the capturing" << endl;
+  if (!source.start()) {
     return 1;
   }
   Glob::logger.mainLogger.store("capt");
@@ -243,9 +219,10 @@ int unfolding() {
   startTimeLog.store("INIT");
   cameraDetached = false;      // camera is attached and ready
   Glob::modes.a_muted = false; // activate the vibration motors
-  long lastCallImshow = millis();
-  long lastCall = millis() - 10000;
+  long lastCallImshow = Clock::millis();
+  long lastCall = Clock::millis() - 10000;
   long lastCallTemp = 0;
+  long lastCalibCheck = Clock::millis() - calibCheckMs;
   // Turn off green init LED
   Glob::led1.setG(0);
   // Glob::logger.mainLogger.printAll("Initializing Unfolding", "ms", "ms");
@@ -256,6 +233,21 @@ int unfolding() {
   bool internetConnected = 0;
   //_____________________ENDLESS LOOP_________________________________
   while (!Glob::a_restartUnfoldingFlag) {
+    Clock::sleepFor(watchInterval);
+    // a replay (without --replayLoop) or a given number of synthetic frames
+    // ends the program when it's through
+    if (source.finished()) {
+      // let the last frame pass through processing and sending
+      Clock::sleepFor(milliseconds(200));
+      source.printSummary();
+      exitApplicationMuted();
+    }
+    if (a_exitRequested) {
+      exitApplicationMuted();
+    }
+    if (a_dumpSpans.exchange(false)) {
+      Glob::spanHistograms.dump(spanDumpPath);
+    }
     // Check if time since camera started capturing is bigger than 3 secs
     if (!threeSecondsAreOver) {
       if (startTimeLog.msSinceEntry(0) > 3000) {
@@ -275,7 +267,7 @@ int unfolding() {
         }
 
         // do this every 66ms (15 fps)
-        if (millis() - lastCallImshow > 66) {
+        if (Clock::millis() - lastCallImshow > 66) {
           // update LEDs
           if (Glob::modes.a_muted != lastMuted) {
             lastMuted = Glob::modes.a_muted;
@@ -287,16 +279,16 @@ int unfolding() {
           }
 
           // update test motor vals
-          lastCallImshow = millis();
+          lastCallImshow = Clock::millis();
           // Get all the data of the royal lib to see if camera is working
-          status = cameraDevice->isConnected(tempisConnected);
-          status = cameraDevice->isCapturing(tempisCapturing);
+          tempisConnected = source.isConnected();
+          tempisCapturing = source.isCapturing();
 
           Glob::royalStats.a_isConnected = tempisConnected;
           Glob::royalStats.a_isCapturing = tempisCapturing;
         }
         // do this every 5000ms (every 1 seconds)
-        if (millis() - lastCallTemp > 1000) {
+        if (Clock::millis() - lastCallTemp > 1000) {
           if (internetConnected) {
             Glob::led2.setDimG(0);
             Glob::led2.setDimB(statusBlink);
@@ -305,17 +297,24 @@ int unfolding() {
             Glob::led2.setDimB(0);
           }
           statusBlink = !statusBlink;
-          lastCallTemp = millis();
+          lastCallTemp = Clock::millis();
           getCoreTemp(); // read raspi's core temperature
         }
 
         // do this every 5000ms (every 1 seconds)
-        if (millis() - lastCall > 10000) {
-          lastCall = millis();
+        if (Clock::millis() - lastCall > 10000) {
+          lastCall = Clock::millis();
           internetConnected = isInternetConnected();
           // tenSecsDrops = 0;
         }
 
+        // calibration missing or drifted -> calibrate (not while muted)
+        if (threeSecondsAreOver && !Glob::modes.a_muted &&
+            Clock::millis() - lastCalibCheck > calibCheckMs) {
+          lastCalibCheck = Clock::millis();
+          calibrateIfDue();
+        }
+
         // Ignore first 3secs
         if (threeSecondsAreOver) {
           // RESTART WHEN CAMERA IS UNPLUGGED
@@ -371,8 +370,7 @@ int unfolding() {
   }
   //_____________________END OF PROGRAMM________________________________
   // stop capturing mode
-  if (cameraDevice->stopCapture() != royale::CameraStatus::SUCCESS) {
-    cerr << "Error stopping the capturing" << endl;
+  if (!source.stop()) {
     return 1;
   }
   Glob::modes.a_muted = true;
@@ -396,6 +394,7 @@ public:
 
   // Run the Main Code with the endless loop
   void runUnfolding() {
+    Clock::Participant participant;
     int unfReturn;
     while (true) {
       unfReturn = unfolding();
@@ -408,15 +407,24 @@ public:
     return std::thread([=] { runUnfolding(); });
   }
 
-  // Processing the Data, Creating Depth Image, Histogram and 9-Tiles Array
+  // Processing the Data, Creating Depth Image, Histograms and Motor Values
   void runCopyDepthData() {
+    Clock::Participant participant;
+    if (Glob::modes.a_inline) {
+      return; // frames get processed in the frame source's thread
+    }
     DepthDataUtilities ddProcessor;
     while (1) {
-      std::unique_lock<std::mutex> pdCondLock(Glob::notifyProcess.mut);
-      Glob::notifyProcess.cond.wait(pdCondLock,
-                                    [] { return Glob::notifyProcess.flag; });
+      {
+        std::unique_lock<std::mutex> pdCondLock(Glob::notifyProcess.mut);
+        while (!Glob::frameMailbox.hasNew()) {
+          Clock::Idle idle;
+          Glob::notifyProcess.cond.wait(pdCondLock);
+        }
+      }
+      Glob::notifyProcess.handoff.take();
+      // don't hold the mutex while processing -> onNewData never waits for us
       ddProcessor.processData();
-      Glob::notifyProcess.flag = false;
     }
   }
   std::thread runCopyDepthDataThread() {
@@ -425,6 +433,7 @@ public:
 
   // Sending the Data to the glove (Costly due to register writing via i2c)
   void runSendDepthData() {
+    Clock::Participant participant;
     // counter for setting off the motors by position. start with
     int offThresh = 12;
     // start with hight counter to mute fast
@@ -432,19 +441,59 @@ public:
     int onThreshCounter = 0;
 
     while (1) {
-      {
+      uint16_t motorMask;
+      bool frameDone;
+      uint32_t segmentFrame; // FrameTracer IDs of motorMask / frameDone
+      uint32_t doneFrame;
+      unsigned char *values = Glob::motors.tiles;
+      MotorFrame inlineFrame;
+      if (Glob::modes.a_inline) {
+        // INLINE MODE: whole frames from the royale callback through the
+        // lock-free slot, woken by the callback once a frame is published
+        {
+          std::unique_lock<std::mutex> svCondLock(Glob::notifySend.mut);
+          while (!Glob::motorMailbox.hasNew()) {
+            Clock::Idle idle;
+            Glob::notifySend.cond.wait(svCondLock);
+          }
+        }
+        Glob::notifySend.handoff.take();
+        inlineFrame = *Glob::motorMailbox.acquire();
+        values = inlineFrame.values;
+        motorMask = (1 << inlineFrame.count) - 1;
+        frameDone = true;
+        segmentFrame = doneFrame = inlineFrame.traceId;
+      } else {
         std::unique_lock<std::mutex> svCondLock(Glob::notifySend.mut);
-        Glob::notifySend.cond.wait(svCondLock,
-                                   [] { return Glob::notifySend.flag; });
+        while (!Glob::notifySend.flag && !Glob::notifySend.a_pendingMotors) {
+          Clock::Idle idle;
+          Glob::notifySend.cond.wait(svCondLock);
+        }
+        Glob::notifySend.handoff.take();
+        motorMask = Glob::notifySend.a_pendingMotors.exchange(0);
+        frameDone = Glob::notifySend.flag;
+        Glob::notifySend.flag = false;
+        segmentFrame = Glob::notifySend.segmentFrame;
+        doneFrame = Glob::notifySend.doneFrame;
+      }
+      // write the rows of tiles that are already done while the processing
+      // thread is still busy with the rest of the frame
+      if (motorMask && !Glob::modes.a_testMode) {
+        std::lock_guard<std::mutex> lockMotorTiles(Glob::motors.mut);
+        Glob::motorBoard.traceFrame(segmentFrame);
+        Glob::motorBoard.sendValuesToGlove(values, Glob::layout.motorCount(),
+                                           motorMask);
+      }
+      if (!frameDone) {
+        continue;
       }
       // IF in regular mode
       if (!Glob::modes.a_testMode) {
         {
           std::lock_guard<std::mutex> lockMotorTiles(Glob::motors.mut);
-          Glob::motorBoard.sendValuesToGlove(Glob::motors.tiles, 9);
+          Glob::motorBoard.finishFrame();
         }
-        const int size =
-            sizeof(Glob::motors.testTiles) / sizeof(Glob::motors.testTiles[0]);
+        const int size = Glob::layout.motorCount();
         std::vector<unsigned char> vect;
         for (int i = 0; i < size; i++) {
           unsigned char tmpChar = Glob::motors.tiles[i];
@@ -455,12 +504,14 @@ public:
           Glob::udpServer.preparePacket("motors", vect);
           Glob::udpServer.prepareImage();
         }
+        Glob::tracer.finish(doneFrame);
       } // IF in test mode
       else {
         std::lock_guard<std::mutex> lockMotorTiles2(Glob::motors.mut);
-        Glob::motorBoard.sendValuesToGlove(Glob::motors.testTiles, 9);
-        const int size =
-            sizeof(Glob::motors.testTiles) / sizeof(Glob::motors.testTiles[0]);
+        Glob::motorBoard.traceFrame(0);
+        Glob::motorBoard.sendValuesToGlove(Glob::motors.testTiles,
+                                           Glob::layout.motorCount());
+        const int size = Glob::layout.motorCount();
         std::vector<unsigned char> vect;
 
         for (int i = 0; i < size; i++) {
@@ -473,6 +524,12 @@ public:
         }
       }
 
+      if (Glob::recorder.isRecording()) {
+        Glob::recorder.recordTiles(
+            Glob::modes.a_testMode ? Glob::motors.testTiles : values,
+            Glob::layout.motorCount());
+      }
+
       // Send depth image no matter if test mode or not.
       {
         std::lock_guard<std::mutex> lockPrepareImage(Glob::udpServMux);
@@ -484,7 +541,8 @@ public:
       int tempCounter = Glob::royalStats.a_libraryCrashCounter;
       bool tempMuted = Glob::modes.a_muted;
       bool tempTest = Glob::modes.a_testMode;
-      int lockfail = Glob::a_lockFailCounter;
+      int overwritten = Glob::frameMailbox.overwritten();
+      int consumed = Glob::frameMailbox.consumed();
 
       {
         std::lock_guard<std::mutex> lockSendValues(Glob::udpServMux);
@@ -493,11 +551,12 @@ public:
         Glob::udpServer.preparePacket("libCrashes", tempCounter);
         Glob::udpServer.preparePacket("isMuted", tempMuted);
         Glob::udpServer.preparePacket("isTestMode", tempTest);
-        Glob::udpServer.preparePacket("lockFails", lockfail);
-      }
-      {
-        std::unique_lock<std::mutex> svCondLock(Glob::notifySend.mut);
-        Glob::notifySend.flag = false;
+        Glob::udpServer.preparePacket("frmOverwr", overwritten);
+        Glob::udpServer.preparePacket("frmConsumed", consumed);
+        if (Glob::recorder.isRecording()) {
+          int recDrops = Glob::recorder.framesDropped();
+          Glob::udpServer.preparePacket("recDrops", recDrops);
+        }
       }
       Glob::logger.imuLog.reset();
       Glob::logger.imuLog.store("start");
@@ -511,6 +570,10 @@ public:
         std::lock_guard<std::mutex> lockimu(Glob::imuMux);
         Glob::imu.printPosition();
       }
+      if (Glob::recorder.isRecording()) {
+        std::lock_guard<std::mutex> lockimu(Glob::imuMux);
+        Glob::recorder.recordImu(Glob::imu.sample());
+      }
       bool offThreshEx;
       bool onThreshEx;
       {
@@ -562,6 +625,7 @@ public:
       Glob::modes.a_isInActivePos = nowActive;
 
       Glob::logger.imuLog.store("end");
+      Glob::logger.imuLog.udpTimeSpan("imu", "us", "start", "end");
       Glob::logger.imuLog.printAll("TIME FOR IMU", "us", "ms");
       Glob::logger.imuLog.reset();
     }
@@ -575,6 +639,9 @@ public:
 // MAIN LOOP
 //----------------------------------------------------------------------
 int main(int ac, char *av[]) {
+  std::string recordDir;
+  std::string i2cDevPath;
+  long verifyFrames = 0;
   // catch cmd line options
   try {
     po::options_description desc("Allowed options");
@@ -593,7 +660,54 @@ int main(int ac, char *av[]) {
                                "from "
                                "0:5)")("id", po::value<unsigned int>(),
                                        "set identifier for udp "
-                                       "messages");
+                                       "messages")(
+        "workers", po::value<unsigned int>(),
+        "number of threads processing a frame in row bands (default: "
+        "detected automatically)")(
+        "layout", po::value<std::string>(),
+        "actuator layout file (default: 3x3 glove)")(
+        "inline", "process frames right in the royale callback (one thread "
+                  "hop less)")(
+        "incremental", po::value<int>()->implicit_value(2),
+        "only reprocess parts of the frame with a pixel that changed by more "
+        "than arg depth bins (default: 2)")(
+        "replay", po::value<std::string>(),
+        "play a recorded session instead of using the camera")(
+        "replayFast", "replay as fast as the processing can take the frames "
+                      "instead of the recorded timing")(
+        "replayLoop", "start the replay over at the end")(
+        "replayStart", po::value<long>(), "start the replay at frame arg")(
+        "simulate", "simulated outputs: no i2c and GPIO access (run without "
+                    "the glove, e.g. with --replay)")(
+        "i2cDev", po::value<std::string>()->implicit_value("/dev/i2c-1"),
+        "talk to the glove through the i2c-dev adapter arg (default: "
+        "/dev/i2c-1) instead of wiringPi: the mux selects and motor writes "
+        "of a bank go out in combined transfers")(
+        "record", po::value<std::string>(),
+        "record the session (frames, motor values, imu, timings) into a new "
+        "file in directory arg")(
+        "recordRaw", "record the frames uncompressed")(
+        "recordError", po::value<int>(),
+        "record the depth near-lossless, every pixel within arg mm "
+        "(default: lossless)")(
+        "synthetic", po::value<std::string>(),
+        "generated frames instead of the camera, arg: <width>x<height>[@fps] "
+        "(fps 0: as fast as they get processed)")(
+        "syntheticFrames", po::value<long>(),
+        "stop after arg synthetic frames (default: endless)")(
+        "verify", po::value<long>()->implicit_value(180),
+        "check all processing variants against the reference "
+        "implementation on arg synthetic frames per resolution and exit")(
+        "virtualTime", "simulated time that only passes while the pipeline "
+                       "waits (with --replay, --synthetic or the simulator: "
+                       "long sessions in seconds)")(
+        "spanDump", po::value<std::string>(),
+        "file the span latency histograms get appended to on SIGUSR1 "
+        "(default: unfolding-spans.txt)")(
+        "calibCache", po::value<std::string>(),
+        "keep the actuator calibration in file arg and write it back at "
+        "startup (default: unfolding-calibration.txt next to the binary, "
+        "\"\": don't)");
 
     po::variables_map vm;
     po::store(po::parse_command_line(ac, av, desc), vm);
@@ -637,6 +751,114 @@ int main(int ac, char *av[]) {
       Glob::modes.a_identifier = vm["id"].as<unsigned int>();
     }
 
+    // split processing of each frame in row bands on several threads
+    if (vm.count("workers")) {
+      Glob::modes.a_workers = vm["workers"].as<unsigned int>();
+    }
+    if (Glob::modes.a_workers < 1) {
+      Glob::modes.a_workers = WorkerPool::autoDetect();
+    }
+    cout << "Processing frames with " << Glob::modes.a_workers
+         << " worker(s)\n";
+
+    // process in the royale callback instead of the processing thread
+    if (vm.count("inline")) {
+      Glob::modes.a_inline = true;
+      cout << "Processing frames inline in the royale callback\n";
+    }
+
+    // skip unchanged parts of the frame (static scenes)
+    if (vm.count("incremental")) {
+      Glob::modes.a_changeTol = std::max(0, vm["incremental"].as<int>());
+      cout << "Incremental processing with a tolerance of "
+           << Glob::modes.a_changeTol << " depth bins\n";
+    }
+
+    // map image regions to motors differently than the 3x3 glove
+    if (vm.count("layout")) {
+      if (!Glob::layout.load(vm["layout"].as<std::string>())) {
+        return 1;
+      }
+      cout << "Actuator layout " << vm["layout"].as<std::string>() << " with "
+           << Glob::layout.motorCount() << " motors\n";
+    }
+
+    // don't touch the hardware, only count the writes
+    if (vm.count("simulate")) {
+      Glob::modes.a_simulate = true;
+      cout << "Simulated outputs (no i2c and GPIO access)\n";
+    }
+
+    if (vm.count("i2cDev")) {
+      i2cDevPath = vm["i2cDev"].as<std::string>();
+    }
+
+    if (vm.count("record")) {
+      recordDir = vm["record"].as<std::string>();
+      int maxError = 0;
+      if (vm.count("recordError")) {
+        maxError = vm["recordError"].as<int>();
+        if (maxError < 0 || maxError > DepthCodec::maxMaxError) {
+          cerr << "error: recordError has to be 0 to "
+               << DepthCodec::maxMaxError << " mm\n";
+          return 1;
+        }
+      }
+      Glob::recorder.setCompression(!vm.count("recordRaw"), maxError);
+    }
+
+    if (vm.count("verify")) {
+      verifyFrames = std::max(1L, vm["verify"].as<long>());
+    }
+
+    if (vm.count("spanDump")) {
+      spanDumpPath = vm["spanDump"].as<std::string>();
+    }
+
+    // calibrated actuators without calibrating at every start
+    Glob::motorBoard.useCalibrationCache(
+        vm.count("calibCache") ? vm["calibCache"].as<std::string>()
+                               : besideBinary("unfolding-calibration.txt"));
+
+    // time that only passes while the pipeline waits
+    if (vm.count("virtualTime")) {
+      Clock::useVirtualTime();
+      cout << "Virtual time\n";
+    }
+
+    // frames from a recording or generated ones instead of the camera
+    if (vm.count("synthetic")) {
+      SyntheticSource::Options synthetic;
+      const std::string arg = vm["synthetic"].as<std::string>();
+      if (sscanf(arg.c_str(), "%ix%i@%f", &synthetic.width, &synthetic.height,
+                 &synthetic.fps) < 2) {
+        cerr << "error: synthetic has to be <width>x<height>[@fps]\n";
+        return 1;
+      }
+      if (vm.count("syntheticFrames")) {
+        synthetic.frames = vm["syntheticFrames"].as<long>();
+      }
+      frameSource = new SyntheticSource(synthetic);
+      if (!frameSource->open()) {
+        return 1;
+      }
+    } else if (vm.count("replay")) {
+      ReplaySource::Options replay;
+      replay.path = vm["replay"].as<std::string>();
+      replay.fast = vm.count("replayFast");
+      replay.loop = vm.count("replayLoop");
+      if (vm.count("replayStart")) {
+        replay.startFrame = vm["replayStart"].as<long>();
+      }
+      frameSource = new ReplaySource(replay);
+      // check the file before anything gets started
+      if (!frameSource->open()) {
+        return 1;
+      }
+    } else {
+      frameSource = FrameSource::camera();
+    }
+
   } catch (std::exception &e) {
     cerr << "error: " << e.what() << "\n";
     return 1;
@@ -645,8 +867,41 @@ int main(int ac, char *av[]) {
     return 1;
   }
 
-  // create thread wrapper instance and the threads
+  // only the processing, no threads and no hardware
+  if (verifyFrames > 0) {
+    return PipelineCheck::run(verifyFrames) == 0 ? 0 : 1;
+  }
+
+  // wiringPi setup and the muxes (not before the options are known)
+  static MockBus mockBus;
+  if (Glob::modes.a_simulate) {
+    Glob::i2c.init(mockBus);
+  } else if (i2cDevPath.size()) {
+    Platform::setup();
+    static I2cDevBus devBus(i2cDevPath);
+    if (!devBus.isOpen()) {
+      return 1;
+    }
+    Glob::i2c.init(devBus);
+  } else {
+    Platform::setup();
+    Glob::i2c.init(I2cBus::board());
+  }
+
+  // record the session (replayable with --replay)
+  if (recordDir.size() && !Glob::recorder.start(recordDir)) {
+    return 1;
+  }
+
+  // kill -USR1: dump the span histograms (before any thread could get it)
+  signal(SIGUSR1, requestSpanDump);
+
+  // create thread wrapper instance and the threads (unfolding, processing
+  // and sending drive the pipeline: virtual time waits for them)
   mainThreadWrapper *w = new mainThreadWrapper();
+  for (int i = 0; i < 3; i++) {
+    Clock::addParticipant();
+  }
   std::thread udpSendTh = w->runUdpSendThread();
   std::thread unfTh = w->runUnfoldingThread();
   std::thread ddCopyTh = w->runCopyDepthDataThread();